@@ -0,0 +1,26 @@
+#ifndef HASH_FILE_H
+#define HASH_FILE_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+struct HashFileStats {
+    size_t lines = 0;           // non-empty lines
+    size_t loaded = 0;
+    size_t malformed = 0;
+    size_t first_malformed = 0; // 1-based line number, 0 if none
+    double seconds = 0;
+};
+
+// Appends every valid hash of a one-hash-per-line file to hashes. The file
+// is mmap'd and split at line boundaries across all cores, each of which
+// validates its share in a single pass. Blank lines are skipped, trailing
+// whitespace and CRs are trimmed. Returns -1 if the file cannot be read.
+int load_hash_file(const std::string &path, std::vector<std::string> &hashes, HashFileStats &stats);
+
+// Drops repeated hashes in place, keeping each first occurrence in its
+// original position; returns how many were removed
+size_t dedupe_hashes(std::vector<std::string> &hashes);
+
+#endif // HASH_FILE_H
@@ -0,0 +1,150 @@
+#ifndef IO_SHARD_H
+#define IO_SHARD_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "checkpoint_board.h"
+#include "mpsc_queue.h"
+#include "network.h"
+#include "parse_args.h"
+#include "timer_wheel.h"
+
+// Seconds between HEARTBEAT pings to each worker
+constexpr int HEARTBEAT_INTERVAL_SEC = 5;
+// Longest stop() keeps sending what workers have not taken yet
+constexpr int STOP_FLUSH_MS = 5000;
+
+// What an I/O thread tells the scheduler about one of its connections.
+// Connections are named by ids that are never reused (shard = id % shards),
+// so nothing the scheduler sends can reach a later connection on the same fd.
+struct ShardEvent
+{
+    enum Kind : uint8_t
+    {
+        CONNECTED,      // TARGETS and CONACK already sent; detail = peer address
+        PACKET,         // anything but a HEARTBEAT echo, which the shard handles
+        CLOSED,         // detail = why (disconnect, timeout, ...)
+    };
+    Kind kind = PACKET;
+    uint64_t conn = 0;
+    Packet packet;
+    std::string detail;
+    std::shared_ptr<CheckpointBoard> board;     // CONNECTED over the Unix socket: where it checkpoints
+};
+
+// A packet from the scheduler for one connection
+struct Outbound
+{
+    uint64_t conn;
+    Packet packet;
+};
+
+// Crack state the I/O threads send new workers (uncracked targets only);
+// the scheduler publishes a fresh copy whenever a target is cracked
+using CrackedSnapshot = std::shared_ptr<const std::vector<bool>>;
+
+// eventfd another thread can wake a poll() with
+class Wakeup
+{
+public:
+    Wakeup();
+    int fd() const { return fd_.get(); }
+    void notify();
+    void drain();
+
+private:
+    Fd fd_;
+};
+
+// One I/O thread: its own SO_REUSEPORT listening socket (the kernel shares
+// out new connections; the first shard also owns the --unix socket), the
+// connections it accepted, their heartbeats and
+// liveness deadlines, and packet framing. Sockets are never waited on: what
+// a connection has not sent whole stays in its inbound buffer, and what it
+// has not taken yet in its outbound buffer until poll() says it can, so one
+// slow worker never holds up the rest of the shard. The scheduler hears from every
+// shard through one MPSC queue of event batches, and answers each shard
+// through its own queue, one batch per scheduling round, so neither side
+// ever takes a lock or waits for the other.
+class IoShard
+{
+public:
+    IoShard(size_t index, size_t count, const Args &args, const std::string &attack, const CrackedSnapshot &cracked,
+            MpscQueue<std::vector<ShardEvent>> &events, Wakeup &scheduler);
+    ~IoShard();
+
+    IoShard(const IoShard &) = delete;
+    IoShard &operator=(const IoShard &) = delete;
+
+    // Sends the batch in order (to connections still open)
+    void post(std::vector<Outbound> batch);
+    // Sends everything posted so far, then closes every connection
+    void stop();
+
+    size_t peers() const { return peers_.load(std::memory_order_relaxed); }
+    // Sum of the connections' smoothed heartbeat round trips, and how many have one
+    void rtt(double &sum_ms, size_t &measured) const;
+
+private:
+    struct Peer
+    {
+        Fd fd;
+        uint64_t conn;
+        std::chrono::steady_clock::time_point last_heard;
+        double rtt_ms = 0;
+        size_t slot = 0;                // its entry in pollfds_
+        std::vector<uint8_t> in{};      // received bytes not yet a whole packet
+        std::vector<uint8_t> out{};     // packets the socket has not taken yet
+    };
+
+    void run();
+    void accept_all(int listen_fd, bool local, std::vector<ShardEvent> &events);
+    void read(Peer &peer, std::vector<ShardEvent> &events);
+    void flush(std::vector<ShardEvent> &events);
+    // Appends a packet to the connection's outbound buffer
+    void queue(Peer &peer, const Packet &packet);
+    // Sends as much of the outbound buffer as the socket takes; false if the
+    // connection failed
+    bool write(Peer &peer);
+    void expire(std::chrono::steady_clock::time_point now, std::vector<ShardEvent> &events);
+    void close(uint64_t conn, const char *reason, std::vector<ShardEvent> &events);
+
+    const size_t index_, count_;
+    const Args &args_;
+    const std::string &attack_;
+    const CrackedSnapshot &cracked_;
+    MpscQueue<std::vector<ShardEvent>> &events_;
+    Wakeup &scheduler_;
+
+    Fd listen_fd_;
+    Fd unix_fd_;
+    Wakeup wakeup_;
+    MpscQueue<std::vector<Outbound>> outbound_;
+    std::atomic<bool> stopping_{false};
+
+    uint64_t next_serial_ = 0;
+    std::vector<pollfd> pollfds_;       // listening socket, wakeup, Unix socket if any, then connections
+    size_t first_peer_ = 2;             // index of the first connection in pollfds_
+    std::unordered_map<uint64_t, Peer> peers_by_conn_;
+    std::unordered_map<int, uint64_t> conn_by_fd_;
+    TimerWheel timers_;
+    bool compact_ = false;              // a connection was closed since pollfds_ was last cleaned
+    std::vector<uint8_t> frame_;        // scratch for serializing
+    double rtt_total_ = 0;              // kept up to date, so stats never scan the connections
+    size_t rtt_count_ = 0;
+
+    std::atomic<size_t> peers_{0};
+    std::atomic<double> rtt_sum_{0};
+    std::atomic<size_t> rtt_measured_{0};
+    std::thread thread_;
+};
+
+#endif // IO_SHARD_H
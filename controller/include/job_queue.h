@@ -0,0 +1,55 @@
+#ifndef JOB_QUEUE_H
+#define JOB_QUEUE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "parse_args.h"
+#include "scheduler.h"
+
+constexpr unsigned MAX_JOB_PRIORITY = 1000;
+// How far (in leases per unit of priority) a worker's job may run ahead of
+// the one due before the worker moves; moving costs a round trip and the
+// target list
+constexpr uint64_t JOB_MOVE_SLACK = 8;
+
+// Job queue (--jobs file): one controller serves several jobs at once, each
+// with its own targets, attack and priority, and every worker works on one
+// of them at a time. Jobs share the workers by weighted fair queuing on
+// lease grants: the next lease comes from the job with a free range that
+// has been granted the fewest leases per unit of priority, though a worker
+// only leaves a job with free ranges once it is JOB_MOVE_SLACK ahead. A
+// worker moves to another job between leases, on the same connection: its
+// WORKREQ is answered with that job's TARGETS and CONACK, and the WORKREQ
+// that follows gets the lease.
+struct Job : JobState
+{
+    Job(size_t id, Args args, unsigned priority)
+        : JobState(static_cast<uint32_t>(args.checkpoint_interval), " of job " + std::to_string(id)), id(id),
+          args(std::move(args)), priority(priority) {}
+
+    size_t id;                  // line order in the jobs file, from 1
+    Args args;                  // targets, attack, work size and checkpoint interval
+    unsigned priority;
+    std::string attack;         // CONACK payload
+    bool finished = false;      // cracked or exhausted
+};
+
+// One job per line: its options as on the command line (long names only),
+// plus --priority n (default 1). Blank lines and # comments are skipped.
+// Options that shape the whole controller are rejected, and so are jobs
+// naming a different --wordlist, --rules, --combine or --markov file than
+// an earlier job (workers hold one copy of each). Returns -1 (after printing
+// why) on a bad line.
+int load_jobs(const std::string &path, std::vector<Job> &jobs);
+
+// The unfinished job with a free range that has had the fewest leases for
+// its priority (the earlier job on ties); jobs.size() if none has one
+size_t fairest_job(const std::vector<Job> &jobs);
+// Whether a worker on job current should move to job due
+bool should_move(const Job &current, const Job &due);
+bool has_free_range(const Job &job);
+
+#endif // JOB_QUEUE_H
@@ -0,0 +1,66 @@
+#ifndef LEASES_H
+#define LEASES_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+// A lease far slower than the cluster's median lease is a straggler
+constexpr double STRAGGLER_FACTOR = 4.0;
+// Leases younger than this are never stragglers (start-up, first checkpoint)
+constexpr int STRAGGLER_MIN_AGE_SEC = 5;
+// Rates the median needs before anything is judged against it
+constexpr size_t STRAGGLER_MIN_SAMPLES = 3;
+// Finished leases whose rates still count towards the median
+constexpr size_t RECENT_LEASE_RATES = 64;
+
+// Who holds each range lease and how fast it moves. A lease's rate is the
+// work done its last CHECK reported, in candidates per second since the
+// grant; the cluster median covers the leases still out and the most recent
+// finished ones, so it holds up at the tail of the job when few are out.
+// A lease is straggling once even the best case (a checkpoint interval of
+// unreported work) leaves it STRAGGLER_FACTOR below the median, so one
+// that stops reporting altogether keeps falling behind.
+class LeaseTracker
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit LeaseTracker(uint32_t checkpoint_interval) : checkpoint_interval_(checkpoint_interval) {}
+
+    void grant(size_t range, uint64_t client, Clock::time_point now);
+    // CHECK: done is the lease's work so far; returns how much it grew
+    uint32_t report(size_t range, uint64_t client, uint32_t done, Clock::time_point now);
+    // WORKFIN or cancel; false if client held no lease on range
+    bool release(size_t range, uint64_t client);
+    // Disconnect or timeout: ends every lease of client and returns their ranges
+    std::vector<size_t> drop(uint64_t client);
+
+    // Ranges were reshaped: moved[old index] is the new one
+    void renumber(const std::vector<size_t> &moved);
+
+    std::vector<uint64_t> holders(size_t range) const;
+    // Ranges held by one straggling lease (none of them by client), slowest first
+    std::vector<size_t> stragglers(uint64_t client, Clock::time_point now) const;
+
+private:
+    struct Lease
+    {
+        uint64_t client;
+        Clock::time_point start;
+        Clock::time_point reported;     // time of the last CHECK
+        uint32_t done;
+    };
+
+    static double rate(const Lease &lease);
+    void remember(const Lease &lease);
+
+    uint32_t checkpoint_interval_;
+    std::unordered_map<size_t, std::vector<Lease>> leases_;
+    std::deque<double> recent_rates_;
+};
+
+#endif // LEASES_H
@@ -0,0 +1,38 @@
+#ifndef MASK_H
+#define MASK_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr size_t MASK_CUSTOM_CHARSETS = 4;
+constexpr size_t MAX_MASK_LEN = 64;
+
+// hashcat-style mask: one charset per position.
+//   ?l ?u ?d ?s  lower, upper, digit, special    ?a  all of those
+//   ?h ?H        lower / upper hex digits        ?1 - ?4  custom charsets
+//   ??           a literal '?'                   anything else is literal
+// Custom charsets are written the same way (built-ins and literals).
+// Candidate i is i in mixed radix, last position least significant.
+class Mask
+{
+public:
+    // Throws std::invalid_argument for bad syntax, an undefined ?1-?4, or a
+    // keyspace over 2^64
+    Mask(const std::string &mask, const std::array<std::string, MASK_CUSTOM_CHARSETS> &custom);
+
+    size_t length() const { return positions_.size(); }
+    uint64_t keyspace() const { return keyspace_; }
+    const std::string &charset(size_t pos) const { return positions_[pos]; }
+
+    // Candidate number index, and its per-position digits
+    void decode(uint64_t index, std::string &candidate, std::vector<uint8_t> &digits) const;
+
+private:
+    std::vector<std::string> positions_;
+    uint64_t keyspace_ = 1;
+};
+
+#endif // MASK_H
@@ -0,0 +1,59 @@
+#ifndef MPSC_QUEUE_H
+#define MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+// Unbounded lock-free queue for many producers and one consumer (Vyukov's
+// node-based MPSC): push is one atomic exchange and never waits on other
+// producers or the consumer. Only the consumer thread may call pop.
+template <typename T>
+class MpscQueue
+{
+public:
+    MpscQueue() : head_(new Node), tail_(head_.load(std::memory_order_relaxed)) {}
+    ~MpscQueue()
+    {
+        T drained;
+        while (pop(drained))
+        {
+        }
+        delete tail_;
+    }
+
+    MpscQueue(const MpscQueue &) = delete;
+    MpscQueue &operator=(const MpscQueue &) = delete;
+
+    void push(T value)
+    {
+        Node *node = new Node;
+        node->value = std::move(value);
+        Node *prev = head_.exchange(node, std::memory_order_acq_rel);
+        prev->next.store(node, std::memory_order_release);
+    }
+
+    // False if empty, or if a push is halfway through (its item shows up
+    // on a later pop)
+    bool pop(T &out)
+    {
+        Node *next = tail_->next.load(std::memory_order_acquire);
+        if (!next)
+            return false;
+        out = std::move(next->value);
+        delete tail_;
+        tail_ = next;
+        return true;
+    }
+
+private:
+    struct Node
+    {
+        std::atomic<Node *> next{nullptr};
+        T value{};
+    };
+
+    std::atomic<Node *> head_;  // last pushed; producers swap themselves in
+    Node *tail_;                // consumer's; its value was already popped
+};
+
+#endif // MPSC_QUEUE_H
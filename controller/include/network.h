@@ -18,6 +18,7 @@
 #include "parse_args.h"
 
 constexpr int DEFAULT_RETRIES = 3;
+constexpr int SEND_WAIT_MS = 5000;      // longest send_all waits on a full socket buffer
 constexpr int MAX_EPOLL_EVENTS = 100;
 
 constexpr size_t HEADER_SIZE = 6;
@@ -61,7 +62,13 @@ enum Header_Flags : uint8_t {
     WORKREQ,
     WORKFIN,
     CHECK,
-    PWDFND
+    PWDFND,
+    TARGETS,
+    CANCEL,
+    HEARTBEAT,
+    STRIDE,
+    DRAIN,
+    WORKMORE
 };
 
 struct Header {
@@ -76,8 +83,54 @@ struct Packet {
     std::vector<uint8_t> payload;
 };
 
+// Multi-target jobs: on connect the controller streams the uncracked targets
+// as TARGETS packets (newline-separated hashes; the 32-bit id of the first is
+// split across work_size (high) and checkpoint_interval (low), the rest
+// follow consecutively), then sends CONACK to mark the end of the list.
+// A job queue (--jobs) may send another list and CONACK between leases to
+// move the worker to another job; its CONACKs have work_size 1, so the
+// worker asks for more work once its targets are all cracked instead of
+// leaving.
+// PWDFND carries the cracked target's id in the same two fields, and CHECK
+// the work its lease has done so far (which a relay's leases run past 16 bits).
+// CANCEL names a range lease (its token) whose other copy finished first;
+// the worker stops hashing it and reports where it got to with WORKFIN.
+// HEARTBEAT carries the controller's send time (steady clock, microseconds,
+// hex); the worker's network thread echoes it straight back, which proves
+// the worker alive however slow its hashing and measures the round trip.
+// STRIDE (--strided) replaces WORK and CHECK. From the controller it lists
+// the worker's lanes ("cursor:end*stride" tokens) for generation work_size,
+// checkpoint_interval counting the packets still to follow; an empty one
+// asks the worker to stop and report. From the worker it lists where each
+// lane got to, work_size again the generation, checkpoint_interval 1 once
+// the lanes are stopped or done (0 for a progress report).
+// DRAIN is a worker leaving on SIGTERM. It sends one DRAIN per lease still
+// running: the work that lease did, in the same two fields as CHECK, and
+// where it stopped. The next candidate is the token's, so the range is
+// re-leased from there. Strided lanes are reported with a final STRIDE
+// instead. An empty DRAIN comes last, and then the worker disconnects.
+// WORKMORE carries the leading tokens of a WORK that does not fit one
+// payload; the WORK that follows carries the rest, and the lease is all of
+// them, so a worker gets a token for each of its threads.
+constexpr size_t MAX_PAYLOAD = 255;
+
+inline uint32_t header_target_id(const Header &header)
+{
+    return (static_cast<uint32_t>(header.work_size) << 16) | header.checkpoint_interval;
+}
+
+inline void set_header_target_id(Header &header, uint32_t id)
+{
+    header.work_size = static_cast<uint16_t>(id >> 16);
+    header.checkpoint_interval = static_cast<uint16_t>(id & 0xffff);
+}
+
 bool make_fd_non_blocking(int fd);
-int create_listen_socket(int port);
+// reuse_port lets several sockets listen on one port, the kernel spreading
+// new connections across them
+int create_listen_socket(int port, bool reuse_port = false);
+// Listening Unix domain socket at path, replacing a stale one
+int create_unix_listen_socket(const std::string &path);
 
 int send_all(int fd, const uint8_t* data, size_t len);
 int recv_all(int fd, uint8_t* buffer, size_t len);
@@ -86,8 +139,27 @@ ssize_t recv_full_packet(int fd, std::vector<uint8_t> &buffer);
 ssize_t serialize(const Packet &packet, std::vector<uint8_t> &buffer);
 int deserialize(const uint8_t *buffer, size_t len, Packet &result);
 
-int send_conack(int client_fd, int retries, const Args &args);
-int send_work(int client_fd, int retries, const Args &args, const std::vector<std::string> &prefixes);
-int send_kill(int client_fd, int retries);
+int send_packet(int client_fd, int retries, const Packet &pkt);
+// The TARGETS packets of the uncracked hashes, then the CONACK; attack goes
+// in the CONACK payload: empty for brute force, "wordlist <size hex>"
+std::vector<Packet> conack_packets(const std::vector<std::string> &hashes, const std::vector<bool> &cracked,
+                                   const std::string &attack, bool queue);
+
+// Packets the scheduler hands to the I/O threads to send
+// A lease's WORK: WORKMORE packets for the tokens one payload cannot hold,
+// then the WORK with the rest
+std::vector<Packet> work_packets(const Args &args, const std::vector<std::string> &prefixes);
+Packet kill_packet();
+Packet cancel_packet(const std::string &token);
+Packet heartbeat_packet(uint64_t sent_us);
+// A worker's lanes for a strided generation, as many packets as they take;
+// no lanes is the request to stop and report
+std::vector<Packet> stride_packets(uint16_t generation, const std::vector<std::string> &lanes);
+
+// Packets a relay sends upstream, as a worker would
+Packet workreq_packet(uint8_t num_threads);
+Packet check_packet(uint32_t work_done, const std::string &token);
+Packet workfin_packet(const std::string &token);
+Packet pwdfnd_packet(uint32_t target_id, const std::string &password);
 
 #endif // NETWORK_H
@@ -6,24 +6,48 @@
 #include <vector>
 #include <string>
 #include <sstream>
-#include <regex>
+#include <string_view>
+#include <algorithm>
+#include <array>
 
 constexpr int DEFAULT_PORT = 8080;
 constexpr int DEFAULT_WORK_SIZE = 10000;
 constexpr int DEFAULT_CHECKPOINT_INTERVAL = 500; 
 constexpr int DEFAULT_TIMEOUT = 60; 
+constexpr unsigned MAX_IO_THREADS = 64;
+constexpr unsigned AUTO_IO_THREADS = 8;     // at most this many by default, one per core
+const std::string DEFAULT_POTFILE = "controller.potfile";
 const std::string DEFAULT_HASH_SIX = "$6$Ks6ZfrXQARwpF3aH$6KBhLiqD1WNWz9/hStVgGzRj1zzTw6DZgkebDP2GR7JT68QLe8ZshpgYCs91ZMDBl9KfI4hyqiv2ppXnBWt4o1";
 
 struct Args {
     int port                = DEFAULT_PORT; 
+    std::string unix_socket;            // also listen here, for workers on this machine
     int work_size           = DEFAULT_WORK_SIZE; 
     int checkpoint_interval = DEFAULT_CHECKPOINT_INTERVAL; 
     int timeout             = DEFAULT_TIMEOUT; 
-    std::string hash        = DEFAULT_HASH_SIX;
+    std::vector<std::string> hashes;    // --hash may repeat; DEFAULT_HASH_SIX if none given
+    std::string hash_file;              // one hash per line, appended to hashes
+    std::string wordlist;               // dictionary attack instead of brute force
+    std::string rules;                  // mangling rules applied to every word
+    std::string mask;                   // mask attack, e.g. ?u?l?l?l?d?d
+    std::array<std::string, 4> charsets;    // custom charsets ?1-?4 of the mask
+    std::string markov;                 // corpus whose statistics order the mask
+    std::string combine;                // combinator: every wordlist word + every word of this list
+    bool mask_first = false;            // hybrid: mask + word instead of word + mask
+    unsigned min_length = 1;            // brute force lengths, shortest first;
+    unsigned max_length = 0;            // 0 = longest that can be indexed
+    bool depth_first = false;           // brute force: old per-prefix walk, unbounded length
+    unsigned io_threads = 0;            // socket threads; 0 = one per core up to AUTO_IO_THREADS
+    std::string upstream;               // relay: "ip:port" of the controller the job comes from
+    bool strided = false;               // deal lanes once instead of leasing ranges
+    std::string jobs_file;              // serve the queue of jobs listed here instead
+    std::string potfile = DEFAULT_POTFILE;  // cracks of every run; empty = --no-potfile
+    std::string trace_path;     // empty = tracing disabled
 };
 
 void print_args(const Args &args);
 int parse_args(int argc, char *argv[], Args &args);
 int is_valid_hash(const std::string &hash);
+int is_valid_hash(const char *hash, size_t len);
 
 #endif // PARSE_ARGS_H
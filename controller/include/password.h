@@ -11,4 +11,12 @@ const char CHAR_SET[] =
     
 constexpr auto CHAR_SET_SIZE = sizeof(CHAR_SET) - 1;
 
+// Built-in mask charsets (?l ?u ?d ?s, ?a is all four, ?h / ?H hex digits)
+const char CHARSET_LOWER[] = "abcdefghijklmnopqrstuvwxyz";
+const char CHARSET_UPPER[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+const char CHARSET_DIGIT[] = "0123456789";
+const char CHARSET_SPECIAL[] = " !\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+const char CHARSET_HEX_LOWER[] = "0123456789abcdef";
+const char CHARSET_HEX_UPPER[] = "0123456789ABCDEF";
+
 #endif // PASSWORD_H
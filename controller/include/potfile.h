@@ -0,0 +1,35 @@
+#ifndef POTFILE_H
+#define POTFILE_H
+
+#include <cstddef>
+#include <string>
+#include <unordered_map>
+
+#include "network.h"
+
+// Every target ever cracked, as hash:plaintext lines (split at the first
+// colon; crypt hashes have none). The file is only ever appended to, one
+// write(2) per crack on an O_APPEND descriptor, so controllers sharing it
+// never interleave lines and a crash loses at most the crack in flight.
+// The whole file is indexed in memory when it is opened, so every target
+// is looked up before any work is scheduled for it.
+class Potfile
+{
+public:
+    // Loads path, creating it if missing; -1 (after printing why) if it
+    // can't be read or opened for appending
+    int open(const std::string &path);
+    bool is_open() const { return fd_.get() >= 0; }
+    // The plaintext of hash, if it was cracked before
+    bool lookup(const std::string &hash, std::string &plain) const;
+    // Records a crack, on disk at once; hashes already known are skipped
+    void add(const std::string &hash, const std::string &plain);
+    size_t size() const { return known_.size(); }
+
+private:
+    std::string path_;
+    Fd fd_;
+    std::unordered_map<std::string, std::string> known_;
+};
+
+#endif // POTFILE_H
@@ -0,0 +1,104 @@
+#ifndef RANGES_H
+#define RANGES_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "partition.h"
+
+// Range leases (wordlist byte offsets, mask keyspace indices) travel as
+// "cursor:end" in hex. Wordlist attacks with a second dimension (rules, a
+// hybrid mask's indices, byte offsets of a combinator's second list) add
+// "/inner:first:last": the lease covers that dimension's [first, last) for
+// every word, and inner is where the word at cursor resumes in it.
+// Strided lanes of an index space add "*stride": every stride-th index from
+// cursor up to end (cursor stays on the progression, so it passes end when
+// the lane is done).
+struct RangeToken
+{
+    uint64_t cursor = 0;
+    uint64_t end = 0;
+    uint64_t inner = 0;
+    uint64_t inner_begin = 0;
+    uint64_t inner_end = 0;     // 0 = no second dimension
+    uint64_t stride = 1;
+};
+// Largest index space strided lanes may cover: a done lane's cursor, one
+// stride past its last index, must still fit
+constexpr uint64_t MAX_STRIDED_KEYSPACE = UINT64_MAX / 2;
+
+// One partition of a range-based attack. position is where the next lease
+// resumes; the range is COMPLETED once a worker finishes it (WORKFIN at end).
+// [begin, position.cursor) is confirmed covered.
+struct LeaseRange
+{
+    RangeToken position;
+    PartitionProgress status;
+    uint64_t begin;
+};
+
+// [begin, end) along one dimension of a range attack
+using IndexRange = std::pair<uint64_t, uint64_t>;
+
+// About a thousand leases along the outer dimension (words or mask indices),
+// and a few dozen along the inner one, so even 1M x 1M word combinations
+// schedule as ~64k leases
+constexpr uint64_t TARGET_RANGES = 1024;
+constexpr uint64_t TARGET_INNER_CHUNKS = 64;
+
+// Splits [0, keyspace) into about target ranges
+std::vector<IndexRange> split_keyspace(uint64_t keyspace, uint64_t target);
+
+// Brute force in length order: CHAR_SET strings of min_length..max_length
+// as one index space, all of length L before any of L + 1. Each length is
+// split on its own so short lengths still spread across the cluster; with
+// lowest-first leasing every length is finished before the next starts.
+std::vector<LeaseRange> create_length_ranges(unsigned min_length, unsigned max_length, uint64_t &keyspace);
+// Longest max_length whose index space from min_length stays within limit
+unsigned max_indexable_length(unsigned min_length, uint64_t limit = UINT64_MAX);
+
+// Every outer range paired with every inner chunk, outer-major (just the
+// outer ranges if there is no inner dimension). Only the tiles are listed,
+// never the candidates in them.
+std::vector<LeaseRange> cross_ranges(const std::vector<IndexRange> &outer, const std::vector<IndexRange> &inner);
+
+// Leases up to num_ranges ranges as "cursor:end" tokens, adding their
+// indices to leased. Ranges not out go first, lowest
+// first; only once none are left does a range already out get a second
+// copy, taken from backups (ranges of straggling leases).
+std::vector<std::string> generate_work_ranges(std::vector<LeaseRange> &ranges, const std::vector<size_t> &backups,
+                                              uint8_t num_ranges, std::vector<size_t> &leased);
+
+// Index of the range ending at (end, inner_end), or ranges.size() if none does
+size_t find_range(const std::vector<LeaseRange> &ranges, uint64_t end, uint64_t inner_end);
+// Adds ranges, keeping the (end, inner_end) order, and removes those marked
+// in removed (indexed like ranges before the call). Returns where each old
+// range went, SIZE_MAX for removed ones, for whoever holds indices.
+std::vector<size_t> reshape_ranges(std::vector<LeaseRange> &ranges, std::vector<LeaseRange> added,
+                                   const std::vector<bool> &removed);
+// Splits what is left of a range into about parts pieces along one
+// dimension (inner: every word keeps all of the outer range), none smaller
+// than a lease is worth
+std::vector<LeaseRange> split_range(const RangeToken &range, bool inner, uint64_t parts);
+
+// Applies a CHECK or WORKFIN position to the range it belongs to, keeping
+// the furthest of several copies, and sets index to it; -1 if no range matches
+int update_range(const std::string &token, std::vector<LeaseRange> &ranges, size_t &index);
+// Status once a lease on the range ended: COMPLETED at its end, otherwise
+// IN_PROGRESS while another copy is still out (held), else READY. Only a
+// WORKFIN ends a lease: a worker that checkpoints its last candidate is
+// still about to report, and must not find the job gone.
+void settle_range(LeaseRange &range, bool held);
+bool ranges_exhausted(const std::vector<LeaseRange> &ranges);
+
+// Confirmed-covered share of the attack, 0 to 1: every range's covered part
+// weighted by its size (outer length x inner length). Within a word only
+// the inner items done so far count, as if the word were one unit long.
+double ranges_coverage(const std::vector<LeaseRange> &ranges);
+
+std::string format_range(const RangeToken &range);
+bool parse_range(const std::string &token, RangeToken &range);
+
+#endif // RANGES_H
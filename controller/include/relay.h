@@ -0,0 +1,90 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "io_shard.h"
+#include "network.h"
+#include "ranges.h"
+
+// Relay mode (--upstream): the controller takes its job from another
+// controller instead of the command line. Upstream sees one worker asking
+// for many ranges at a time; the relay splits each among its own workers
+// and reports back per upstream range (a CHECK at most every
+// RELAY_REPORT_SEC, WORKFIN once every piece is done), so the root's load
+// grows with relays rather than with the cores behind them. A relay runs
+// its ranges to the end: the root's work size is for single workers.
+
+// Upstream's events reach the scheduler as this connection, an id no I/O
+// shard hands out
+constexpr uint64_t UPSTREAM_CONN = 0;
+// Seconds between CHECKs upstream for one range
+constexpr int RELAY_REPORT_SEC = 2;
+
+// Which dimension upstream ranges are split along. Only index dimensions
+// split (mask and brute force indices, rules, a hybrid's mask): wordlist
+// byte offsets must split on line starts, which only copies of the files
+// know, so plain wordlist and combinator ranges go out whole.
+enum class RelaySplit
+{
+    NONE,
+    OUTER,
+    INNER,
+};
+// From the attack line of the CONACK
+RelaySplit relay_split(const std::string &attack);
+
+// A range leased from upstream and the local ranges it was split into
+struct UpstreamLease
+{
+    RangeToken range;           // as granted
+    RelaySplit split;
+    std::vector<std::pair<uint64_t, uint64_t>> pieces;  // (end, inner_end) of each, in split order
+    uint64_t done = 0;          // candidates its pieces' CHECKs reported
+    std::string reported;       // last position and work done sent upstream
+    uint64_t reported_done = 0;
+    std::chrono::steady_clock::time_point last_report;
+};
+
+// Where upstream may be told the lease got to, everything before it being
+// covered by the pieces; cursor reaches the range's end once all are done
+RangeToken upstream_position(const UpstreamLease &lease, const std::vector<LeaseRange> &ranges);
+
+// The relay's connection to its upstream controller. The scheduler sends
+// from its own thread; a reader thread queues what arrives as events of
+// UPSTREAM_CONN and answers HEARTBEATs itself, so a busy scheduler never
+// looks dead upstream.
+class Upstream
+{
+public:
+    Upstream() = default;
+    ~Upstream();
+
+    Upstream(const Upstream &) = delete;
+    Upstream &operator=(const Upstream &) = delete;
+
+    // address is "ip:port"; -1 (after printing why) if it can't connect
+    int connect(const std::string &address);
+    // Reads the job: the targets with their upstream ids, and the attack
+    // line; -1 if the connection fails first
+    int handshake(std::vector<std::string> &hashes, std::vector<uint32_t> &ids, std::string &attack);
+    void start(MpscQueue<std::vector<ShardEvent>> &events, Wakeup &scheduler);
+    int send(const Packet &pkt);
+    void stop();
+
+private:
+    void run(MpscQueue<std::vector<ShardEvent>> &events, Wakeup &scheduler);
+
+    Fd fd_;
+    std::mutex send_mutex_;
+    std::atomic<bool> stopping_{false};
+    std::thread thread_;
+};
+
+#endif // RELAY_H
@@ -0,0 +1,133 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "io_shard.h"
+#include "leases.h"
+#include "network.h"
+#include "parse_args.h"
+#include "ranges.h"
+
+// Scheduling that a single job and a job queue (--jobs) share: the state of
+// one job's range leases and targets, what each packet from a worker does
+// to it, and the scheduler thread's side of the I/O threads.
+
+// Packets go out through the scheduler's per-shard outbox
+using SendPacket = std::function<void(uint64_t client, Packet packet)>;
+
+// One job's leases and crack state
+struct JobState
+{
+    JobState(uint32_t checkpoint_interval, std::string name)
+        : name(std::move(name)), leases(checkpoint_interval) {}
+
+    std::string name;           // " of job 2" in log lines; empty for the controller's only job
+    std::vector<LeaseRange> ranges;
+    LeaseTracker leases;
+    std::vector<bool> cracked;
+    std::vector<std::string> found;
+    size_t targets_left = 0;
+    uint64_t granted = 0;       // leases handed out
+    uint64_t candidates = 0;    // work done the CHECKs reported
+    bool start_time_set = false;
+    std::chrono::steady_clock::time_point start_time, end_time;
+};
+
+// Leases up to num_threads free ranges to client (or, with none free, a
+// backup copy of a straggler's) and sends them as WORK; the tokens sent,
+// none if there is nothing to hand out
+std::vector<std::string> lease_ranges(JobState &job, const Args &args, uint64_t client, uint8_t num_threads,
+                                      const SendPacket &send);
+// WORKFIN: client's lease ends at token; the first copy of a range to
+// finish cancels the others. The range's index, ranges.size() if the
+// token is bad.
+size_t finish_lease(JobState &job, uint64_t client, const std::string &token, const SendPacket &send);
+// CHECK: client's lease is at token after done candidates; grown is the
+// work since its last CHECK. The range's index, ranges.size() if the token
+// is bad.
+size_t check_lease(JobState &job, uint64_t client, uint32_t done, const std::string &token, uint32_t &grown);
+// Disconnect, timeout or drain: each range client held goes to its other
+// copy if there is one, otherwise READY again
+void drop_leases(JobState &job, uint64_t client);
+// The job is over: every worker still on it stops its leases
+void cancel_leases(JobState &job, const SendPacket &send);
+// PWDFND: false if the target is unknown or already cracked
+bool record_crack(JobState &job, size_t id, const std::string &password);
+
+// The scheduler thread's side of the I/O threads: it starts the shards,
+// hears their events, tracks the connected workers and their checkpoint
+// boards, and sends each round's packets as one batch per shard. A board
+// entry reaches the packet handler as the CHECK it stands in for, and a
+// worker leaving on SIGTERM hands each lease back as its last CHECK and a
+// WORKFIN at the exact position, so the ranges go out again this round
+// instead of after a timeout and from the last checkpoint.
+class Dispatcher
+{
+public:
+    struct Handlers
+    {
+        std::function<void(const ShardEvent &)> connected;
+        std::function<void(uint64_t client, const Packet &)> packet;
+        std::function<void(uint64_t client, const char *reason)> gone;     // closed or drained
+        std::function<void(const ShardEvent &)> upstream;                  // a relay's upstream link
+    };
+
+    // args and attack are what the shards greet new workers with
+    Dispatcher(const Args &args, const std::string &attack, const std::vector<bool> &cracked);
+
+    void on_events(Handlers handlers) { handlers_ = std::move(handlers); }
+
+    // Waits for events (or the next look at the boards) and reads the boards
+    void wait();
+    // The next batch of events, false if there is none
+    bool pop(std::vector<ShardEvent> &batch) { return events_.pop(batch); }
+    void handle(const ShardEvent &event);
+
+    // New workers get the targets still open
+    void publish(const std::vector<bool> &cracked);
+    void send(uint64_t client, Packet packet);
+    // Ends the job on every connected worker
+    void kill_all();
+    // Hands this round's packets to the I/O threads
+    void flush();
+    // Sends what is posted, then closes every connection
+    void stop();
+
+    const std::unordered_set<uint64_t> &clients() const { return clients_; }
+    void rtt(double &sum_ms, size_t &measured) const;
+    size_t io_threads() const { return shards_.size(); }
+    int connects() const { return connects_; }
+    int packets() const { return packets_; }
+
+    // For a relay's upstream link, which reports as a connection of its own
+    MpscQueue<std::vector<ShardEvent>> &events() { return events_; }
+    Wakeup &wakeup() { return wakeup_; }
+
+private:
+    void read_board(uint64_t client);
+    void drain(uint64_t client, const Packet &pkt);
+
+    MpscQueue<std::vector<ShardEvent>> events_;
+    Wakeup wakeup_;
+    CrackedSnapshot published_;
+    std::vector<std::unique_ptr<IoShard>> shards_;
+    std::vector<std::vector<Outbound>> outbox_;
+    Handlers handlers_;
+    std::unordered_set<uint64_t> clients_;
+    // Checkpoint boards of workers on this machine, with the entry last
+    // read from each slot
+    std::unordered_map<uint64_t, std::pair<std::shared_ptr<CheckpointBoard>, std::vector<uint32_t>>> boards_;
+    int connects_ = 0;
+    int packets_ = 0;
+};
+
+#endif // SCHEDULER_H
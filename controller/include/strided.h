@@ -0,0 +1,74 @@
+#ifndef STRIDED_H
+#define STRIDED_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "ranges.h"
+
+// Strided mode (--strided): instead of leasing ranges, the controller deals
+// the index space out as lanes, arithmetic progressions every worker walks
+// on its own, reporting where each got to every STRIDE_REPORT_SEC. Lanes
+// are only dealt again when membership changes: a worker joins, leaves, or
+// runs out. Then every worker holding lanes is asked to stop and report
+// exactly where it is, and once all have, the remaining lanes are split
+// (a lane of stride s becomes two of 2s) until there is one per thread and
+// dealt out, longest first to the least loaded worker per thread. Lanes
+// step past their end when done, so the index space must stay below 2^63.
+// Seconds between a worker's progress reports on its lanes
+constexpr int STRIDE_REPORT_SEC = 10;
+
+class StridePlan
+{
+public:
+    explicit StridePlan(uint64_t keyspace);
+
+    // WORKREQ: a new worker, or one whose lanes are done
+    void join(uint64_t client, uint8_t threads);
+    // Disconnect or timeout: its lanes continue from its last report
+    void leave(uint64_t client);
+    // A lane's position from a STRIDE report; false if not a current lane
+    bool report(uint64_t client, uint16_t generation, const std::string &token);
+    // The worker's lanes are stopped (or done) at what it last reported
+    void stopped(uint64_t client);
+
+    // Membership changed since the lanes were last dealt, and no deal is
+    // under way
+    bool wants_deal() const { return changed_ && !syncing_; }
+    // Starts a deal; returns the workers that must stop first
+    std::vector<uint64_t> start_sync();
+    // All of them have stopped
+    bool ready() const { return syncing_ && awaiting_.empty(); }
+    // Deals the remaining lanes; returns the tokens of every worker that got any
+    std::vector<std::pair<uint64_t, std::vector<std::string>>> deal();
+
+    uint16_t generation() const { return generation_; }
+    // Indices reported done, and their share of the index space
+    uint64_t covered() const;
+    double coverage() const;
+    bool exhausted() const;
+
+private:
+    struct Member
+    {
+        uint8_t threads = 1;
+        std::vector<RangeToken> lanes;
+        bool running = false;
+    };
+
+    static uint64_t remaining(const RangeToken &lane);
+
+    uint64_t keyspace_;
+    uint16_t generation_ = 0;
+    std::unordered_map<uint64_t, Member> members_;
+    std::vector<RangeToken> spare_;     // lanes nobody holds
+    std::unordered_set<uint64_t> awaiting_;
+    bool changed_ = false;
+    bool syncing_ = false;
+};
+
+#endif // STRIDED_H
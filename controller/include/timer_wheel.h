@@ -0,0 +1,61 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+constexpr size_t WHEEL_LEVELS = 4;
+constexpr unsigned WHEEL_SLOT_BITS = 6;     // 64 slots per level
+constexpr size_t WHEEL_SLOTS = size_t(1) << WHEEL_SLOT_BITS;
+constexpr int WHEEL_TICK_MS = 100;          // 4 levels of 64 reach ~19 days
+
+// What a connection timer is for
+enum class TimerKind : uint8_t
+{
+    HEARTBEAT,      // time to ping the worker
+    LIVENESS,       // the worker must have been heard from since
+};
+
+// A timer of one connection (by its never-reused id, not its fd)
+struct ConnectionTimer
+{
+    uint64_t conn;
+    TimerKind kind;
+};
+
+// Hierarchical timing wheel: level n has WHEEL_SLOTS slots of
+// WHEEL_SLOTS^n ticks each. Scheduling and expiry are O(1); a timer moves
+// down a level at most once per level as its time comes closer, and only
+// the slots of ticks that passed are ever looked at. There is no cancel:
+// owners check a fired timer is still wanted (connection, deadline).
+class TimerWheel
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit TimerWheel(Clock::time_point start) : start_(start) {}
+
+    // Times past the wheel's reach are clamped to it
+    void schedule(Clock::time_point when, const ConnectionTimer &timer);
+    // Appends every timer due by now to expired, earliest tick first
+    void advance(Clock::time_point now, std::vector<ConnectionTimer> &expired);
+
+private:
+    struct Entry
+    {
+        uint64_t due;       // tick
+        ConnectionTimer timer;
+    };
+
+    uint64_t tick_of(Clock::time_point when) const;
+    void insert(const Entry &entry);
+
+    Clock::time_point start_;
+    uint64_t current_ = 0;      // last tick processed
+    std::array<std::array<std::vector<Entry>, WHEEL_SLOTS>, WHEEL_LEVELS> slots_;
+};
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,23 @@
+#ifndef WORDLIST_H
+#define WORDLIST_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ranges.h"
+
+// Rules in a rules file: every line that is neither blank nor a '#' comment,
+// matching how workers number them. Returns -1 if the file can't be read.
+int count_rules(const std::string &path, uint32_t &count);
+
+// [0, rule_count) in chunks of 256 rules
+std::vector<IndexRange> rule_chunks(uint32_t rule_count);
+
+// Splits the file into about target ranges of whole lines (4 KB to 64 MB
+// each). Only a page around each split point is read, so this is instant
+// even for 10+ GB lists. Returns an empty vector (and prints why) if the
+// file can't be read.
+std::vector<IndexRange> split_lines(const std::string &path, uint64_t target, uint64_t &file_size);
+
+#endif // WORDLIST_H
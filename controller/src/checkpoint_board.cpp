@@ -0,0 +1,96 @@
+#include "checkpoint_board.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstring>
+
+std::string CheckpointBoard::board_name(pid_t pid)
+{
+    return "/pwcrack-board-" + std::to_string(pid);
+}
+
+std::unique_ptr<CheckpointBoard> CheckpointBoard::create(pid_t pid)
+{
+    auto name = board_name(pid);
+    ::shm_unlink(name.c_str()); // left by a crashed worker whose pid this reuses
+    Fd fd(::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600));
+    if (fd.get() < 0 || ::ftruncate(fd.get(), sizeof(Layout)) != 0)
+    {
+        std::cerr << "Failed to create checkpoint board " << name << ": " << std::strerror(errno) << "\n";
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+    void *mapped = ::mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (mapped == MAP_FAILED)
+    {
+        std::cerr << "Failed to map checkpoint board " << name << ": " << std::strerror(errno) << "\n";
+        ::shm_unlink(name.c_str());
+        return nullptr;
+    }
+    // ftruncate zero-fills: not attached, every slot at seq 0
+    return std::unique_ptr<CheckpointBoard>(new CheckpointBoard(static_cast<Layout *>(mapped), name));
+}
+
+std::unique_ptr<CheckpointBoard> CheckpointBoard::attach(pid_t pid)
+{
+    auto name = board_name(pid);
+    Fd fd(::shm_open(name.c_str(), O_RDWR, 0));
+    struct stat st;
+    if (fd.get() < 0 || ::fstat(fd.get(), &st) != 0 || static_cast<size_t>(st.st_size) != sizeof(Layout))
+    {
+        return nullptr; // a worker that checkpoints over the socket
+    }
+    void *mapped = ::mmap(nullptr, sizeof(Layout), PROT_READ | PROT_WRITE, MAP_SHARED, fd.get(), 0);
+    if (mapped == MAP_FAILED)
+    {
+        return nullptr;
+    }
+    // Both ends hold the mapping now; the name only leaks if one crashes
+    ::shm_unlink(name.c_str());
+    auto board = std::unique_ptr<CheckpointBoard>(new CheckpointBoard(static_cast<Layout *>(mapped), ""));
+    board->layout_->attached.store(1, std::memory_order_release);
+    return board;
+}
+
+CheckpointBoard::~CheckpointBoard()
+{
+    if (!name_.empty() && !attached())
+    {
+        ::shm_unlink(name_.c_str());
+    }
+    ::munmap(layout_, sizeof(Layout));
+}
+
+void CheckpointBoard::write(size_t slot, uint32_t work_done, const std::string &token)
+{
+    auto &entry = layout_->slots[slot];
+    const uint32_t seq = entry.seq.load(std::memory_order_relaxed);
+    entry.seq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    const size_t len = std::min(token.size(), MAX_PAYLOAD);
+    entry.work_done.store(work_done, std::memory_order_relaxed);
+    entry.len.store(static_cast<uint8_t>(len), std::memory_order_relaxed);
+    std::memcpy(entry.token, token.data(), len);
+    entry.seq.store(seq + 2, std::memory_order_release);
+}
+
+bool CheckpointBoard::read(size_t slot, uint32_t &seq, uint32_t &work_done, std::string &token) const
+{
+    const auto &entry = layout_->slots[slot];
+    const uint32_t before = entry.seq.load(std::memory_order_acquire);
+    if (before == seq || (before & 1))
+    {
+        return false;
+    }
+    work_done = entry.work_done.load(std::memory_order_relaxed);
+    token.assign(entry.token, entry.len.load(std::memory_order_relaxed));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (entry.seq.load(std::memory_order_relaxed) != before)
+    {
+        return false; // rewritten meanwhile; the next poll gets the newer one
+    }
+    seq = before;
+    return true;
+}
@@ -0,0 +1,173 @@
+#include "hash_file.h"
+#include "parse_args.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <numeric>
+#include <thread>
+
+namespace
+{
+    constexpr size_t MAX_HASH_LEN = 255;        // one TARGETS packet payload
+    constexpr size_t MIN_CHUNK_BYTES = 1 << 20; // not worth a thread below this
+
+    struct Chunk {
+        const char *begin;
+        const char *end;
+        std::vector<std::string> hashes;
+        size_t lines = 0;                 // every line, blank ones included
+        size_t nonblank = 0;
+        size_t malformed = 0;
+        size_t first_malformed = 0;       // 1-based within the chunk
+    };
+
+    void parse_chunk(Chunk &chunk)
+    {
+        const char *p = chunk.begin;
+        while (p < chunk.end)
+        {
+            auto nl = static_cast<const char *>(std::memchr(p, '\n', chunk.end - p));
+            const char *line_end = nl ? nl : chunk.end;
+            ++chunk.lines;
+
+            const char *start = p, *stop = line_end;
+            while (start < stop && (*start == ' ' || *start == '\t'))
+                ++start;
+            while (stop > start && (stop[-1] == '\r' || stop[-1] == ' ' || stop[-1] == '\t'))
+                --stop;
+            p = line_end + 1;
+
+            if (start == stop)
+                continue;
+            ++chunk.nonblank;
+            size_t len = stop - start;
+            if (len <= MAX_HASH_LEN && is_valid_hash(start, len))
+            {
+                chunk.hashes.emplace_back(start, len);
+            }
+            else if (chunk.malformed++ == 0)
+            {
+                chunk.first_malformed = chunk.lines;
+            }
+        }
+    }
+}
+
+int load_hash_file(const std::string &path, std::vector<std::string> &hashes, HashFileStats &stats)
+{
+    auto start_time = std::chrono::steady_clock::now();
+
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Cannot open hash file " << path << ": " << std::strerror(errno) << "\n";
+        return -1;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0)
+    {
+        std::cerr << "Cannot stat hash file " << path << ": " << std::strerror(errno) << "\n";
+        ::close(fd);
+        return -1;
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    const char *data = nullptr;
+    if (size > 0)
+    {
+        void *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            std::cerr << "Cannot map hash file " << path << ": " << std::strerror(errno) << "\n";
+            ::close(fd);
+            return -1;
+        }
+        madvise(map, size, MADV_SEQUENTIAL);
+        data = static_cast<const char *>(map);
+    }
+    ::close(fd);
+
+    // Cut at the first newline after each even split point
+    size_t threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    threads = std::max<size_t>(1, std::min(threads, size / MIN_CHUNK_BYTES));
+    std::vector<Chunk> chunks;
+    const char *end = data + size;
+    const char *p = data;
+    for (size_t t = 0; t < threads && p < end; ++t)
+    {
+        const char *cut = t + 1 == threads ? end : data + size / threads * (t + 1);
+        if (cut < p)
+            cut = p;
+        auto nl = static_cast<const char *>(std::memchr(cut, '\n', end - cut));
+        cut = nl ? nl + 1 : end;
+        chunks.push_back({p, cut, {}});
+        p = cut;
+    }
+
+    std::vector<std::thread> pool;
+    for (size_t t = 1; t < chunks.size(); ++t)
+        pool.emplace_back(parse_chunk, std::ref(chunks[t]));
+    if (!chunks.empty())
+        parse_chunk(chunks[0]);
+    for (auto &thread : pool)
+        thread.join();
+
+    size_t total = hashes.size();
+    for (const auto &chunk : chunks)
+        total += chunk.hashes.size();
+    hashes.reserve(total);
+
+    size_t line_base = 0;
+    for (auto &chunk : chunks)
+    {
+        stats.lines += chunk.nonblank;
+        stats.loaded += chunk.hashes.size();
+        if (chunk.malformed > 0 && stats.malformed == 0)
+            stats.first_malformed = line_base + chunk.first_malformed;
+        stats.malformed += chunk.malformed;
+        line_base += chunk.lines;
+        std::move(chunk.hashes.begin(), chunk.hashes.end(), std::back_inserter(hashes));
+        std::vector<std::string>().swap(chunk.hashes);
+    }
+
+    if (data)
+        munmap(const_cast<char *>(data), size);
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+    return 0;
+}
+
+size_t dedupe_hashes(std::vector<std::string> &hashes)
+{
+    // Sort positions by text (ties by position), flag every non-first copy,
+    // then compact; avoids a 50M-entry hash set
+    std::vector<uint32_t> order(hashes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        int cmp = hashes[a].compare(hashes[b]);
+        return cmp != 0 ? cmp < 0 : a < b;
+    });
+
+    std::vector<bool> duplicate(hashes.size(), false);
+    for (size_t i = 1; i < order.size(); ++i)
+    {
+        if (hashes[order[i]] == hashes[order[i - 1]])
+            duplicate[order[i]] = true;
+    }
+
+    size_t out = 0;
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        if (duplicate[i])
+            continue;
+        if (out != i)
+            hashes[out] = std::move(hashes[i]);
+        ++out;
+    }
+    size_t removed = hashes.size() - out;
+    hashes.resize(out);
+    return removed;
+}
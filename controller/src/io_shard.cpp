@@ -0,0 +1,430 @@
+#include "io_shard.h"
+
+#include <sys/eventfd.h>
+#include <sys/un.h>
+
+#include <algorithm>
+
+namespace
+{
+    // Bytes read from a connection per poll() round
+    constexpr size_t READ_BYTES = 16 * 1024;
+    // An outbound buffer this large (a long target list) is freed once sent
+    constexpr size_t KEEP_OUT_BYTES = 64 * 1024;
+
+    uint64_t heartbeat_us(std::chrono::steady_clock::time_point t)
+    {
+        return static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(t.time_since_epoch()).count());
+    }
+}
+
+Wakeup::Wakeup() : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if (fd_.get() < 0)
+    {
+        throw std::runtime_error("Error creating eventfd");
+    }
+}
+
+void Wakeup::notify()
+{
+    uint64_t one = 1;
+    // A full counter still wakes the reader, so a failed write loses nothing
+    [[maybe_unused]] auto n = ::write(fd_.get(), &one, sizeof(one));
+}
+
+void Wakeup::drain()
+{
+    uint64_t count;
+    while (::read(fd_.get(), &count, sizeof(count)) > 0)
+    {
+    }
+}
+
+IoShard::IoShard(size_t index, size_t count, const Args &args, const std::string &attack,
+                 const CrackedSnapshot &cracked, MpscQueue<std::vector<ShardEvent>> &events, Wakeup &scheduler)
+    : index_(index), count_(count), args_(args), attack_(attack), cracked_(cracked), events_(events),
+      scheduler_(scheduler), listen_fd_(create_listen_socket(args.port, count > 1)),
+      timers_(std::chrono::steady_clock::now())
+{
+    pollfds_.push_back({listen_fd_.get(), POLLIN, 0});
+    pollfds_.push_back({wakeup_.fd(), POLLIN, 0});
+    if (index == 0 && !args.unix_socket.empty())
+    {
+        unix_fd_ = Fd(create_unix_listen_socket(args.unix_socket));
+        pollfds_.push_back({unix_fd_.get(), POLLIN, 0});
+        first_peer_ = 3;
+    }
+    thread_ = std::thread(&IoShard::run, this);
+}
+
+IoShard::~IoShard()
+{
+    if (thread_.joinable())
+    {
+        stop();
+    }
+}
+
+void IoShard::post(std::vector<Outbound> batch)
+{
+    outbound_.push(std::move(batch));
+    wakeup_.notify();
+}
+
+void IoShard::stop()
+{
+    stopping_.store(true, std::memory_order_release);
+    wakeup_.notify();
+    thread_.join();
+    peers_by_conn_.clear();
+    if (unix_fd_.get() >= 0)
+    {
+        ::unlink(args_.unix_socket.c_str());
+    }
+}
+
+void IoShard::rtt(double &sum_ms, size_t &measured) const
+{
+    sum_ms += rtt_sum_.load(std::memory_order_relaxed);
+    measured += rtt_measured_.load(std::memory_order_relaxed);
+}
+
+void IoShard::run()
+{
+    std::vector<ShardEvent> events;
+    std::chrono::steady_clock::time_point stop_by{};
+    while (true)
+    {
+        // Whatever was posted before stop() is in the queue by now
+        const bool stopping = stopping_.load(std::memory_order_acquire);
+        if (poll(pollfds_.data(), pollfds_.size(), WHEEL_TICK_MS) < 0 && errno != EINTR)
+        {
+            std::cerr << "poll() failed in I/O thread " << index_ << "\n";
+            break;
+        }
+
+        if (pollfds_[0].revents & POLLIN)
+        {
+            accept_all(listen_fd_.get(), false, events);
+        }
+        if (first_peer_ > 2 && (pollfds_[2].revents & POLLIN))
+        {
+            accept_all(unix_fd_.get(), true, events);
+        }
+        // Connections accepted just now come after the current size
+        for (size_t i = first_peer_, n = pollfds_.size(); i < n; ++i)
+        {
+            if (pollfds_[i].fd == -1 || !pollfds_[i].revents)
+            {
+                continue;
+            }
+            auto &peer = peers_by_conn_.at(conn_by_fd_.at(pollfds_[i].fd));
+            if ((pollfds_[i].revents & POLLOUT) && !write(peer))
+            {
+                close(peer.conn, "send failed", events);
+                continue;
+            }
+            if (pollfds_[i].revents & (POLLIN | POLLHUP | POLLERR))
+            {
+                read(peer, events);
+            }
+        }
+        if (pollfds_[1].revents & POLLIN)
+        {
+            wakeup_.drain();
+        }
+        flush(events);
+        expire(std::chrono::steady_clock::now(), events);
+
+        if (!events.empty())
+        {
+            events_.push(std::move(events));
+            events.clear();
+            scheduler_.notify();
+        }
+        if (compact_)
+        {
+            pollfds_.erase(std::remove_if(pollfds_.begin(), pollfds_.end(),
+                                          [](const pollfd &p) { return p.fd == -1; }),
+                           pollfds_.end());
+            for (size_t i = first_peer_; i < pollfds_.size(); ++i)
+            {
+                peers_by_conn_.at(conn_by_fd_.at(pollfds_[i].fd)).slot = i;
+            }
+            compact_ = false;
+        }
+        peers_.store(peers_by_conn_.size(), std::memory_order_relaxed);
+        rtt_sum_.store(rtt_total_, std::memory_order_relaxed);
+        rtt_measured_.store(rtt_count_, std::memory_order_relaxed);
+        if (stopping)
+        {
+            // Everything posted is queued now; give the workers a while to take it
+            const auto now = std::chrono::steady_clock::now();
+            if (stop_by == std::chrono::steady_clock::time_point{})
+            {
+                stop_by = now + std::chrono::milliseconds(STOP_FLUSH_MS);
+            }
+            if (now >= stop_by || std::none_of(peers_by_conn_.begin(), peers_by_conn_.end(),
+                                               [](const auto &entry) { return !entry.second.out.empty(); }))
+            {
+                break;
+            }
+        }
+    }
+}
+
+void IoShard::accept_all(int listen_fd, bool local, std::vector<ShardEvent> &events)
+{
+    while (true)
+    {
+        sockaddr_in client_addr{};
+        socklen_t len = sizeof(client_addr);
+        int raw_fd = accept(listen_fd, local ? nullptr : (sockaddr *)&client_addr, local ? nullptr : &len);
+        if (raw_fd < 0)
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                std::cerr << "Error accepting connection (I/O thread " << index_ << ")\n";
+            }
+            return;
+        }
+        Fd client_fd(raw_fd);
+        if (!make_fd_non_blocking(client_fd.get()))
+        {
+            std::cerr << "Error making client socket non-blocking\n";
+            continue;
+        }
+
+        const uint64_t conn = ++next_serial_ * count_ + index_;
+        ShardEvent connected;
+        connected.kind = ShardEvent::CONNECTED;
+        connected.conn = conn;
+        if (local)
+        {
+            // The worker named its checkpoint board after its pid, which
+            // is also how it names the connection in traces
+            ucred peer{};
+            socklen_t cred_len = sizeof(peer);
+            if (getsockopt(client_fd.get(), SOL_SOCKET, SO_PEERCRED, &peer, &cred_len) == 0)
+            {
+                connected.board = CheckpointBoard::attach(peer.pid);
+            }
+            connected.detail = "unix:" + std::to_string(peer.pid);
+        }
+        else
+        {
+            connected.detail = std::string(inet_ntoa(client_addr.sin_addr)) + ":" +
+                               std::to_string(ntohs(client_addr.sin_port));
+        }
+        events.push_back(std::move(connected));
+
+        // Targets as of now: one cracked since is at worst found again, and
+        // the scheduler ignores the second PWDFND
+        auto cracked = std::atomic_load(&cracked_);
+        const int fd = client_fd.get();
+        const auto now = std::chrono::steady_clock::now();
+        auto &peer = peers_by_conn_.emplace(conn, Peer{std::move(client_fd), conn, now}).first->second;
+        conn_by_fd_[fd] = conn;
+        peer.slot = pollfds_.size();
+        pollfds_.push_back({fd, POLLIN, 0});
+        for (const auto &packet : conack_packets(args_.hashes, *cracked, attack_, !args_.jobs_file.empty()))
+        {
+            queue(peer, packet);
+        }
+        if (!write(peer))
+        {
+            std::cerr << "Failed to send CONACK to client " << conn << "\n";
+            close(conn, "CONACK failed", events);
+            continue;
+        }
+        timers_.schedule(now + std::chrono::seconds(HEARTBEAT_INTERVAL_SEC), {conn, TimerKind::HEARTBEAT});
+        timers_.schedule(now + std::chrono::seconds(args_.timeout), {conn, TimerKind::LIVENESS});
+    }
+}
+
+void IoShard::read(Peer &peer, std::vector<ShardEvent> &events)
+{
+    uint8_t chunk[READ_BYTES];
+    const ssize_t n = ::recv(peer.fd.get(), chunk, sizeof(chunk), 0);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+    {
+        return;
+    }
+    if (n <= 0)
+    {
+        close(peer.conn, "disconnect", events);
+        return;
+    }
+    peer.in.insert(peer.in.end(), chunk, chunk + n);
+    peer.last_heard = std::chrono::steady_clock::now();
+
+    // Every whole packet received; a partial one waits for the rest
+    size_t used = 0;
+    while (peer.in.size() - used >= HEADER_SIZE && peer.in.size() - used >= HEADER_SIZE + peer.in[used + 1])
+    {
+        ShardEvent event;
+        event.conn = peer.conn;
+        if (deserialize(peer.in.data() + used, peer.in.size() - used, event.packet) != 0)
+        {
+            close(peer.conn, "bad packet", events);
+            return;
+        }
+        used += HEADER_SIZE + event.packet.header.data_len;
+        if (event.packet.header.flags != HEARTBEAT)
+        {
+            events.push_back(std::move(event));
+            continue;
+        }
+
+        std::string echo(event.packet.payload.begin(), event.packet.payload.end());
+        const uint64_t sent_us = std::strtoull(echo.c_str(), nullptr, 16);
+        const uint64_t now_us = heartbeat_us(peer.last_heard);
+        if (sent_us == 0 || sent_us > now_us)
+        {
+            std::cerr << "Ignoring malformed HEARTBEAT from client " << peer.conn << "\n";
+            continue;
+        }
+        const double rtt_ms = std::max<uint64_t>(now_us - sent_us, 1) / 1000.0;
+        const double smoothed = peer.rtt_ms > 0 ? 0.2 * rtt_ms + 0.8 * peer.rtt_ms : rtt_ms;
+        rtt_total_ += smoothed - peer.rtt_ms;
+        rtt_count_ += peer.rtt_ms > 0 ? 0 : 1;
+        peer.rtt_ms = smoothed;
+    }
+    peer.in.erase(peer.in.begin(), peer.in.begin() + used);
+}
+
+void IoShard::flush(std::vector<ShardEvent> &events)
+{
+    // Connections with nothing queued before this round; the rest are
+    // already waiting for POLLOUT
+    std::vector<uint64_t> idle;
+    std::vector<Outbound> batch;
+    while (outbound_.pop(batch))
+    {
+        for (const auto &out : batch)
+        {
+            auto peer = peers_by_conn_.find(out.conn);
+            if (peer == peers_by_conn_.end())
+            {
+                continue; // closed before the scheduler heard
+            }
+            if (peer->second.out.empty())
+            {
+                idle.push_back(out.conn);
+            }
+            queue(peer->second, out.packet);
+        }
+    }
+    for (uint64_t conn : idle)
+    {
+        if (!write(peers_by_conn_.at(conn)))
+        {
+            close(conn, "send failed", events);
+        }
+    }
+}
+
+void IoShard::queue(Peer &peer, const Packet &packet)
+{
+    serialize(packet, frame_);
+    peer.out.insert(peer.out.end(), frame_.begin(), frame_.end());
+}
+
+bool IoShard::write(Peer &peer)
+{
+    size_t sent = 0;
+    while (sent < peer.out.size())
+    {
+        const ssize_t n = ::send(peer.fd.get(), peer.out.data() + sent, peer.out.size() - sent, MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            break;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        sent += n;
+    }
+    peer.out.erase(peer.out.begin(), peer.out.begin() + sent);
+    if (peer.out.empty() && peer.out.capacity() > KEEP_OUT_BYTES)
+    {
+        peer.out.shrink_to_fit();
+    }
+    pollfds_[peer.slot].events = peer.out.empty() ? POLLIN : POLLIN | POLLOUT;
+    return true;
+}
+
+void IoShard::expire(std::chrono::steady_clock::time_point now, std::vector<ShardEvent> &events)
+{
+    std::vector<ConnectionTimer> expired;
+    timers_.advance(now, expired);
+    for (const auto &timer : expired)
+    {
+        auto it = peers_by_conn_.find(timer.conn);
+        if (it == peers_by_conn_.end())
+        {
+            continue; // set for a connection that is gone
+        }
+        auto &peer = it->second;
+        if (timer.kind == TimerKind::HEARTBEAT)
+        {
+            const bool idle = peer.out.empty();
+            queue(peer, heartbeat_packet(heartbeat_us(now)));
+            if (idle && !write(peer))
+            {
+                close(timer.conn, "send failed", events);
+                continue;
+            }
+            timers_.schedule(now + std::chrono::seconds(HEARTBEAT_INTERVAL_SEC), timer);
+            continue;
+        }
+        // Packets don't move the deadline in the wheel; it is only checked,
+        // and pushed back, when it comes up
+        auto deadline = peer.last_heard + std::chrono::seconds(args_.timeout);
+        if (now < deadline)
+        {
+            timers_.schedule(deadline, timer);
+            continue;
+        }
+        auto silent = std::chrono::duration_cast<std::chrono::seconds>(now - peer.last_heard).count();
+        close(timer.conn, ("timeout after " + std::to_string(silent) + "s").c_str(), events);
+    }
+}
+
+void IoShard::close(uint64_t conn, const char *reason, std::vector<ShardEvent> &events)
+{
+    auto it = peers_by_conn_.find(conn);
+    if (it == peers_by_conn_.end())
+    {
+        return;
+    }
+    const int fd = it->second.fd.get();
+    for (auto &entry : pollfds_)
+    {
+        if (entry.fd == fd)
+        {
+            entry.fd = -1;
+        }
+    }
+    conn_by_fd_.erase(fd);
+    if (it->second.rtt_ms > 0)
+    {
+        rtt_total_ -= it->second.rtt_ms;
+        --rtt_count_;
+    }
+    peers_by_conn_.erase(it); // closes the socket
+    compact_ = true;
+
+    ShardEvent closed;
+    closed.kind = ShardEvent::CLOSED;
+    closed.conn = conn;
+    closed.detail = reason;
+    events.push_back(std::move(closed));
+}
@@ -0,0 +1,167 @@
+#include "job_queue.h"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+namespace
+{
+    // What a job line may set; the rest is the controller's
+    const char *const JOB_OPTIONS[] = {"hash",     "hash-file", "wordlist",   "rules",      "mask",
+                                       "charset1", "charset2",  "charset3",   "charset4",   "markov",
+                                       "combine",  "mask-first", "min-length", "max-length", "work-size",
+                                       "checkpoint"};
+
+    bool is_job_option(const std::string &name)
+    {
+        for (const char *option : JOB_OPTIONS)
+        {
+            if (name == option)
+                return true;
+        }
+        return false;
+    }
+}
+
+int load_jobs(const std::string &path, std::vector<Job> &jobs)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::cerr << "Error: cannot read jobs file " << path << "\n";
+        return -1;
+    }
+    std::string line;
+    for (size_t line_no = 1; std::getline(in, line); ++line_no)
+    {
+        std::istringstream words(line);
+        std::vector<std::string> argv_strings{"job"};
+        unsigned priority = 1;
+        bool targets = false;
+        std::string word;
+        while (words >> word && word[0] != '#')
+        {
+            if (word == "--priority" || word.rfind("--priority=", 0) == 0)
+            {
+                // --priority n or --priority=n, like every other option
+                std::string text;
+                if (word == "--priority")
+                    words >> text;
+                else
+                    text = word.substr(word.find('=') + 1);
+                std::istringstream number(text);
+                int value = 0;
+                if (!(number >> value) || !number.eof() || value < 1 || value > static_cast<int>(MAX_JOB_PRIORITY))
+                {
+                    std::cerr << "Error: " << path << ":" << line_no << ": --priority must be between 1 and "
+                              << MAX_JOB_PRIORITY << "\n";
+                    return -1;
+                }
+                priority = static_cast<unsigned>(value);
+                continue;
+            }
+            if (word.rfind("--", 0) == 0)
+            {
+                auto name = word.substr(2, word.find('=') - 2);
+                if (!is_job_option(name))
+                {
+                    std::cerr << "Error: " << path << ":" << line_no << ": --" << name
+                              << " is not a job option\n";
+                    return -1;
+                }
+                targets = targets || name == "hash" || name == "hash-file";
+            }
+            argv_strings.push_back(word);
+        }
+        if (argv_strings.size() == 1)
+        {
+            continue;
+        }
+        if (!targets)
+        {
+            std::cerr << "Error: " << path << ":" << line_no << ": a job needs --hash or --hash-file\n";
+            return -1;
+        }
+
+        std::vector<char *> argv;
+        for (auto &arg : argv_strings)
+        {
+            argv.push_back(arg.data());
+        }
+        argv.push_back(nullptr);
+        Args args;
+        optind = 0; // getopt starts over for every line
+        if (parse_args(static_cast<int>(argv_strings.size()), argv.data(), args) != 0)
+        {
+            std::cerr << "Error: " << path << ":" << line_no << ": bad job\n";
+            return -1;
+        }
+        jobs.emplace_back(jobs.size() + 1, std::move(args), priority);
+    }
+    if (jobs.empty())
+    {
+        std::cerr << "Error: no jobs in " << path << "\n";
+        return -1;
+    }
+    // A worker has one copy of each input and may be moved to any job, so
+    // the jobs that use an input must all use the same file
+    const std::pair<const char *, std::string Args::*> inputs[] = {
+        {"wordlist", &Args::wordlist}, {"rules", &Args::rules}, {"combine", &Args::combine}, {"markov", &Args::markov}};
+    for (const auto &[name, member] : inputs)
+    {
+        const Job *first = nullptr;
+        for (const auto &job : jobs)
+        {
+            const std::string &file = job.args.*member;
+            if (file.empty())
+                continue;
+            if (!first)
+            {
+                first = &job;
+                continue;
+            }
+            if (file != first->args.*member)
+            {
+                std::cerr << "Error: " << path << ": job " << job.id << " uses --" << name << " " << file
+                          << " but job " << first->id << " uses " << first->args.*member
+                          << "; workers hold one copy of each input\n";
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+bool has_free_range(const Job &job)
+{
+    for (const auto &range : job.ranges)
+    {
+        if (range.status == READY)
+            return true;
+    }
+    return false;
+}
+
+size_t fairest_job(const std::vector<Job> &jobs)
+{
+    size_t best = jobs.size();
+    for (size_t i = 0; i < jobs.size(); ++i)
+    {
+        const auto &job = jobs[i];
+        if (job.finished || !has_free_range(job))
+            continue;
+        // granted / priority, compared without dividing
+        if (best == jobs.size() || job.granted * jobs[best].priority < jobs[best].granted * job.priority)
+            best = i;
+    }
+    return best;
+}
+
+bool should_move(const Job &current, const Job &due)
+{
+    if (current.finished || !has_free_range(current))
+        return true;
+    // granted / priority of current - that of due > slack, without dividing
+    return current.granted * due.priority >
+           (due.granted + JOB_MOVE_SLACK * due.priority) * current.priority;
+}
@@ -0,0 +1,132 @@
+#include "leases.h"
+
+#include <algorithm>
+#include <utility>
+
+void LeaseTracker::grant(size_t range, uint64_t client, Clock::time_point now)
+{
+    leases_[range].push_back({client, now, now, 0});
+}
+
+uint32_t LeaseTracker::report(size_t range, uint64_t client, uint32_t done, Clock::time_point now)
+{
+    auto it = leases_.find(range);
+    if (it == leases_.end())
+        return 0;
+    uint32_t grown = 0;
+    for (auto &lease : it->second)
+    {
+        if (lease.client == client)
+        {
+            grown = done > lease.done ? done - lease.done : 0;
+            lease.done = done;
+            lease.reported = now;
+        }
+    }
+    return grown;
+}
+
+bool LeaseTracker::release(size_t range, uint64_t client)
+{
+    auto it = leases_.find(range);
+    if (it == leases_.end())
+        return false;
+    auto &held = it->second;
+    auto lease = std::find_if(held.begin(), held.end(), [client](const Lease &l) { return l.client == client; });
+    if (lease == held.end())
+        return false;
+    remember(*lease);
+    held.erase(lease);
+    if (held.empty())
+        leases_.erase(it);
+    return true;
+}
+
+std::vector<size_t> LeaseTracker::drop(uint64_t client)
+{
+    std::vector<size_t> ranges;
+    for (auto it = leases_.begin(); it != leases_.end();)
+    {
+        auto &held = it->second;
+        auto kept = std::remove_if(held.begin(), held.end(), [client](const Lease &l) { return l.client == client; });
+        if (kept != held.end())
+            ranges.push_back(it->first);
+        held.erase(kept, held.end());
+        it = held.empty() ? leases_.erase(it) : std::next(it);
+    }
+    return ranges;
+}
+
+void LeaseTracker::renumber(const std::vector<size_t> &moved)
+{
+    std::unordered_map<size_t, std::vector<Lease>> renumbered;
+    for (auto &[range, held] : leases_)
+    {
+        if (moved[range] != SIZE_MAX)
+            renumbered[moved[range]] = std::move(held);
+    }
+    leases_ = std::move(renumbered);
+}
+
+std::vector<uint64_t> LeaseTracker::holders(size_t range) const
+{
+    std::vector<uint64_t> clients;
+    auto it = leases_.find(range);
+    if (it != leases_.end())
+    {
+        for (const auto &lease : it->second)
+            clients.push_back(lease.client);
+    }
+    return clients;
+}
+
+std::vector<size_t> LeaseTracker::stragglers(uint64_t client, Clock::time_point now) const
+{
+    std::vector<double> rates(recent_rates_.begin(), recent_rates_.end());
+    for (const auto &[range, held] : leases_)
+    {
+        for (const auto &lease : held)
+        {
+            if (lease.done > 0)
+                rates.push_back(rate(lease));
+        }
+    }
+    if (rates.size() < STRAGGLER_MIN_SAMPLES)
+        return {};
+    auto middle = rates.begin() + rates.size() / 2;
+    std::nth_element(rates.begin(), middle, rates.end());
+    const double slow = *middle / STRAGGLER_FACTOR;
+
+    std::vector<std::pair<double, size_t>> slowest;
+    for (const auto &[range, held] : leases_)
+    {
+        if (held.size() != 1 || held[0].client == client)
+            continue;
+        const double age = std::chrono::duration<double>(now - held[0].start).count();
+        if (age < STRAGGLER_MIN_AGE_SEC)
+            continue;
+        const double best_case = (held[0].done + checkpoint_interval_) / age;
+        if (best_case < slow)
+            slowest.emplace_back(best_case, range);
+    }
+    std::sort(slowest.begin(), slowest.end());
+    std::vector<size_t> ranges;
+    for (const auto &entry : slowest)
+        ranges.push_back(entry.second);
+    return ranges;
+}
+
+double LeaseTracker::rate(const Lease &lease)
+{
+    const double elapsed = std::chrono::duration<double>(lease.reported - lease.start).count();
+    return elapsed > 0 ? lease.done / elapsed : 0;
+}
+
+void LeaseTracker::remember(const Lease &lease)
+{
+    if (lease.done == 0)
+        return;
+    recent_rates_.push_back(rate(lease));
+    if (recent_rates_.size() > RECENT_LEASE_RATES)
+        recent_rates_.pop_front();
+}
@@ -1,286 +1,1260 @@
 #include <iostream>
 #include <unistd.h>
+#include <sys/stat.h>
 #include <chrono>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <memory>
 #include <unordered_map>
+#include <unordered_set>
 
+#include "io_shard.h"
 #include "network.h"
 #include "parse_args.h"
 #include "partition.h"
+#include "job_queue.h"
+#include "potfile.h"
+#include "leases.h"
+#include "relay.h"
+#include "strided.h"
+#include "trace.h"
+#include "wordlist.h"
+#include "mask.h"
 
-void print_checkpoint_info(int client_fd, const Packet &pkt)
+void print_checkpoint_info(uint64_t client, const Packet &pkt)
 {
-    std::cout << "Client " << client_fd << " Checkpoint  Info:\n";
-    std::cout << "  Interval: " << pkt.header.checkpoint_interval << "\n";
+    std::cout << "Client " << client << " Checkpoint  Info:\n";
+    std::cout << "  Work done: " << header_target_id(pkt.header) << "\n";
     std::cout << "  Last Prefix: " << std::string(pkt.payload.begin(), pkt.payload.end()) << "\n";
 }
 
-int main(int argc, char *argv[])
+// Seconds between progress lines (coverage, rate, ETA) in range attacks
+constexpr int PROGRESS_INTERVAL_SEC = 10;
+
+// "1h02m03s" style, for ETAs
+std::string format_duration(double seconds)
 {
-    Args args;
+    if (!(seconds < 1e9))
+        return "unknown";
+    auto total = static_cast<long long>(seconds + 0.5);
+    char buf[64];
+    if (total >= 86400)
+        std::snprintf(buf, sizeof(buf), "%lldd%02lldh%02lldm", total / 86400, total / 3600 % 24, total / 60 % 60);
+    else if (total >= 3600)
+        std::snprintf(buf, sizeof(buf), "%lldh%02lldm%02llds", total / 3600, total / 60 % 60, total % 60);
+    else
+        std::snprintf(buf, sizeof(buf), "%lldm%02llds", total / 60, total % 60);
+    return buf;
+}
 
-    if (parse_args(argc, argv, args) != 0)
+// Identifies the partition a lease token belongs to: the first character of
+// a brute-force prefix, or the end and inner chunk of a wordlist/mask range
+std::string lease_key(const std::string &token, bool range_mode)
+{
+    if (range_mode)
     {
+        RangeToken range;
+        if (!parse_range(token, range))
+            return token;
+        return std::to_string(range.end) + "/" + std::to_string(range.inner_end);
+    }
+    return token.substr(0, 1);
+}
+
+// Closes the trace spans of leases a connection still holds (disconnect/timeout)
+void trace_abandon_leases(uint64_t client, const char *reason,
+                          std::unordered_map<uint64_t, uint32_t> &trace_ids,
+                          std::unordered_map<uint64_t, std::unordered_map<std::string, uint64_t>> &lease_starts)
+{
+    auto traced = trace_ids.find(client);
+    if (!trace_enabled() || traced == trace_ids.end())
+        return;
+    const uint32_t id = traced->second;
+    auto now_us = trace_now_us();
+    for (const auto &[first, start_us] : lease_starts[client])
+    {
+        trace_span("lease", id, TRACE_TID_CONTROLLER, start_us, now_us,
+                   first + "... " + reason);
+    }
+    trace_instant(reason, id, TRACE_TID_CONTROLLER);
+    lease_starts.erase(client);
+    trace_ids.erase(traced);
+}
+
+// Size in bytes of a file the workers must hold an identical copy of
+int input_size(const std::string &path, const char *what, uint64_t &size)
+{
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0 || st.st_size == 0)
+    {
+        std::cerr << "Error: " << what << " " << path << " is empty or unreadable\n";
         return -1;
     }
-    print_args(args);
+    size = static_cast<uint64_t>(st.st_size);
+    return 0;
+}
 
-    auto partitions = create_partitions(DEFAULT_PREFIX_LEN);
-    size_t part_index = 0;
-    bool password_found = false;
-    bool start_time_set = false;
-    std::chrono::steady_clock::time_point start_time, end_time;
+// Splits a range attack into leases and names it for the CONACK
+// payload: a line of "key [value]" options (hex sizes let workers check
+// their copies of the files), then the mask and its four custom charsets if
+// there is a mask. Returns -1 (after printing why) if an input is unusable.
+int plan_attack(const Args &args, std::vector<LeaseRange> &ranges, std::string &attack)
+{
+    std::ostringstream options;
+    options << std::hex;
+    uint64_t keyspace = 0;
+    if (!args.mask.empty())
+    {
+        try
+        {
+            keyspace = Mask(args.mask, args.charsets).keyspace();
+        }
+        catch (const std::invalid_argument &e)
+        {
+            std::cerr << "Error: " << e.what() << "\n";
+            return -1;
+        }
+    }
+
+    std::ostringstream summary;
+    if (args.wordlist.empty() && args.mask.empty())
+    {
+        options << std::dec << "lengths " << args.min_length << " " << args.max_length;
+        ranges = create_length_ranges(args.min_length, args.max_length, keyspace);
+        summary << "Brute force: lengths " << args.min_length << "-" << args.max_length << ", " << keyspace
+                << " candidates";
+    }
+    else if (args.wordlist.empty())
+    {
+        options << "mask";
+        ranges = cross_ranges(split_keyspace(keyspace, TARGET_RANGES), {});
+        summary << "Mask: " << keyspace << " candidates";
+    }
+    else
+    {
+        uint64_t wordlist_size = 0;
+        auto words = split_lines(args.wordlist, TARGET_RANGES, wordlist_size);
+        if (words.empty())
+        {
+            return -1;
+        }
+        options << "wordlist " << wordlist_size;
+        summary << "Wordlist: " << wordlist_size << " bytes";
+
+        // The second dimension, if any, is split into chunks so every lease
+        // is a tile of words x chunk
+        std::vector<IndexRange> inner;
+        if (!args.rules.empty())
+        {
+            uint32_t rule_count = 0;
+            if (count_rules(args.rules, rule_count) != 0)
+            {
+                return -1;
+            }
+            inner = rule_chunks(rule_count);
+            options << " rules " << std::dec << rule_count << std::hex;
+            summary << " x " << rule_count << " rules";
+        }
+        else if (!args.combine.empty())
+        {
+            uint64_t combine_size = 0;
+            inner = split_lines(args.combine, TARGET_INNER_CHUNKS, combine_size);
+            if (inner.empty())
+            {
+                return -1;
+            }
+            options << " combine " << combine_size;
+            summary << " x " << combine_size << " bytes of " << args.combine;
+        }
+        else if (!args.mask.empty())
+        {
+            inner = split_keyspace(keyspace, TARGET_INNER_CHUNKS);
+            options << (args.mask_first ? " mask-first" : " mask");
+            summary << (args.mask_first ? " after " : " before ") << keyspace << " mask candidates";
+        }
+        ranges = cross_ranges(words, inner);
+    }
 
-    int connects = 0;
+    // Workers rebuild the mask from the same spec, so only that travels;
+    // with --markov they also train on their own copy of the corpus
+    if (!args.markov.empty())
+    {
+        uint64_t corpus_size = 0;
+        if (input_size(args.markov, "Markov corpus", corpus_size) != 0)
+        {
+            return -1;
+        }
+        options << " markov " << corpus_size;
+        summary << " (Markov order)";
+    }
+    attack = options.str();
+    if (!args.mask.empty())
+    {
+        attack += "\n" + args.mask;
+        for (const auto &set : args.charsets)
+        {
+            attack += "\n" + set;
+        }
+    }
+    if (attack.size() > MAX_PAYLOAD)
+    {
+        std::cerr << "Error: attack description exceeds " << MAX_PAYLOAD << " bytes\n";
+        return -1;
+    }
+    std::cout << summary.str() << " in " << ranges.size() << " ranges\n";
+    return 0;
+}
+
+// --jobs: schedules a queue of range attacks over one set of workers (see
+// job_queue.h)
+int run_job_queue(const Args &args)
+{
+    std::vector<Job> jobs;
+    if (load_jobs(args.jobs_file, jobs) != 0)
+    {
+        return -1;
+    }
+    // One potfile for every job: targets already known are never scheduled,
+    // and a crack in one job also settles the same hash in the others
+    Potfile potfile;
+    if (!args.potfile.empty() && potfile.open(args.potfile) != 0)
+    {
+        return -1;
+    }
+    std::unordered_map<std::string, std::vector<std::pair<size_t, size_t>>> targets_by_hash;   // (job, id)
+    size_t jobs_left = jobs.size();
+    for (auto &job : jobs)
+    {
+        job.cracked.assign(job.args.hashes.size(), false);
+        job.found.resize(job.args.hashes.size());
+        job.targets_left = job.args.hashes.size();
+        for (size_t id = 0; id < job.args.hashes.size(); ++id)
+        {
+            targets_by_hash[job.args.hashes[id]].emplace_back(job.id - 1, id);
+            if (potfile.lookup(job.args.hashes[id], job.found[id]))
+            {
+                job.cracked[id] = true;
+                --job.targets_left;
+            }
+        }
+        std::cout << "Job " << job.id << " (priority " << job.priority << "): " << job.args.hashes.size()
+                  << " targets, " << job.args.hashes.size() - job.targets_left << " in the potfile\n";
+        if (job.targets_left == 0)
+        {
+            job.finished = true;
+            --jobs_left;
+            continue;
+        }
+        if (plan_attack(job.args, job.ranges, job.attack) != 0)
+        {
+            return -1;
+        }
+    }
+    if (jobs_left == 0)
+    {
+        std::cout << "Every target is in the potfile\n";
+        for (const auto &job : jobs)
+        {
+            std::cout << "Job " << job.id << ":\n";
+            for (size_t id = 0; id < job.args.hashes.size(); ++id)
+            {
+                std::cout << "  " << job.args.hashes[id] << " : " << job.found[id] << "\n";
+            }
+        }
+        return 0;
+    }
+
+    // New connections are greeted with the first unfinished job; their
+    // first WORKREQ moves them to whichever job is due
+    const auto &greeter = *std::find_if(jobs.begin(), jobs.end(), [](const Job &job) { return !job.finished; });
+    Args greeting = args;
+    greeting.hashes = greeter.args.hashes;
+    const std::string greeting_attack = greeter.attack;
+
+    std::unordered_map<uint64_t, size_t> job_of;    // the job each worker is set up for
+    std::unordered_set<uint64_t> moved;             // just moved: its next WORKREQ is for that job
+    std::unordered_map<uint64_t, uint8_t> idle;
     int work_requests = 0;
     int checkpoints = 0;
-    int total_pkts = 0;
+    int moves = 0;
+    const auto queue_start = std::chrono::steady_clock::now();
+    auto last_progress = queue_start;
 
     try
     {
-        Fd listen_fd(create_listen_socket(args.port));
-        if (!make_fd_non_blocking(listen_fd.get()))
+        Dispatcher dispatch(greeting, greeting_attack, greeter.cracked);
+        bool cracked_changed = false;
+        const SendPacket send = [&](uint64_t client, Packet packet) { dispatch.send(client, std::move(packet)); };
+
+        // Cracked or exhausted: workers still on it stop and ask for another
+        auto finish = [&](Job &job, const std::string &why)
         {
-            throw std::runtime_error("Error making listen socket non-blocking");
-        }
+            job.finished = true;
+            job.end_time = std::chrono::steady_clock::now();
+            --jobs_left;
+            std::cout << "Job " << job.id << " finished: " << why << "\n";
+            if (jobs_left == 0)
+            {
+                return; // the KILL ends its leases; a CANCEL would only draw a WORKREQ
+            }
+            cancel_leases(job, send);
+        };
 
-        std::vector<pollfd> pollfds;
-        std::vector<Fd> client_fds;
-        std::unordered_map<int, std::chrono::steady_clock::time_point> last_activity;
+        auto abandon = [&](uint64_t client)
+        {
+            idle.erase(client);
+            moved.erase(client);
+            auto it = job_of.find(client);
+            if (it == job_of.end())
+                return;
+            drop_leases(jobs[it->second], client);
+            job_of.erase(it);
+        };
 
-        pollfd listen_entry{};
-        listen_entry.fd = listen_fd.get();
-        listen_entry.events = POLLIN;
-        pollfds.push_back(listen_entry);
+        auto hand_out = [&](uint64_t client, Job &job, uint8_t num_threads)
+        {
+            return !lease_ranges(job, job.args, client, num_threads, send).empty();
+        };
 
-        std::cout << "Server listening on port " << args.port << "\n";
+        // Answers a WORKREQ with a lease of the job that is due, moving the
+        // worker there first if it is set up for another; false if nothing
+        // can be handed out yet
+        auto serve = [&](uint64_t client, uint8_t num_threads)
+        {
+            const size_t current = job_of[client];
+            size_t due = fairest_job(jobs);
+            if ((moved.erase(client) && !jobs[current].finished && has_free_range(jobs[current])) ||
+                (due < jobs.size() && !should_move(jobs[current], jobs[due])))
+            {
+                due = current;
+            }
+            if (due == jobs.size())
+            {
+                // Nothing free anywhere: a backup copy of a straggler, in its
+                // own job if that one is still open
+                due = current;
+                for (size_t i = 0; i < jobs.size() && jobs[due].finished; ++i)
+                {
+                    due = i;
+                }
+                if (jobs[due].finished)
+                    return false;
+                if (due == current)
+                    return hand_out(client, jobs[due], num_threads);
+            }
+            if (due == current)
+            {
+                return hand_out(client, jobs[due], num_threads);
+            }
+            std::cout << "Moving client " << client << " from job " << jobs[current].id << " to job " << jobs[due].id
+                      << "\n";
+            for (auto &packet : conack_packets(jobs[due].args.hashes, jobs[due].cracked, jobs[due].attack, true))
+            {
+                send(client, std::move(packet));
+            }
+            job_of[client] = due;
+            moved.insert(client);
+            ++moves;
+            return true;
+        };
+
+        auto handle_packet = [&](uint64_t client, const Packet &pkt)
+        {
+            auto &job = jobs[job_of[client]];
+            switch (pkt.header.flags)
+            {
+            case WORKREQ:
+            {
+                std::cout << "Received WORKREQ packet from client " << client << "\n";
+                ++work_requests;
+                auto num_threads = pkt.payload.empty() ? uint8_t(1) : pkt.payload[0];
+                if (!serve(client, num_threads))
+                {
+                    std::cout << "No range free for client " << client << ", waiting\n";
+                    idle[client] = num_threads;
+                }
+                break;
+            }
+            case WORKFIN:
+                std::cout << "Received WORKFIN packet from client " << client << " (job " << job.id << ")\n";
+                finish_lease(job, client, std::string(pkt.payload.begin(), pkt.payload.end()), send);
+                break;
+            case CHECK:
+            {
+                print_checkpoint_info(client, pkt);
+                uint32_t grown = 0;
+                check_lease(job, client, header_target_id(pkt.header), std::string(pkt.payload.begin(), pkt.payload.end()),
+                            grown);
+                ++checkpoints;
+                break;
+            }
+            case PWDFND:
+            {
+                auto id = header_target_id(pkt.header);
+                std::string found_password(pkt.payload.begin(), pkt.payload.end());
+                if (id >= job.cracked.size() || job.cracked[id])
+                {
+                    std::cerr << "Ignoring PWDFND for unknown or already cracked target " << id << " of job "
+                              << job.id << "\n";
+                    break;
+                }
+                const std::string &hash = job.args.hashes[id];
+                potfile.add(hash, found_password);
+                for (auto [other_index, other_id] : targets_by_hash[hash])
+                {
+                    auto &other = jobs[other_index];
+                    if (!record_crack(other, other_id, found_password))
+                        continue;
+                    cracked_changed = cracked_changed || &other == &greeter;
+                    std::cout << "Job " << other.id << ": password found: " << found_password << " (" << hash
+                              << "), " << other.targets_left << " targets remaining\n";
+                    if (other.targets_left == 0 && !other.finished)
+                    {
+                        finish(other, "all targets cracked");
+                    }
+                }
+                break;
+            }
+            default:
+                std::cerr << "Unknown packet flag: " << static_cast<int>(pkt.header.flags) << "\n";
+                break;
+            }
+            if (!job.finished && ranges_exhausted(job.ranges))
+            {
+                finish(job, "keyspace fully covered, " + std::to_string(job.targets_left) + " of " +
+                                std::to_string(job.args.hashes.size()) + " targets not found");
+            }
+        };
+
+        // New connections start on the greeter; the rest is as in a single job
+        dispatch.on_events({[&](const ShardEvent &event) { job_of[event.conn] = greeter.id - 1; }, handle_packet,
+                            [&](uint64_t client, const char *) { abandon(client); }, nullptr});
 
-        while (!password_found)
+        std::cout << "Server listening on port " << args.port << " (" << dispatch.io_threads() << " I/O threads), "
+                  << jobs.size() << " jobs queued\n";
+        if (!args.unix_socket.empty())
         {
+            std::cout << "Server listening on " << args.unix_socket << "\n";
+        }
 
-            int n = poll(pollfds.data(), pollfds.size(), 1000);
-            if (n < 0)
+        while (jobs_left > 0)
+        {
+            dispatch.wait();
+            std::vector<ShardEvent> batch;
+            while (jobs_left > 0 && dispatch.pop(batch))
             {
-                throw std::runtime_error("poll() failed");
+                for (const auto &event : batch)
+                {
+                    dispatch.handle(event);
+                }
             }
 
-            for (size_t i = 0; i < pollfds.size(); i++)
+            if (cracked_changed)
             {
-                auto &pfd = pollfds[i];
+                dispatch.publish(greeter.cracked);
+                cracked_changed = false;
+            }
 
-                // 1. Handle new incoming connections
-                if (pfd.fd == listen_fd.get() && (pfd.revents & POLLIN))
+            auto now = std::chrono::steady_clock::now();
+            if (jobs_left == 0)
+            {
+                dispatch.kill_all();
+            }
+            else
+            {
+                for (auto waiting = idle.begin(); waiting != idle.end();)
                 {
+                    if (serve(waiting->first, waiting->second))
+                        waiting = idle.erase(waiting);
+                    else
+                        ++waiting;
+                }
+            }
 
-                    while (true)
+            if (jobs_left > 0 && now - last_progress >= std::chrono::seconds(PROGRESS_INTERVAL_SEC))
+            {
+                for (const auto &job : jobs)
+                {
+                    if (job.finished || !job.start_time_set)
+                        continue;
+                    size_t on_job = 0;
+                    for (const auto &[client, index] : job_of)
                     {
-                        sockaddr_in client_addr{};
-                        socklen_t len = sizeof(client_addr);
+                        on_job += &jobs[index] == &job ? 1 : 0;
+                    }
+                    char percent[32];
+                    std::snprintf(percent, sizeof(percent), "%.3f%%", ranges_coverage(job.ranges) * 100);
+                    std::cout << "Progress: job " << job.id << " " << percent << " covered, " << job.granted
+                              << " leases, " << on_job << (on_job == 1 ? " worker\n" : " workers\n");
+                }
+                last_progress = now;
+            }
 
-                        int raw_fd =
-                            accept(listen_fd.get(), (sockaddr *)&client_addr, &len);
+            dispatch.flush();
+        }
+        dispatch.stop();
 
-                        if (raw_fd < 0)
-                        {
-                            if (errno == EAGAIN || errno == EWOULDBLOCK)
-                                break;
-                            throw std::runtime_error("Error accepting connection");
-                        }
+        for (const auto &job : jobs)
+        {
+            auto elapsed_ms =
+                job.start_time_set
+                    ? std::chrono::duration_cast<std::chrono::milliseconds>(job.end_time - job.start_time).count()
+                    : 0;
+            char percent[32];
+            std::snprintf(percent, sizeof(percent), "%.3f%%", ranges_coverage(job.ranges) * 100);
+            std::cout << "Job " << job.id << " (priority " << job.priority << "): " << percent << " covered, "
+                      << job.granted << " leases, " << job.candidates << " candidates, " << elapsed_ms / 1000.0
+                      << " seconds\n";
+            for (size_t id = 0; id < job.args.hashes.size(); ++id)
+            {
+                std::cout << "  " << job.args.hashes[id] << " : " << (job.cracked[id] ? job.found[id] : "(not found)")
+                          << "\n";
+            }
+        }
+        auto total_ms =
+            std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - queue_start)
+                .count();
+        std::cout << "Total elapsed time: " << total_ms / 1000.0 << " seconds\n";
+        std::cout << "Total connections: " << dispatch.connects() << "\n";
+        std::cout << "Total work requests: " << work_requests << "\n";
+        std::cout << "Total job moves: " << moves << "\n";
+        std::cout << "Total checkpoints: " << checkpoints << "\n";
+        std::cout << "Total packets processed: " << dispatch.packets() << "\n";
+    }
+    catch (const std::runtime_error &e)
+    {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
 
-                        Fd client_fd(raw_fd);
+int main(int argc, char *argv[])
+{
+    Args args;
 
-                        if (!make_fd_non_blocking(client_fd.get()))
-                        {
-                            throw std::runtime_error("Error making client socket non-blocking");
-                        }
+    if (parse_args(argc, argv, args) != 0)
+    {
+        return -1;
+    }
+    print_args(args);
+    if (!args.jobs_file.empty())
+    {
+        return run_job_queue(args);
+    }
 
-                        std::cout << "Accepted connection from "
-                                  << inet_ntoa(client_addr.sin_addr) << ":"
-                                  << ntohs(client_addr.sin_port) << "\n";
+    if (!args.trace_path.empty() && trace_open(args.trace_path))
+    {
+        trace_name_process(TRACE_PID_CONTROLLER, "controller");
+        trace_name_thread(TRACE_PID_CONTROLLER, TRACE_TID_CONTROLLER, "job");
+    }
 
-                        last_activity[client_fd.get()] = std::chrono::steady_clock::now();
+    // A relay learns the targets and the attack from upstream before it
+    // serves anyone
+    const bool relay = !args.upstream.empty();
+    Upstream upstream;
+    std::vector<uint32_t> upstream_ids;     // upstream's id of each target
+    std::string attack;
+    if (relay)
+    {
+        if (upstream.connect(args.upstream) != 0 || upstream.handshake(args.hashes, upstream_ids, attack) != 0)
+        {
+            return -1;
+        }
+        if (attack.empty())
+        {
+            std::cerr << "Error: upstream runs a depth-first brute force, which has no ranges to relay\n";
+            return -1;
+        }
+        std::cout << "Relaying " << args.hashes.size() << " targets from " << args.upstream << ": "
+                  << attack.substr(0, attack.find('\n')) << "\n";
+    }
 
-                        pollfd entry{};
-                        entry.fd = client_fd.get();
-                        entry.events = POLLIN;
-                        pollfds.push_back(entry);
+    auto partitions = create_partitions(DEFAULT_PREFIX_LEN);
+    size_t part_index = 0;
+    // The only job's leases and per-target crack state, indexed by the
+    // target ids sent in TARGETS
+    JobState job(static_cast<uint32_t>(args.checkpoint_interval), "");
+    job.cracked.assign(args.hashes.size(), false);
+    job.found.resize(args.hashes.size());
+    job.targets_left = args.hashes.size();
+    Potfile potfile;
+    if (!args.potfile.empty())
+    {
+        if (potfile.open(args.potfile) != 0)
+        {
+            return -1;
+        }
+        // Targets cracked by an earlier run are reported now and never scheduled
+        for (size_t id = 0; id < args.hashes.size(); ++id)
+        {
+            if (!potfile.lookup(args.hashes[id], job.found[id]))
+                continue;
+            job.cracked[id] = true;
+            --job.targets_left;
+            std::cout << "Password found in potfile: " << job.found[id] << " (" << args.hashes[id] << ")\n";
+            if (relay && upstream.send(pwdfnd_packet(upstream_ids[id], job.found[id])) != 0)
+            {
+                std::cerr << "Failed to send PWDFND upstream\n";
+            }
+        }
+        std::cout << "Potfile " << args.potfile << ": " << potfile.size() << " entries, "
+                  << args.hashes.size() - job.targets_left << " of " << args.hashes.size() << " targets known\n";
+        if (job.targets_left == 0)
+        {
+            std::cout << "Cracked targets:\n";
+            for (size_t id = 0; id < args.hashes.size(); ++id)
+            {
+                std::cout << "  " << args.hashes[id] << " : " << job.found[id] << "\n";
+            }
+            return 0;
+        }
+    }
+    uint64_t job_start_us = 0;
+
+    // Everything but --depth-first brute force leases ranges (byte offsets
+    // of the list, indices into the keyspace) instead of prefixes
+    const bool range_mode = !args.depth_first;
+    // Workers waiting for a range to free up (or a straggler to back up),
+    // with the thread count of their WORKREQ
+    std::unordered_map<uint64_t, uint8_t> idle;
+    bool exhausted = false;
+    if (range_mode && !relay && plan_attack(args, job.ranges, attack) != 0)
+    {
+        return -1;
+    }
+    // --strided deals the index space out as lanes instead of leasing ranges
+    const uint64_t keyspace = job.ranges.empty() ? 0 : job.ranges.back().position.end;
+    if (args.strided && keyspace > MAX_STRIDED_KEYSPACE)
+    {
+        std::cerr << "Error: --strided takes at most " << MAX_STRIDED_KEYSPACE << " candidates, the mask has "
+                  << keyspace << "\n";
+        return -1;
+    }
+    StridePlan stride_plan(args.strided ? keyspace : 0);
 
-                        client_fds.push_back(std::move(client_fd));
-                        ++total_pkts;
-                        ++connects;
+    // Relay: the ranges leased from upstream by (end, inner_end), which of
+    // them each local range is a piece of, and the pieces of finished ones,
+    // dropped once a cancelled copy can no longer report on them
+    const RelaySplit split = relay ? relay_split(attack) : RelaySplit::NONE;
+    using RangeKey = std::pair<uint64_t, uint64_t>;
+    std::map<RangeKey, UpstreamLease> upstream_leases;
+    std::map<RangeKey, RangeKey> piece_of;
+    std::deque<std::pair<std::chrono::steady_clock::time_point, std::vector<RangeKey>>> retired;
+    bool upstream_asked = false;
+    bool upstream_done = false;
 
-                        if (send_conack(entry.fd, DEFAULT_RETRIES, args) != 0)
-                        {
-                            std::cerr << "Failed to send CONACK to client (fd: " << entry.fd << ")\n";
-                            ::close(entry.fd);
-                            entry.fd = -1; // Mark for removal
-                        }
-                        ++total_pkts;
-                    }
+    // Per-connection trace ids and the start time of every lease still out,
+    // keyed by connection and lease_key of the token
+    std::unordered_map<uint64_t, uint32_t> trace_ids;
+    std::unordered_map<uint64_t, std::unordered_map<std::string, uint64_t>> lease_starts;
+    // A connection's trace id; no lookup at all unless tracing
+    auto trace_id = [&](uint64_t client) -> uint32_t
+    {
+        if (!trace_enabled())
+            return 0;
+        auto it = trace_ids.find(client);
+        return it == trace_ids.end() ? 0 : it->second;
+    };
+
+    int work_requests = 0;
+    int checkpoints = 0;
+
+    // Cluster rate, smoothed over progress lines: share of the keyspace and
+    // (checkpointed) candidates per second
+    auto last_progress = std::chrono::steady_clock::now();
+    double last_coverage = 0, coverage_rate = 0;
+    uint64_t last_candidates = 0;
+
+    try
+    {
+        // This thread is the scheduler and owns all job state; the I/O
+        // threads own the sockets. Events come in batches from every shard
+        // through one queue, and each round's packets go out as one batch
+        // per shard.
+        Dispatcher dispatch(args, attack, job.cracked);
+        bool cracked_changed = false;
+        if (relay)
+        {
+            upstream.start(dispatch.events(), dispatch.wakeup());
+        }
+        const SendPacket send = [&](uint64_t client, Packet packet) { dispatch.send(client, std::move(packet)); };
+
+        // A connection is gone: close its trace spans, and leave each range it
+        // held to the other copy if there is one, otherwise READY again
+        auto abandon = [&](uint64_t client, const char *reason)
+        {
+            trace_abandon_leases(client, reason, trace_ids, lease_starts);
+            idle.erase(client);
+            if (args.strided)
+            {
+                stride_plan.leave(client);
+                return;
+            }
+            drop_leases(job, client);
+        };
+
+        // Answers a WORKREQ; false if there is nothing to hand out yet
+        auto hand_out = [&](uint64_t client, uint8_t num_threads)
+        {
+            const bool started = job.start_time_set;
+            auto prefixes = range_mode ? lease_ranges(job, args, client, num_threads, send)
+                                       : generate_work_prefixes(partitions, part_index, num_threads);
+            if (prefixes.empty())
+            {
+                return false;
+            }
+            if (!range_mode)
+            {
+                // Depth-first prefixes have no leases to keep track of
+                for (auto &packet : work_packets(args, prefixes))
+                {
+                    send(client, std::move(packet));
+                }
+                if (!started)
+                {
+                    job.start_time = std::chrono::steady_clock::now();
+                    job.start_time_set = true;
+                }
+            }
+            if (trace_enabled())
+            {
+                auto now_us = trace_now_us();
+                std::string granted;
+                for (const auto &prefix : prefixes)
+                {
+                    lease_starts[client][lease_key(prefix, range_mode)] = now_us;
+                    granted += prefix + " ";
+                }
+                trace_instant("lease granted", trace_id(client), TRACE_TID_CONTROLLER, granted);
+            }
+            if (!started)
+            {
+                job_start_us = trace_now_us();
+            }
+            return true;
+        };
+
+        // Ends the job on every connected worker
+        auto kill_all = [&]()
+        {
+            for (uint64_t client : dispatch.clients())
+            {
+                trace_instant("KILL sent", trace_id(client), TRACE_TID_CONTROLLER);
+            }
+            dispatch.kill_all();
+        };
+
+        // Relay: tells upstream how far a lease got (a CHECK at most every
+        // RELAY_REPORT_SEC) or that it is done (WORKFIN, then forgets it)
+        auto report_upstream = [&](std::map<RangeKey, UpstreamLease>::iterator it)
+        {
+            auto &lease = it->second;
+            auto now = std::chrono::steady_clock::now();
+            auto position = upstream_position(lease, job.ranges);
+            auto token = format_range(position);
+            if (position.cursor < position.end)
+            {
+                if ((token == lease.reported && lease.done == lease.reported_done) ||
+                    now - lease.last_report < std::chrono::seconds(RELAY_REPORT_SEC))
+                    return;
+                if (upstream.send(check_packet(static_cast<uint32_t>(std::min<uint64_t>(lease.done, UINT32_MAX)),
+                                               token)) != 0)
+                    std::cerr << "Failed to send CHECK upstream\n";
+                lease.reported = token;
+                lease.reported_done = lease.done;
+                lease.last_report = now;
+                return;
+            }
+            std::cout << "Upstream range " << format_range(lease.range) << " finished\n";
+            // Work since the last CHECK still counts towards upstream's rates
+            if (lease.done != lease.reported_done &&
+                upstream.send(check_packet(static_cast<uint32_t>(std::min<uint64_t>(lease.done, UINT32_MAX)),
+                                           token)) != 0)
+                std::cerr << "Failed to send CHECK upstream\n";
+            if (upstream.send(workfin_packet(token)) != 0)
+                std::cerr << "Failed to send WORKFIN upstream\n";
+            retired.emplace_back(now, std::move(lease.pieces));
+            upstream_leases.erase(it);
+        };
+
+        // Relay: splits upstream's ranges so every waiting thread gets a piece
+        auto take_upstream_work = [&](const Packet &pkt)
+        {
+            upstream_asked = false;
+            std::vector<RangeToken> granted;
+            std::istringstream tokens(std::string(pkt.payload.begin(), pkt.payload.end()));
+            std::string token;
+            while (tokens >> token)
+            {
+                RangeToken range;
+                if (!parse_range(token, range) || upstream_leases.count({range.end, range.inner_end}))
+                {
+                    std::cerr << "Ignoring bad or repeated upstream lease " << token << "\n";
+                    continue;
+                }
+                granted.push_back(range);
+            }
+            if (granted.empty())
+                return;
+            uint64_t threads = 0;
+            for (const auto &[client, num_threads] : idle)
+            {
+                threads += num_threads;
+            }
+            const uint64_t parts = split == RelaySplit::NONE ? 1 : (threads + granted.size() - 1) / granted.size();
+
+            std::vector<LeaseRange> added;
+            std::vector<RangeKey> keys;
+            for (const auto &range : granted)
+            {
+                RangeKey key{range.end, range.inner_end};
+                auto &lease = upstream_leases[key];
+                lease.range = range;
+                lease.split = split;
+                for (auto &piece : split_range(range, split == RelaySplit::INNER, parts))
+                {
+                    RangeKey piece_key{piece.position.end, piece.position.inner_end};
+                    lease.pieces.push_back(piece_key);
+                    piece_of[piece_key] = key;
+                    added.push_back(piece);
+                }
+                keys.push_back(key);
+            }
+            std::cout << "Upstream leased " << granted.size() << " ranges, split into " << added.size()
+                      << " pieces\n";
+            job.leases.renumber(reshape_ranges(job.ranges, std::move(added), {}));
+            for (const auto &key : keys)
+            {
+                report_upstream(upstream_leases.find(key)); // only an empty one finishes here
+            }
+        };
+
+        // Relay: a copy elsewhere finished the range first, so stop ours and
+        // say where it got to, as a worker would
+        auto cancel_upstream = [&](const std::string &token)
+        {
+            RangeToken range;
+            auto it = parse_range(token, range) ? upstream_leases.find({range.end, range.inner_end})
+                                                : upstream_leases.end();
+            if (it == upstream_leases.end())
+                return; // already finished here; the WORKFIN crossed the CANCEL
+            auto position = format_range(upstream_position(it->second, job.ranges));
+            std::cout << "Upstream range " << format_range(it->second.range) << " cancelled at " << position << "\n";
+            for (const auto &[end, inner_end] : it->second.pieces)
+            {
+                size_t index = find_range(job.ranges, end, inner_end);
+                if (index == job.ranges.size())
+                    continue;
+                for (uint64_t holder : job.leases.holders(index))
+                {
+                    send(holder, cancel_packet(format_range(job.ranges[index].position)));
+                    job.leases.release(index, holder);
                 }
+                job.ranges[index].position.cursor = job.ranges[index].position.end;
+                job.ranges[index].status = COMPLETED;
+            }
+            if (upstream.send(workfin_packet(position)) != 0)
+                std::cerr << "Failed to send WORKFIN upstream\n";
+            retired.emplace_back(std::chrono::steady_clock::now(), std::move(it->second.pieces));
+            upstream_leases.erase(it);
+        };
+
+        auto upstream_lease_of = [&](size_t index)
+        {
+            auto parent = piece_of.find({job.ranges[index].position.end, job.ranges[index].position.inner_end});
+            return parent == piece_of.end() ? upstream_leases.end() : upstream_leases.find(parent->second);
+        };
 
-                // 2. Handle client data
-                else if (pfd.fd != listen_fd.get() && (pfd.revents & POLLIN))
+        auto handle_upstream = [&](const ShardEvent &event)
+        {
+            if (event.kind == ShardEvent::CLOSED)
+            {
+                std::cerr << "Upstream controller lost: " << event.detail << "\n";
+                upstream_done = true;
+                job.end_time = std::chrono::steady_clock::now();
+                kill_all();
+                return;
+            }
+            const auto &pkt = event.packet;
+            std::string payload(pkt.payload.begin(), pkt.payload.end());
+            switch (pkt.header.flags)
+            {
+            case WORK:
+                std::cout << "Received WORK from upstream: " << payload << "\n";
+                take_upstream_work(pkt);
+                break;
+            case CANCEL:
+                cancel_upstream(payload);
+                break;
+            case STRIDE:
+                std::cerr << "Error: upstream runs --strided, whose lanes a relay can't pass on\n";
+                upstream_done = true;
+                job.end_time = std::chrono::steady_clock::now();
+                kill_all();
+                break;
+            case KILL:
+                std::cout << "Received KILL from upstream\n";
+                upstream_done = true;
+                job.end_time = std::chrono::steady_clock::now();
+                kill_all();
+                break;
+            default:
+                std::cerr << "Unexpected packet from upstream: " << static_cast<int>(pkt.header.flags) << "\n";
+                break;
+            }
+        };
+
+        auto handle_packet = [&](uint64_t client, const Packet &pkt)
+        {
+            switch (pkt.header.flags)
+            {
+            case WORKREQ:
+            {
+                std::cout << "Received WORKREQ packet from client " << client << "\n";
+                ++work_requests;
+                auto num_threads = pkt.payload.empty() ? uint8_t(1) : pkt.payload[0];
+                if (args.strided)
+                {
+                    // New or out of lanes: the next deal includes it
+                    stride_plan.join(client, num_threads);
+                    break;
+                }
+                if (!hand_out(client, num_threads) && range_mode)
+                {
+                    // Every range is out: wait for one to free up or to
+                    // straggle (the KILL follows if all are done)
+                    std::cout << "No range free for client " << client << ", waiting\n";
+                    idle[client] = num_threads;
+                }
+                break;
+            }
+            case WORKFIN:
+            {
+                std::cout << "Received WORKFIN packet from client " << client << "\n";
+                std::string last_prefix(pkt.payload.begin(), pkt.payload.end());
+                if (!range_mode)
                 {
-                    std::vector<uint8_t> buffer;
-                    ssize_t n = recv_full_packet(pfd.fd, buffer); // Use our robust helper
-                    if (n <= 0)
+                    if (update_prefix(last_prefix, partitions) != 0)
                     {
-                        std::cout << "Client disconnected (fd: " << pfd.fd << ")\n";
-                        ::close(pfd.fd);
-                        pfd.fd = -1; // Mark for removal
-                        continue;
+                        std::cerr << "Failed to update prefix from WORKFIN packet: " << last_prefix
+                                  << " (client: " << client << ")\n";
                     }
-                    last_activity[pfd.fd] = std::chrono::steady_clock::now();
-                    Packet pkt;
-                    int rc = deserialize(buffer.data(), buffer.size(), pkt);
-                    if (rc != 0)
+                }
+                else if (size_t index = finish_lease(job, client, last_prefix, send); relay && index < job.ranges.size())
+                {
+                    auto parent = upstream_lease_of(index);
+                    if (parent != upstream_leases.end())
+                        report_upstream(parent);
+                }
+                if (trace_enabled() && !last_prefix.empty())
+                {
+                    auto id = trace_id(client);
+                    auto &starts = lease_starts[client];
+                    auto it = starts.find(lease_key(last_prefix, range_mode));
+                    if (it != starts.end())
                     {
-                        std::cerr << "Failed to deserialize packet from client (fd: " << pfd.fd << "), error code: " << rc << "\n";
-                        ::close(pfd.fd);
-                        pfd.fd = -1;
-                        continue;
+                        trace_span("lease", id, TRACE_TID_CONTROLLER, it->second, trace_now_us(),
+                                   "finished at " + last_prefix);
+                        starts.erase(it);
                     }
-                    ++total_pkts;
-                    // Handle the packet
-                    switch (pkt.header.flags)
+                    trace_instant("WORKFIN applied", id, TRACE_TID_CONTROLLER, last_prefix);
+                }
+                break;
+            }
+            case CHECK:
+            {
+                print_checkpoint_info(client, pkt); // Could do: optimize sending next work based on work remaining
+                std::string last_prefix_chk(pkt.payload.begin(), pkt.payload.end());
+                if (!range_mode)
+                {
+                    if (update_prefix(last_prefix_chk, partitions) != 0)
                     {
-                    case WORKREQ:
+                        std::cerr << "Failed to update prefix from CHECK packet: " << last_prefix_chk
+                                  << " (client: " << client << ")\n";
+                    }
+                    else
                     {
-                        std::cout << "Received WORKREQ packet from fd " << pfd.fd << "\n";
-                        ++work_requests;
-                        auto num_threads = pkt.payload[0];
-                        auto prefixes = generate_work_prefixes(partitions, part_index, num_threads);
-                        if (send_work(pfd.fd, DEFAULT_RETRIES, args, prefixes) != 0)
-                        {
-                            std::cerr << "Failed to send WORK packet to client (fd: " << pfd.fd << ")\n";
-                            ::close(pfd.fd);
-                            pfd.fd = -1;
-                        }
-                        ++total_pkts;
-                        if (!start_time_set)
-                        {
-                            start_time = std::chrono::steady_clock::now();
-                            start_time_set = true;
-                        }
-                        break;
+                        job.candidates += args.checkpoint_interval;
                     }
-                    case WORKFIN:
+                }
+                else
+                {
+                    uint32_t grown = 0;
+                    size_t index = check_lease(job, client, header_target_id(pkt.header), last_prefix_chk, grown);
+                    auto parent = relay && index < job.ranges.size() ? upstream_lease_of(index) : upstream_leases.end();
+                    if (parent != upstream_leases.end())
                     {
-                        std::cout << "Received WORKFIN packet from fd " << pfd.fd << "\n";
-                        std::string last_prefix(pkt.payload.begin(), pkt.payload.end());
-                        if (update_prefix(last_prefix, partitions) != 0)
-                        {
-                            std::cerr << "Failed to update prefix from WORKFIN packet: " << last_prefix
-                                      << " (fd: " << pfd.fd << ")\n";
-                        }
-                        break;
+                        parent->second.done += grown;
+                        report_upstream(parent);
                     }
-                    case CHECK:
+                }
+                trace_instant("checkpoint applied", trace_id(client), TRACE_TID_CONTROLLER, last_prefix_chk);
+
+                ++checkpoints;
+                break;
+            }
+            case STRIDE:
+            {
+                std::istringstream tokens(std::string(pkt.payload.begin(), pkt.payload.end()));
+                std::string token;
+                while (tokens >> token)
+                {
+                    if (!stride_plan.report(client, pkt.header.work_size, token))
+                        std::cerr << "Ignoring stale or unknown lane " << token << " from client " << client << "\n";
+                }
+                if (pkt.header.checkpoint_interval == 1)
+                {
+                    std::cout << "Client " << client << " stopped its lanes\n";
+                    stride_plan.stopped(client);
+                }
+                ++checkpoints;
+                break;
+            }
+            case PWDFND:
+            {
+                std::cout << "Received PWDFND packet from client " << client << "\n";
+                auto id = header_target_id(pkt.header);
+                std::string found_password(pkt.payload.begin(), pkt.payload.end());
+                if (!record_crack(job, id, found_password))
+                {
+                    std::cerr << "Ignoring PWDFND for unknown or already cracked target " << id << "\n";
+                    break;
+                }
+                cracked_changed = true;
+                std::cout << "Password found: " << found_password << " (" << args.hashes[id] << ")\n";
+                potfile.add(args.hashes[id], found_password);
+                if (relay && upstream.send(pwdfnd_packet(upstream_ids[id], found_password)) != 0)
+                {
+                    std::cerr << "Failed to send PWDFND upstream\n";
+                }
+                std::cout << "Targets remaining: " << job.targets_left << "\n";
+                trace_instant("PWDFND", trace_id(client), TRACE_TID_CONTROLLER, found_password);
+                if (job.targets_left > 0)
+                    break;
+                job.end_time = std::chrono::steady_clock::now();
+                kill_all();
+                break;
+            }
+            default:
+                std::cerr << "Unknown packet flag: " << static_cast<int>(pkt.header.flags) << "\n";
+                break;
+            }
+        };
+
+        dispatch.on_events({[&](const ShardEvent &event)
+                            {
+                                if (!trace_enabled())
+                                    return;
+                                auto id = trace_conn_id(event.detail);
+                                trace_ids[event.conn] = id;
+                                trace_name_process(id, "worker " + event.detail);
+                                trace_name_thread(id, TRACE_TID_CONTROLLER, "controller");
+                                trace_instant("connect", id, TRACE_TID_CONTROLLER, event.detail);
+                                trace_instant("CONACK sent", id, TRACE_TID_CONTROLLER);
+                            },
+                            handle_packet, abandon, handle_upstream});
+
+        std::cout << "Server listening on port " << args.port << " (" << dispatch.io_threads() << " I/O threads)\n";
+        if (!args.unix_socket.empty())
+        {
+            std::cout << "Server listening on " << args.unix_socket << "\n";
+        }
+
+        while (job.targets_left > 0 && !exhausted && !upstream_done)
+        {
+            dispatch.wait();
+            std::vector<ShardEvent> batch;
+            while (dispatch.pop(batch))
+            {
+                for (const auto &event : batch)
+                {
+                    dispatch.handle(event);
+                    if (range_mode && !relay && job.targets_left > 0 && !exhausted &&
+                        (args.strided ? stride_plan.exhausted() : ranges_exhausted(job.ranges)))
                     {
-                        print_checkpoint_info(pfd.fd, pkt); // Could do: optimize sending next work based on work remaining
-                        std::string last_prefix_chk(pkt.payload.begin(), pkt.payload.end());
-                        if (update_prefix(last_prefix_chk, partitions) != 0)
-                        {
-                            std::cerr << "Failed to update prefix from CHECK packet: " << last_prefix_chk
-                                      << " (fd: " << pfd.fd << ")\n";
-                        }
+                        std::cout << "Keyspace fully covered: " << job.targets_left << " of " << args.hashes.size()
+                                  << " targets not found\n";
+                        exhausted = true;
+                        job.end_time = std::chrono::steady_clock::now();
+                        kill_all();
+                    }
+                }
+            }
+
+            // New workers get the targets still open; one copy per round at most
+            if (cracked_changed)
+            {
+                dispatch.publish(job.cracked);
+                cracked_changed = false;
+            }
+
+            auto now = std::chrono::steady_clock::now();
+            if (job.targets_left > 0 && !exhausted && !upstream_done)
+            {
+                for (auto waiting = idle.begin(); waiting != idle.end();)
+                {
+                    if (hand_out(waiting->first, waiting->second))
+                        waiting = idle.erase(waiting);
+                    else
+                        ++waiting;
+                }
+            }
 
-                        ++checkpoints;
-                        break;
+            if (args.strided && job.targets_left > 0 && !exhausted)
+            {
+                // Membership changed: stop everyone running, then deal again
+                // from where they stopped
+                if (stride_plan.wants_deal())
+                {
+                    for (uint64_t client : stride_plan.start_sync())
+                    {
+                        send(client, stride_packets(stride_plan.generation(), {}).front());
                     }
-                    case PWDFND:
+                }
+                if (stride_plan.ready())
+                {
+                    for (auto &[client, lanes] : stride_plan.deal())
                     {
-                        std::cout << "Received PWDFND packet from fd " << pfd.fd << "\n";
-                        password_found = true;
-                        std::string found_password(pkt.payload.begin(), pkt.payload.end());
-                        std::cout << "Password found: " << found_password << "\n";
-                        end_time = std::chrono::steady_clock::now();
-                        for (auto &entry : pollfds)
+                        std::cout << "Dealt " << lanes.size() << " lanes to client " << client << " (generation "
+                                  << stride_plan.generation() << ")\n";
+                        for (auto &packet : stride_packets(stride_plan.generation(), lanes))
                         {
-                            if (entry.fd != -1 && entry.fd != listen_fd.get())
-                            {
-                                std::cout << "Active client fd: " << entry.fd << "\n";
-                                if (send_kill(entry.fd, DEFAULT_RETRIES) != 0)
-                                {
-                                    std::cerr << "Failed to send KILL packet to client (fd: " << entry.fd << ")\n";
-                                }
-                                ++total_pkts;
-                            }
+                            send(client, std::move(packet));
                         }
-                        break;
                     }
-                    default:
-                        std::cerr << "Unknown packet flag: " << static_cast<int>(pkt.header.flags) << "\n";
-                        break;
+                    if (!job.start_time_set)
+                    {
+                        job.start_time = now;
+                        job_start_us = trace_now_us();
+                        job.start_time_set = true;
                     }
                 }
+                job.candidates = stride_plan.covered();
             }
 
-            auto now = std::chrono::steady_clock::now();
-            pollfds.erase(
-                std::remove_if(
-                    pollfds.begin(),
-                    pollfds.end(),
-                    [&](pollfd &pfd)
+            if (relay && !upstream_done)
+            {
+                // One request out at a time, for as many ranges as threads wait
+                if (!idle.empty() && !upstream_asked)
+                {
+                    unsigned threads = 0;
+                    for (const auto &[client, num_threads] : idle)
                     {
-                        if (pfd.fd == listen_fd.get())
-                            return false; // keep listening socket
-
-                        bool remove = false;
-
-                        // Check for timeout
-                        auto it = last_activity.find(pfd.fd);
-
-                        if (it != last_activity.end())
-                        {
-                            auto duration = std::chrono::duration_cast<std::chrono::seconds>(now - it->second).count();
-
-                            if (duration > args.timeout)
-                            {
-                                std::cout << "Client fd " << pfd.fd << " timed out after " << duration << "s\n";
-                                ::close(pfd.fd);
-                                last_activity.erase(it);
-                                remove = true;
-                            }
-                        }
-
-                        // Already marked for removal (e.g., disconnected)
-                        if (pfd.fd == -1)
-                            remove = true;
+                        threads += num_threads;
+                    }
+                    if (upstream.send(workreq_packet(static_cast<uint8_t>(std::min(threads, 255u)))) != 0)
+                    {
+                        std::cerr << "Failed to send WORKREQ upstream\n";
+                    }
+                    upstream_asked = true;
+                }
+                for (auto it = upstream_leases.begin(); it != upstream_leases.end();)
+                {
+                    report_upstream(it++);
+                }
+                std::vector<bool> removed;
+                while (!retired.empty() && now - retired.front().first > std::chrono::seconds(args.timeout))
+                {
+                    removed.resize(job.ranges.size());
+                    for (const auto &[end, inner_end] : retired.front().second)
+                    {
+                        size_t index = find_range(job.ranges, end, inner_end);
+                        if (index < job.ranges.size())
+                            removed[index] = true;
+                        piece_of.erase({end, inner_end});
+                    }
+                    retired.pop_front();
+                }
+                if (!removed.empty())
+                {
+                    job.leases.renumber(reshape_ranges(job.ranges, {}, removed));
+                }
+            }
 
-                        return remove;
-                    }),
-                pollfds.end());
+            const double since_progress = std::chrono::duration<double>(now - last_progress).count();
+            if (range_mode && job.start_time_set && job.targets_left > 0 && !exhausted &&
+                since_progress >= PROGRESS_INTERVAL_SEC)
+            {
+                // A relay sees only the ranges it was lent, so coverage and ETA
+                // are upstream's to tell
+                const double coverage = relay ? 0 : args.strided ? stride_plan.coverage() : ranges_coverage(job.ranges);
+                const double rate = (coverage - last_coverage) / since_progress;
+                coverage_rate = coverage_rate > 0 ? 0.3 * rate + 0.7 * coverage_rate : rate;
+                char percent[32];
+                std::snprintf(percent, sizeof(percent), "%.3f%%", coverage * 100);
+                std::cout << "Progress: ";
+                if (relay)
+                    std::cout << upstream_leases.size() << " upstream ranges, ";
+                else
+                    std::cout << percent << " covered, ";
+                std::cout << static_cast<uint64_t>((job.candidates - last_candidates) / since_progress) << " candidates/s, ";
+                if (!relay)
+                    std::cout << "ETA " << format_duration(coverage_rate > 0 ? (1 - coverage) / coverage_rate : 1e18)
+                              << ", ";
+                std::cout << dispatch.clients().size() << (dispatch.clients().size() == 1 ? " worker" : " workers");
+                double rtt_sum = 0;
+                size_t measured = 0;
+                dispatch.rtt(rtt_sum, measured);
+                if (measured > 0)
+                {
+                    char rtt[32];
+                    std::snprintf(rtt, sizeof(rtt), "%.2f", rtt_sum / measured);
+                    std::cout << ", RTT " << rtt << " ms";
+                }
+                std::cout << "\n";
+                last_progress = now;
+                last_coverage = coverage;
+                last_candidates = job.candidates;
+            }
 
-            // Remove closed RAII client FDs that no longer appear in pollfds
-            client_fds.erase(
-                std::remove_if(
-                    client_fds.begin(),
-                    client_fds.end(),
-                    [&](const Fd &fd)
-                    {
-                        // Keep only if fd.get() still exists in pollfds
-                        return std::none_of(
-                            pollfds.begin(),
-                            pollfds.end(),
-                            [&](const pollfd &p)
-                            { return p.fd == fd.get(); });
-                    }),
-                client_fds.end());
+            dispatch.flush();
+        }
+        // The KILLs are posted; each shard sends them before closing
+        dispatch.stop();
+        if (relay)
+        {
+            upstream.stop();
+        }
+        if (args.strided)
+        {
+            job.candidates = stride_plan.covered();
         }
 
-        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(end_time - start_time).count();
+        auto elapsed_ms = std::chrono::duration_cast<std::chrono::milliseconds>(job.end_time - job.start_time).count();
         double elapsed_sec = elapsed_ms / 1000.0;
+        std::cout << "Cracked targets:\n";
+        for (size_t id = 0; id < args.hashes.size(); ++id)
+        {
+            std::cout << "  " << args.hashes[id] << " : " << (job.cracked[id] ? job.found[id] : "(not found)") << "\n";
+        }
+        if (range_mode && !relay)
+        {
+            char percent[32];
+            std::snprintf(percent, sizeof(percent), "%.3f%%",
+                          (args.strided ? stride_plan.coverage() : ranges_coverage(job.ranges)) * 100);
+            std::cout << "Keyspace covered: " << percent << "\n";
+        }
         std::cout << "Total elapsed time: " << elapsed_sec << " seconds\n";
-        std::cout << "Total connections: " << connects << "\n";
+        std::cout << "Total connections: " << dispatch.connects() << "\n";
         std::cout << "Total work requests: " << work_requests << "\n";
         std::cout << "Total checkpoints: " << checkpoints << "\n";
-        std::cout << "Estimated total candidates tried: " << checkpoints * args.checkpoint_interval << "\n";
-        std::cout << "Total packets processed: " << total_pkts << "\n";
+        std::cout << "Estimated total candidates tried: " << job.candidates << "\n";
+        std::cout << "Total packets processed: " << dispatch.packets() << "\n";
+
+        if (trace_enabled())
+        {
+            trace_span("job", TRACE_PID_CONTROLLER, TRACE_TID_CONTROLLER, job_start_us, trace_now_us(),
+                       "work requests: " + std::to_string(work_requests) +
+                           ", checkpoints: " + std::to_string(checkpoints));
+        }
+        trace_close();
     }
     catch (const std::runtime_error &e)
     {
         std::cerr << "Error: " << e.what() << "\n";
+        trace_close();
         return 1;
     }
 
@@ -0,0 +1,108 @@
+#include "mask.h"
+#include "password.h"
+
+#include <stdexcept>
+
+namespace
+{
+    const char *builtin_charset(char name)
+    {
+        switch (name)
+        {
+        case 'l': return CHARSET_LOWER;
+        case 'u': return CHARSET_UPPER;
+        case 'd': return CHARSET_DIGIT;
+        case 's': return CHARSET_SPECIAL;
+        case 'h': return CHARSET_HEX_LOWER;
+        case 'H': return CHARSET_HEX_UPPER;
+        default: return nullptr;
+        }
+    }
+
+    // Appends the characters not already in out, keeping first-seen order
+    void add_unique(std::string &out, const std::string &chars)
+    {
+        for (char c : chars)
+            if (out.find(c) == std::string::npos)
+                out.push_back(c);
+    }
+
+    // The charset named by "?x" (custom may be null while expanding a custom charset)
+    std::string placeholder(char name, const std::array<std::string, MASK_CUSTOM_CHARSETS> *custom)
+    {
+        if (name == '?')
+            return "?";
+        if (name == 'a')
+            return std::string(CHARSET_LOWER) + CHARSET_UPPER + CHARSET_DIGIT + CHARSET_SPECIAL;
+        if (const char *set = builtin_charset(name))
+            return set;
+        if (custom && name >= '1' && name < static_cast<char>('1' + MASK_CUSTOM_CHARSETS))
+        {
+            const auto &set = (*custom)[name - '1'];
+            if (set.empty())
+                throw std::invalid_argument(std::string("Mask uses ?") + name + " but it is not defined");
+            return set;
+        }
+        throw std::invalid_argument(std::string("Unknown mask placeholder ?") + name);
+    }
+
+    std::string expand_custom(const std::string &spec)
+    {
+        std::string out;
+        for (size_t i = 0; i < spec.size(); ++i)
+        {
+            if (spec[i] != '?')
+            {
+                add_unique(out, std::string(1, spec[i]));
+                continue;
+            }
+            if (++i == spec.size())
+                throw std::invalid_argument("Custom charset ends in '?'");
+            add_unique(out, placeholder(spec[i], nullptr));
+        }
+        return out;
+    }
+}
+
+Mask::Mask(const std::string &mask, const std::array<std::string, MASK_CUSTOM_CHARSETS> &custom)
+{
+    std::array<std::string, MASK_CUSTOM_CHARSETS> sets;
+    for (size_t i = 0; i < MASK_CUSTOM_CHARSETS; ++i)
+        sets[i] = expand_custom(custom[i]);
+
+    for (size_t i = 0; i < mask.size(); ++i)
+    {
+        if (mask[i] != '?')
+        {
+            positions_.emplace_back(1, mask[i]);
+        }
+        else
+        {
+            if (++i == mask.size())
+                throw std::invalid_argument("Mask ends in '?'");
+            std::string set;
+            add_unique(set, placeholder(mask[i], &sets));
+            positions_.push_back(set);
+        }
+        if (positions_.size() > MAX_MASK_LEN)
+            throw std::invalid_argument("Mask is longer than " + std::to_string(MAX_MASK_LEN) + " positions");
+        if (keyspace_ > UINT64_MAX / positions_.back().size())
+            throw std::invalid_argument("Mask keyspace does not fit in 64 bits");
+        keyspace_ *= positions_.back().size();
+    }
+    if (positions_.empty())
+        throw std::invalid_argument("Mask is empty");
+}
+
+void Mask::decode(uint64_t index, std::string &candidate, std::vector<uint8_t> &digits) const
+{
+    candidate.resize(positions_.size());
+    digits.resize(positions_.size());
+    for (size_t pos = positions_.size(); pos-- > 0;)
+    {
+        const auto &set = positions_[pos];
+        digits[pos] = static_cast<uint8_t>(index % set.size());
+        candidate[pos] = set[digits[pos]];
+        index /= set.size();
+    }
+}
@@ -1,4 +1,6 @@
 #include "network.h"
+#include <sys/un.h>
+#include <cstdio>
 
 bool make_fd_non_blocking(int fd)
 {
@@ -8,7 +10,7 @@ bool make_fd_non_blocking(int fd)
     return fcntl(fd, F_SETFL, flags | O_NONBLOCK) != -1;
 }
 
-int create_listen_socket(int port)
+int create_listen_socket(int port, bool reuse_port)
 {
     auto sock = ::socket(AF_INET, SOCK_STREAM, 0);
     if (sock < 0)
@@ -18,6 +20,11 @@ int create_listen_socket(int port)
 
     int opt = 1;
     setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (reuse_port && setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) == -1)
+    {
+        ::close(sock);
+        throw std::runtime_error("Error setting SO_REUSEPORT");
+    }
 
     sockaddr_in addr{};
     addr.sin_family = AF_INET;
@@ -45,6 +52,40 @@ int create_listen_socket(int port)
     return sock;
 }
 
+int create_unix_listen_socket(const std::string &path)
+{
+    auto sock = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (sock < 0)
+    {
+        throw std::runtime_error("Error creating Unix socket");
+    }
+
+    sockaddr_un addr{};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    ::unlink(path.c_str());
+
+    if (::bind(sock, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == -1)
+    {
+        ::close(sock);
+        throw std::runtime_error("Error binding Unix socket " + path);
+    }
+
+    if (!make_fd_non_blocking(sock))
+    {
+        ::close(sock);
+        throw std::runtime_error("Error making socket non-blocking");
+    }
+
+    if (::listen(sock, SOMAXCONN) == -1)
+    {
+        ::close(sock);
+        throw std::runtime_error("Error listening on Unix socket " + path);
+    }
+
+    return sock;
+}
+
 ssize_t serialize(const Packet &packet, std::vector<uint8_t> &buffer)
 {
     buffer.clear();
@@ -108,7 +149,16 @@ int send_all(int fd, const uint8_t *data, size_t len)
     size_t total_sent = 0;
     while (total_sent < len)
     {
-        ssize_t sent = ::send(fd, data + total_sent, len - total_sent, 0);
+        ssize_t sent = ::send(fd, data + total_sent, len - total_sent, MSG_NOSIGNAL);
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR))
+        {
+            // Non-blocking socket with a full send buffer (e.g. a long target
+            // list): wait for the peer to drain it rather than drop the stream
+            pollfd pfd{fd, POLLOUT, 0};
+            if (errno == EINTR || poll(&pfd, 1, SEND_WAIT_MS) > 0)
+                continue;
+            return -1;
+        }
         if (sent <= 0)
         {
             return -1; // Error or connection closed
@@ -165,17 +215,21 @@ ssize_t recv_full_packet(int fd, std::vector<uint8_t> &buffer)
     return static_cast<ssize_t>(buffer.size()); // total bytes read
 }
 
-int send_conack(int client_fd, int retries, const Args &args)
+static const char *flag_name(uint8_t flags)
+{
+    static const char *const names[] = {"CONACK", "WORK", "KILL", "REQLOG", "WORKLOG", "WORKREQ",
+                                        "WORKFIN", "CHECK", "PWDFND", "TARGETS", "CANCEL", "HEARTBEAT",
+                                        "STRIDE", "DRAIN", "WORKMORE"};
+    return flags < sizeof(names) / sizeof(names[0]) ? names[flags] : "unknown";
+}
+
+int send_packet(int client_fd, int retries, const Packet &pkt)
 {
-    Packet pkt;
-    pkt.header.flags = CONACK;
-    pkt.header.data_len = static_cast<uint8_t>(args.hash.size());
-    pkt.payload.insert(pkt.payload.end(), args.hash.begin(), args.hash.end());
     std::vector<uint8_t> buffer;
     ssize_t ret = serialize(pkt, buffer);
     if (ret < 0)
     {
-        std::cerr << "Failed to serialize CONACK packet\n";
+        std::cerr << "Failed to serialize " << flag_name(pkt.header.flags) << " packet\n";
         return -1;
     }
 
@@ -186,89 +240,188 @@ int send_conack(int client_fd, int retries, const Args &args)
         {
             return 0; // Success
         }
-        std::cerr << "Failed to send CONACK, attempt " << (attempt + 1) << "\n";
+        std::cerr << "Failed to send " << flag_name(pkt.header.flags) << ", attempt " << (attempt + 1) << "\n";
     }
     return -1; // Failed after retries
 }
 
-int send_work(int client_fd, int retries, const Args &args, const std::vector<std::string> &prefixes)
+std::vector<Packet> conack_packets(const std::vector<std::string> &hashes, const std::vector<bool> &cracked,
+                                   const std::string &attack, bool queue)
 {
-    Packet pkt;
-    pkt.header.flags = WORK;
-    pkt.header.work_size = static_cast<uint16_t>(args.work_size);
-    pkt.header.checkpoint_interval = static_cast<uint16_t>(args.checkpoint_interval);
-    std::cout << "Preparing to send WORK packet with work_size: " << pkt.header.work_size
-              << " and checkpoint_interval: " << pkt.header.checkpoint_interval << "\n";
-
-    size_t total_size = 0;
-    if (!prefixes.empty())
+    // A packet covers consecutive ids only, since only the first id is sent
+    std::vector<Packet> packets;
+    Packet targets;
+    targets.header.flags = TARGETS;
+    auto add_targets = [&]() {
+        targets.header.data_len = static_cast<uint8_t>(targets.payload.size());
+        packets.push_back(targets);
+        targets.payload.clear();
+    };
+
+    uint32_t next_id = 0;
+    for (uint32_t id = 0; id < hashes.size(); ++id)
     {
-        for (const auto &prefix : prefixes)
+        if (cracked[id])
+            continue;
+        const auto &hash = hashes[id];
+        if (!targets.payload.empty() &&
+            (id != next_id || targets.payload.size() + 1 + hash.size() > MAX_PAYLOAD))
         {
-            total_size += prefix.size();
+            add_targets();
         }
-        total_size += prefixes.size() - 1;
+        if (targets.payload.empty())
+        {
+            set_header_target_id(targets.header, id);
+        }
+        else
+        {
+            targets.payload.push_back('\n');
+        }
+        targets.payload.insert(targets.payload.end(), hash.begin(), hash.end());
+        next_id = id + 1;
     }
-
-    if (total_size > 255)
+    if (!targets.payload.empty())
     {
-        std::cerr << "Error: total payload too large for data_len\n";
-        return -1;
+        add_targets();
     }
-    pkt.header.data_len = static_cast<uint8_t>(total_size);
 
-    pkt.payload.reserve(total_size);
-    for (size_t i = 0; i < prefixes.size(); ++i)
+    Packet pkt;
+    pkt.header.flags = CONACK;
+    pkt.header.data_len = static_cast<uint8_t>(attack.size());
+    pkt.header.work_size = queue ? 1 : 0;
+    pkt.header.checkpoint_interval = 0;
+    pkt.payload.assign(attack.begin(), attack.end());
+    packets.push_back(std::move(pkt));
+    return packets;
+}
+
+std::vector<Packet> work_packets(const Args &args, const std::vector<std::string> &prefixes)
+{
+    std::vector<Packet> packets(1);
+    for (const auto &prefix : prefixes)
     {
-        const auto &prefix = prefixes[i];
-        pkt.payload.insert(pkt.payload.end(), prefix.begin(), prefix.end());
-        if (i != prefixes.size() - 1)
+        if (!packets.back().payload.empty() && packets.back().payload.size() + 1 + prefix.size() > MAX_PAYLOAD)
         {
-            pkt.payload.push_back(' ');
+            packets.emplace_back();
         }
-    }
-
-    std::vector<uint8_t> buffer;
-    ssize_t ret = serialize(pkt, buffer);
-    if (ret < 0)
-    {
-        std::cerr << "Failed to serialize WORK packet\n";
-        return ret;
-    }
-    for (int attempt = 0; attempt < retries; ++attempt)
-    {
-        int n = send_all(client_fd, buffer.data(), buffer.size());
-        if (n == static_cast<int>(buffer.size()))
+        auto &payload = packets.back().payload;
+        if (!payload.empty())
         {
-            return 0; // Success
+            payload.push_back(' ');
         }
-        std::cerr << "Failed to send WORK, attempt " << (attempt + 1) << "\n";
+        payload.insert(payload.end(), prefix.begin(), prefix.end());
     }
-    return 0;
+    for (size_t i = 0; i < packets.size(); ++i)
+    {
+        packets[i].header.flags = i + 1 == packets.size() ? WORK : WORKMORE;
+        packets[i].header.data_len = static_cast<uint8_t>(packets[i].payload.size());
+        packets[i].header.work_size = static_cast<uint16_t>(args.work_size);
+        packets[i].header.checkpoint_interval = static_cast<uint16_t>(args.checkpoint_interval);
+    }
+    std::cout << "Preparing to send WORK with " << prefixes.size() << " tokens in " << packets.size()
+              << " packets, work_size: " << packets.back().header.work_size
+              << " and checkpoint_interval: " << packets.back().header.checkpoint_interval << "\n";
+    return packets;
 }
 
-int send_kill(int client_fd, int retries)
+Packet kill_packet()
 {
     Packet pkt;
     pkt.header.flags = KILL;
-    pkt.header.data_len = 0; 
+    pkt.header.data_len = 0;
+    pkt.header.work_size = 0;
+    pkt.header.checkpoint_interval = 0;
+    return pkt;
+}
 
-    std::vector<uint8_t> buffer;
-    ssize_t ret = serialize(pkt, buffer);
-    if (ret < 0)
-    {
-        std::cerr << "Failed to serialize KILL packet\n";
-        return -1;
-    }
+Packet cancel_packet(const std::string &token)
+{
+    Packet pkt;
+    pkt.header.flags = CANCEL;
+    pkt.header.work_size = 0;
+    pkt.header.checkpoint_interval = 0;
+    pkt.header.data_len = static_cast<uint8_t>(token.size());
+    pkt.payload.assign(token.begin(), token.end());
+    return pkt;
+}
 
-    for (int attempt = 0; attempt < retries; ++attempt)
+Packet heartbeat_packet(uint64_t sent_us)
+{
+    char stamp[17];
+    std::snprintf(stamp, sizeof(stamp), "%llx", static_cast<unsigned long long>(sent_us));
+    Packet pkt;
+    pkt.header.flags = HEARTBEAT;
+    pkt.header.work_size = 0;
+    pkt.header.checkpoint_interval = 0;
+    pkt.header.data_len = static_cast<uint8_t>(std::strlen(stamp));
+    pkt.payload.assign(stamp, stamp + pkt.header.data_len);
+    return pkt;
+}
+
+std::vector<Packet> stride_packets(uint16_t generation, const std::vector<std::string> &lanes)
+{
+    std::vector<Packet> packets(1);
+    for (const auto &lane : lanes)
     {
-        int n = send_all(client_fd, buffer.data(), buffer.size());
-        if (n == static_cast<int>(buffer.size()))
+        if (!packets.back().payload.empty() && packets.back().payload.size() + 1 + lane.size() > MAX_PAYLOAD)
         {
-            return 0; // Success
+            packets.emplace_back();
+        }
+        auto &payload = packets.back().payload;
+        if (!payload.empty())
+        {
+            payload.push_back(' ');
         }
-        std::cerr << "Failed to send KILL, attempt " << (attempt + 1) << "\n";
+        payload.insert(payload.end(), lane.begin(), lane.end());
     }
-    return -1; 
+    for (size_t i = 0; i < packets.size(); ++i)
+    {
+        packets[i].header.flags = STRIDE;
+        packets[i].header.data_len = static_cast<uint8_t>(packets[i].payload.size());
+        packets[i].header.work_size = generation;
+        packets[i].header.checkpoint_interval = static_cast<uint16_t>(packets.size() - 1 - i);
+    }
+    return packets;
+}
+
+Packet workreq_packet(uint8_t num_threads)
+{
+    Packet pkt;
+    pkt.header.flags = WORKREQ;
+    pkt.header.data_len = 1;
+    pkt.header.work_size = 0;
+    pkt.header.checkpoint_interval = 0;
+    pkt.payload.push_back(num_threads);
+    return pkt;
+}
+
+Packet check_packet(uint32_t work_done, const std::string &token)
+{
+    Packet pkt;
+    pkt.header.flags = CHECK;
+    set_header_target_id(pkt.header, work_done);
+    pkt.header.data_len = static_cast<uint8_t>(token.size());
+    pkt.payload.assign(token.begin(), token.end());
+    return pkt;
+}
+
+Packet workfin_packet(const std::string &token)
+{
+    Packet pkt;
+    pkt.header.flags = WORKFIN;
+    pkt.header.work_size = 0;
+    pkt.header.checkpoint_interval = 0;
+    pkt.header.data_len = static_cast<uint8_t>(token.size());
+    pkt.payload.assign(token.begin(), token.end());
+    return pkt;
+}
+
+Packet pwdfnd_packet(uint32_t target_id, const std::string &password)
+{
+    Packet pkt;
+    pkt.header.flags = PWDFND;
+    set_header_target_id(pkt.header, target_id);
+    pkt.header.data_len = static_cast<uint8_t>(password.size());
+    pkt.payload.assign(password.begin(), password.end());
+    return pkt;
 }
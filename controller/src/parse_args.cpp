@@ -1,12 +1,54 @@
 #include "parse_args.h"
+#include "hash_file.h"
+#include "ranges.h"
+
+#include <sys/un.h>
+#include <thread>
 
 void print_args(const Args &args)
 {
     std::cout << "Port: " << args.port << "\n";
+    if (!args.unix_socket.empty())
+        std::cout << "Unix Socket: " << args.unix_socket << "\n";
     std::cout << "Work Size: " << args.work_size << "\n";
     std::cout << "Checkpoint Interval: " << args.checkpoint_interval << "\n";
     std::cout << "Timeout: " << args.timeout << "\n";
-    std::cout << "Hash: " << args.hash << "\n";
+    if (!args.upstream.empty())
+        std::cout << "Upstream: " << args.upstream << " (relay)\n";
+    if (!args.jobs_file.empty())
+        std::cout << "Jobs: " << args.jobs_file << "\n";
+    else
+        std::cout << "Hashes: " << args.hashes.size() << "\n";
+    for (const auto &hash : args.hashes)
+        if (args.hashes.size() <= 10)
+            std::cout << "  " << hash << "\n";
+    if (!args.hash_file.empty())
+        std::cout << "Hash File: " << args.hash_file << "\n";
+    if (!args.wordlist.empty())
+        std::cout << "Wordlist: " << args.wordlist << "\n";
+    if (!args.rules.empty())
+        std::cout << "Rules: " << args.rules << "\n";
+    if (!args.mask.empty())
+        std::cout << "Mask: " << args.mask << "\n";
+    for (size_t i = 0; i < args.charsets.size(); ++i)
+        if (!args.charsets[i].empty())
+            std::cout << "Charset ?" << i + 1 << ": " << args.charsets[i] << "\n";
+    if (!args.markov.empty())
+        std::cout << "Markov Corpus: " << args.markov << "\n";
+    if (!args.combine.empty())
+        std::cout << "Combine With: " << args.combine << "\n";
+    if (args.mask_first)
+        std::cout << "Mask First: yes\n";
+    if (args.depth_first)
+        std::cout << "Depth First: yes\n";
+    else if (args.wordlist.empty() && args.mask.empty() && args.upstream.empty())
+        std::cout << "Lengths: " << args.min_length << "-" << args.max_length << "\n";
+    if (args.strided)
+        std::cout << "Strided: yes\n";
+    std::cout << "I/O Threads: " << args.io_threads << "\n";
+    std::cout << "Potfile: " << (args.potfile.empty() ? "(none)" : args.potfile) << "\n";
+    if (!args.trace_path.empty())
+        std::cout << "Trace File: " << args.trace_path << "\n";
 }
 
 int parse_args(int argc, char* argv[], Args &args) {
@@ -16,12 +58,34 @@ int parse_args(int argc, char* argv[], Args &args) {
         {"checkpoint",  required_argument, 0, 'c'},
         {"timeout",     required_argument, 0, 't'},
         {"hash",        required_argument, 0, 'h'},
+        {"hash-file",   required_argument, 0, 'f'},
+        {"wordlist",    required_argument, 0, 'W'},
+        {"rules",       required_argument, 0, 'r'},
+        {"mask",        required_argument, 0, 'm'},
+        {"charset1",    required_argument, 0, '1'},
+        {"charset2",    required_argument, 0, '2'},
+        {"charset3",    required_argument, 0, '3'},
+        {"charset4",    required_argument, 0, '4'},
+        {"markov",      required_argument, 0, 'M'},
+        {"combine",     required_argument, 0, 'C'},
+        {"mask-first",  no_argument,       0, 'F'},
+        {"min-length",  required_argument, 0, 'l'},
+        {"max-length",  required_argument, 0, 'L'},
+        {"depth-first", no_argument,       0, 'D'},
+        {"io-threads",  required_argument, 0, 'I'},
+        {"upstream",    required_argument, 0, 'U'},
+        {"strided",     no_argument,       0, 'S'},
+        {"unix",        required_argument, 0, 'u'},
+        {"jobs",        required_argument, 0, 'J'},
+        {"potfile",     required_argument, 0, 'P'},
+        {"no-potfile",  no_argument,       0, 'N'},
+        {"trace",       required_argument, 0, 'T'},
         {0, 0, 0, 0} 
     };
 
     int option_index = 0;
     int opt;
-    while ((opt = getopt_long(argc, argv, "p:w:c:t:h:", long_options, &option_index)) != -1) {
+    while ((opt = getopt_long(argc, argv, "p:w:c:t:h:f:W:r:m:1:2:3:4:M:C:Fl:L:DI:U:Su:J:P:NT:", long_options, &option_index)) != -1) {
         try {
             switch (opt) {
                 case 'p':
@@ -58,12 +122,124 @@ int parse_args(int argc, char* argv[], Args &args) {
                     if(!is_valid_hash(std::string(optarg))) {
                         throw std::invalid_argument("Invalid hash format");
                     }
-                    args.hash = optarg;
+                    if(std::string(optarg).size() > 255) {
+                        throw std::invalid_argument("Hash string must fit in one packet (255 bytes)");
+                    }
+                    args.hashes.push_back(optarg);
+                    break;
+                case 'f':
+                    if(!optarg || std::string(optarg).empty()) {
+                        throw std::invalid_argument("Hash file path cannot be empty");
+                    }
+                    args.hash_file = optarg;
+                    break;
+                case 'W':
+                    if(!optarg || std::string(optarg).empty()) {
+                        throw std::invalid_argument("Wordlist path cannot be empty");
+                    }
+                    args.wordlist = optarg;
+                    break;
+                case 'r':
+                    if(!optarg || std::string(optarg).empty()) {
+                        throw std::invalid_argument("Rules file path cannot be empty");
+                    }
+                    args.rules = optarg;
+                    break;
+                case 'm':
+                    if(!optarg || std::string(optarg).empty()) {
+                        throw std::invalid_argument("Mask cannot be empty");
+                    }
+                    args.mask = optarg;
+                    break;
+                case '1':
+                case '2':
+                case '3':
+                case '4':
+                    if(!optarg || std::string(optarg).empty()) {
+                        throw std::invalid_argument("Custom charset cannot be empty");
+                    }
+                    args.charsets[opt - '1'] = optarg;
+                    break;
+                case 'M':
+                    if(!optarg || std::string(optarg).empty()) {
+                        throw std::invalid_argument("Markov corpus path cannot be empty");
+                    }
+                    args.markov = optarg;
+                    break;
+                case 'C':
+                    if(!optarg || std::string(optarg).empty()) {
+                        throw std::invalid_argument("Combinator wordlist path cannot be empty");
+                    }
+                    args.combine = optarg;
+                    break;
+                case 'F':
+                    args.mask_first = true;
+                    break;
+                case 'l':
+                case 'L':
+                {
+                    int length = std::stoi(optarg);
+                    if (length < 1) {
+                        throw std::out_of_range("Lengths must be at least 1");
+                    }
+                    (opt == 'l' ? args.min_length : args.max_length) = static_cast<unsigned>(length);
+                    break;
+                }
+                case 'D':
+                    args.depth_first = true;
+                    break;
+                case 'I':
+                {
+                    int threads = std::stoi(optarg);
+                    if (threads < 1 || threads > static_cast<int>(MAX_IO_THREADS)) {
+                        throw std::out_of_range("I/O threads must be between 1 and " + std::to_string(MAX_IO_THREADS));
+                    }
+                    args.io_threads = static_cast<unsigned>(threads);
+                    break;
+                }
+                case 'U':
+                    if(!optarg || std::string(optarg).empty()) {
+                        throw std::invalid_argument("Upstream address cannot be empty");
+                    }
+                    args.upstream = optarg;
+                    break;
+                case 'S':
+                    args.strided = true;
+                    break;
+                case 'J':
+                    if(!optarg || std::string(optarg).empty()) {
+                        throw std::invalid_argument("Jobs file path cannot be empty");
+                    }
+                    args.jobs_file = optarg;
+                    break;
+                case 'P':
+                    if(!optarg || std::string(optarg).empty()) {
+                        throw std::invalid_argument("Potfile path cannot be empty");
+                    }
+                    args.potfile = optarg;
+                    break;
+                case 'N':
+                    args.potfile.clear();
+                    break;
+                case 'u':
+                    if(!optarg || std::string(optarg).empty()) {
+                        throw std::invalid_argument("Unix socket path cannot be empty");
+                    }
+                    if (std::string(optarg).size() >= sizeof(sockaddr_un::sun_path)) {
+                        throw std::invalid_argument("Unix socket path is too long");
+                    }
+                    args.unix_socket = optarg;
+                    break;
+                case 'T':
+                    if(!optarg || std::string(optarg).empty()) {
+                        throw std::invalid_argument("Trace file path cannot be empty");
+                    }
+                    args.trace_path = optarg;
                     break;
                 case '?': 
                     throw std::invalid_argument(
                         "Invalid option: Usage: " + std::string(argv[0]) +
-                        " [--port port] [--work-size work_size] [--checkpoint checkpoint_interval] [--timeout timeout] [--hash hash]");
+                        " [--port port] [--work-size work_size] [--checkpoint checkpoint_interval] [--timeout timeout] [--hash hash]... [--hash-file file] [--wordlist file [--rules file | --combine file]] [--mask mask [--charset1..4 set] [--markov corpus] [--mask-first]] [--min-length n] [--max-length n] [--depth-first] [--io-threads n] [--upstream ip:port] [--strided] [--unix path] [--jobs file] [--potfile file | --no-potfile] [--trace trace.json]");
                 default:
                     throw std::invalid_argument("Unexpected error parsing options");
             }
@@ -74,41 +250,220 @@ int parse_args(int argc, char* argv[], Args &args) {
         }
     }
 
+    const bool brute_force = args.wordlist.empty() && args.mask.empty();
+    const bool lengths_given = args.min_length != 1 || args.max_length != 0;
+
+    if (args.io_threads == 0) {
+        args.io_threads = std::clamp(std::thread::hardware_concurrency(), 1u, AUTO_IO_THREADS);
+    }
+
+    // A relay's targets and attack come from upstream, a job queue's from
+    // its jobs file; only how it serves its workers is set here
+    if (!args.upstream.empty() || !args.jobs_file.empty()) {
+        bool charsets = std::any_of(args.charsets.begin(), args.charsets.end(),
+                                    [](const std::string &set) { return !set.empty(); });
+        if (!args.hashes.empty() || !args.hash_file.empty() || !brute_force || !args.rules.empty() ||
+            !args.markov.empty() || !args.combine.empty() || charsets || args.mask_first || lengths_given ||
+            args.depth_first || args.strided) {
+            std::cerr << (args.jobs_file.empty() ? "Error: a relay takes its targets and attack from --upstream\n"
+                                                 : "Error: with --jobs, targets and attacks go in the jobs file\n");
+            return -1;
+        }
+        if (!args.jobs_file.empty() && !args.trace_path.empty()) {
+            std::cerr << "Error: --trace covers a single job, not --jobs\n";
+            return -1;
+        }
+        if (!args.upstream.empty() && !args.jobs_file.empty()) {
+            std::cerr << "Error: a relay serves its upstream's job, not --jobs\n";
+            return -1;
+        }
+        return 0;
+    }
+    if ((lengths_given || args.depth_first) && !brute_force) {
+        std::cerr << "Error: --min-length, --max-length and --depth-first are for brute force only\n";
+        return -1;
+    }
+    if (lengths_given && args.depth_first) {
+        std::cerr << "Error: --depth-first has no length bounds\n";
+        return -1;
+    }
+    // Lanes walk one index space: a mask's or brute force's by length
+    if (args.strided && (!args.wordlist.empty() || args.depth_first)) {
+        std::cerr << "Error: --strided is for --mask without --wordlist, or brute force without --depth-first\n";
+        return -1;
+    }
+    if (brute_force && !args.depth_first) {
+        unsigned longest = max_indexable_length(args.min_length, args.strided ? MAX_STRIDED_KEYSPACE : UINT64_MAX);
+        if (args.max_length == 0) {
+            args.max_length = longest;
+        }
+        if (args.max_length < args.min_length || args.max_length > longest) {
+            std::cerr << "Error: lengths must satisfy " << args.min_length << " <= max-length <= " << longest << "\n";
+            return -1;
+        }
+    }
+
+    if (!args.rules.empty() && args.wordlist.empty()) {
+        std::cerr << "Error: --rules needs --wordlist\n";
+        return -1;
+    }
+
+    // --wordlist plus --mask is a hybrid attack; --rules and --combine are
+    // the other ways to give a wordlist a second dimension
+    if (!args.wordlist.empty() &&
+        (!args.rules.empty()) + (!args.combine.empty()) + (!args.mask.empty()) > 1) {
+        std::cerr << "Error: use at most one of --rules, --combine and --mask with --wordlist\n";
+        return -1;
+    }
+
+    if (!args.combine.empty() && args.wordlist.empty()) {
+        std::cerr << "Error: --combine needs --wordlist\n";
+        return -1;
+    }
+
+    if (args.mask_first && (args.mask.empty() || args.wordlist.empty())) {
+        std::cerr << "Error: --mask-first needs --mask and --wordlist\n";
+        return -1;
+    }
+
+    if (!args.markov.empty() && args.mask.empty()) {
+        std::cerr << "Error: --markov needs --mask\n";
+        return -1;
+    }
+
+    if (!args.hash_file.empty()) {
+        HashFileStats stats;
+        if (load_hash_file(args.hash_file, args.hashes, stats) != 0) {
+            return -1;
+        }
+        std::cout << "Loaded " << stats.loaded << " of " << stats.lines << " hashes from " << args.hash_file
+                  << " in " << stats.seconds << "s";
+        if (stats.malformed > 0) {
+            std::cout << " (" << stats.malformed << " malformed, first on line " << stats.first_malformed << ")";
+        }
+        std::cout << "\n";
+    }
+
+    // Repeats of the same hash would only be cracked twice
+    if (size_t removed = dedupe_hashes(args.hashes)) {
+        std::cout << "Dropped " << removed << " duplicate hashes\n";
+    }
+
+    if (args.hashes.empty()) {
+        if (!args.hash_file.empty()) {
+            std::cerr << "Error: no valid hashes in " << args.hash_file << "\n";
+            return -1;
+        }
+        args.hashes.push_back(DEFAULT_HASH_SIX);
+    }
+
     return 0;
 
 }
 
-#include <regex>
-#include <string>
+namespace
+{
+    bool is_hex(char c)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f') || (c >= 'A' && c <= 'F');
+    }
 
-int is_valid_hash(const std::string &hash)
+    // crypt(3)'s base64 alphabet: [./A-Za-z0-9]
+    bool is_b64(char c)
+    {
+        return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '.' || c == '/';
+    }
+
+    // Advances p over up to max characters accepted by pred; returns how many
+    template <typename Pred>
+    size_t span(const char *&p, const char *end, size_t max, Pred pred)
+    {
+        size_t n = 0;
+        while (p < end && n < max && pred(*p))
+        {
+            ++p;
+            ++n;
+        }
+        return n;
+    }
+
+    bool all_of(const char *p, const char *end, bool (*pred)(char))
+    {
+        for (; p < end; ++p)
+            if (!pred(*p))
+                return false;
+        return true;
+    }
+
+    // "$salt$digest" with a salt of min_salt..max_salt and exactly digest_len characters
+    bool salted_b64(const char *p, const char *end, size_t min_salt, size_t max_salt, size_t digest_len)
+    {
+        size_t salt = span(p, end, max_salt, is_b64);
+        if (salt < min_salt || p == end || *p++ != '$')
+            return false;
+        return static_cast<size_t>(end - p) == digest_len && all_of(p, end, is_b64);
+    }
+}
+
+// Single pass over the text; accepts exactly the formats the worker cracks:
+//   raw MD5 / SHA-1 / SHA-256 hex, $3$$ / $NT$ NTLM, $1$ md5crypt,
+//   $2a$ / $2b$ / $2y$ bcrypt, $y$ / $7$ yescrypt, $5$ / $6$ SHA-crypt
+int is_valid_hash(const char *hash, size_t len)
 {
-    static const std::regex md5_regex(
-        "^[A-Fa-f0-9]{32}$"
-    );
-    
-    static const std::regex bcrypt_regex(
-        R"(^\$2[aby]\$([0-2][0-9]|3[0-1])\$[./A-Za-z0-9]{53}$)"
-    );
-
-    static const std::regex yescrypt_regex(
-        R"(^\$(y|7)\$[^\$]+\$[./A-Za-z0-9]+\$[./A-Za-z0-9]+$)"
-    );
-
-    static const std::regex sha256crypt_regex(
-        R"(^\$5\$[A-Za-z0-9./]{1,16}\$[A-Za-z0-9./]{43}$)"
-    );
-
-    static const std::regex sha512crypt_regex(
-        R"(^\$6\$[A-Za-z0-9./]{1,16}\$[A-Za-z0-9./]{86}$)"
-    );
-
-    if (std::regex_match(hash, md5_regex))        return 1;
-    if (std::regex_match(hash, sha256crypt_regex)) return 1;
-    if (std::regex_match(hash, sha512crypt_regex)) return 1;
-    if (std::regex_match(hash, bcrypt_regex))     return 1;
-    if (std::regex_match(hash, yescrypt_regex))   return 1;
+    const char *p = hash, *end = hash + len;
+    if (len == 0)
+        return 0;
+
+    if (*p != '$')
+        return (len == 32 || len == 40 || len == 64) && all_of(p, end, is_hex);
+
+    // Everything else is "$id$..."
+    const char *id = ++p;
+    while (p < end && *p != '$')
+        ++p;
+    if (p == end)
+        return 0;
+    std::string_view tag(id, p - id);
+    ++p;
 
+    if (tag == "3" || tag == "NT")
+    {
+        if (tag == "3" && (p == end || *p++ != '$'))
+            return 0;
+        return end - p == 32 && all_of(p, end, is_hex);
+    }
+    if (tag == "1")
+        return salted_b64(p, end, 0, 8, 22);
+    if (tag == "5")
+        return salted_b64(p, end, 1, 16, 43);
+    if (tag == "6")
+        return salted_b64(p, end, 1, 16, 86);
+    if (tag == "2a" || tag == "2b" || tag == "2y")
+    {
+        if (end - p != 56 || p[0] < '0' || p[0] > '3' || p[1] < '0' || p[1] > '9' || p[2] != '$')
+            return 0;
+        if (p[0] == '3' && p[1] > '1')
+            return 0;
+        return all_of(p + 3, end, is_b64);
+    }
+    if (tag == "y" || tag == "7")
+    {
+        // params$salt$digest, params free-form but non-empty
+        const char *params = p;
+        while (p < end && *p != '$')
+            ++p;
+        if (p == params || p == end)
+            return 0;
+        ++p;
+        size_t salt = span(p, end, len, is_b64);
+        if (salt == 0 || p == end || *p++ != '$')
+            return 0;
+        return p < end && all_of(p, end, is_b64);
+    }
     return 0;
 }
 
+int is_valid_hash(const std::string &hash)
+{
+    return is_valid_hash(hash.data(), hash.size());
+}
@@ -0,0 +1,72 @@
+#include "potfile.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+int Potfile::open(const std::string &path)
+{
+    path_ = path;
+    fd_ = Fd(::open(path.c_str(), O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600));
+    if (fd_.get() < 0)
+    {
+        std::cerr << "Cannot open potfile " << path << ": " << std::strerror(errno) << "\n";
+        return -1;
+    }
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::cerr << "Cannot read potfile " << path << "\n";
+        return -1;
+    }
+    std::string line;
+    size_t skipped = 0;
+    bool torn = false;
+    while (std::getline(in, line))
+    {
+        torn = in.eof(); // no newline: a write cut short
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        auto colon = line.find(':');
+        if (colon == std::string::npos || colon == 0)
+        {
+            skipped += !line.empty();
+            continue;
+        }
+        // The first crack of a hash stands; later lines can only repeat it
+        known_.emplace(line.substr(0, colon), line.substr(colon + 1));
+    }
+    if (torn && ::write(fd_.get(), "\n", 1) != 1)
+    {
+        std::cerr << "Cannot write potfile " << path << ": " << std::strerror(errno) << "\n";
+        return -1;
+    }
+    if (skipped > 0)
+    {
+        std::cerr << "Warning: skipped " << skipped << " malformed lines of potfile " << path << "\n";
+    }
+    return 0;
+}
+
+bool Potfile::lookup(const std::string &hash, std::string &plain) const
+{
+    auto it = known_.find(hash);
+    if (it == known_.end())
+        return false;
+    plain = it->second;
+    return true;
+}
+
+void Potfile::add(const std::string &hash, const std::string &plain)
+{
+    if (!is_open() || !known_.emplace(hash, plain).second)
+        return;
+    const std::string line = hash + ":" + plain + "\n";
+    if (::write(fd_.get(), line.data(), line.size()) != static_cast<ssize_t>(line.size()))
+    {
+        std::cerr << "Failed to append to potfile " << path_ << ": " << std::strerror(errno) << "\n";
+    }
+}
@@ -0,0 +1,273 @@
+#include "ranges.h"
+#include "password.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+    // None so small that leases are mostly overhead
+    constexpr uint64_t MIN_RANGE_CANDIDATES = 4096;
+}
+
+std::vector<IndexRange> split_keyspace(uint64_t keyspace, uint64_t target)
+{
+    std::vector<IndexRange> ranges;
+    const uint64_t range_size = std::max(keyspace / target, MIN_RANGE_CANDIDATES);
+    for (uint64_t begin = 0; begin < keyspace;)
+    {
+        uint64_t end = keyspace - begin > range_size ? begin + range_size : keyspace;
+        ranges.emplace_back(begin, end);
+        begin = end;
+    }
+    return ranges;
+}
+
+unsigned max_indexable_length(unsigned min_length, uint64_t limit)
+{
+    // count = CHAR_SET_SIZE^length, total = strings of min_length..length
+    uint64_t count = 1, total = 0;
+    for (unsigned length = 1; length < min_length; ++length)
+    {
+        if (count > limit / CHAR_SET_SIZE)
+            return 0;
+        count *= CHAR_SET_SIZE;
+    }
+    unsigned length = min_length - 1;
+    while (count <= limit / CHAR_SET_SIZE && count * CHAR_SET_SIZE <= limit - total)
+    {
+        count *= CHAR_SET_SIZE;
+        total += count;
+        ++length;
+    }
+    return length;
+}
+
+std::vector<LeaseRange> create_length_ranges(unsigned min_length, unsigned max_length, uint64_t &keyspace)
+{
+    std::vector<IndexRange> ranges;
+    uint64_t count = 1;
+    for (unsigned length = 1; length < min_length; ++length)
+        count *= CHAR_SET_SIZE;
+    keyspace = 0;
+    for (unsigned length = min_length; length <= max_length; ++length)
+    {
+        count *= CHAR_SET_SIZE;
+        for (const auto &[begin, end] : split_keyspace(count, TARGET_RANGES))
+            ranges.emplace_back(keyspace + begin, keyspace + end);
+        keyspace += count;
+    }
+    return cross_ranges(ranges, {});
+}
+
+std::vector<LeaseRange> cross_ranges(const std::vector<IndexRange> &outer, const std::vector<IndexRange> &inner)
+{
+    std::vector<LeaseRange> ranges;
+    ranges.reserve(outer.size() * std::max<size_t>(inner.size(), 1));
+    for (const auto &[begin, end] : outer)
+    {
+        if (inner.empty())
+            ranges.push_back({{begin, end}, READY, begin});
+        for (const auto &[inner_begin, inner_end] : inner)
+            ranges.push_back({{begin, end, inner_begin, inner_begin, inner_end}, READY, begin});
+    }
+    return ranges;
+}
+
+std::vector<std::string> generate_work_ranges(std::vector<LeaseRange> &ranges, const std::vector<size_t> &backups,
+                                              uint8_t num_ranges, std::vector<size_t> &leased)
+{
+    std::vector<std::string> tokens;
+    auto lease = [&](size_t index) {
+        auto &range = ranges[index];
+        range.status = IN_PROGRESS;
+        tokens.push_back(format_range(range.position));
+        leased.push_back(index);
+    };
+
+    // Lowest first, so a partly done range resumes before later ones start:
+    // wordlists are usually sorted by frequency and masks in Markov order
+    // put the likely candidates at low indices
+    for (size_t index = 0; index < ranges.size() && tokens.size() < num_ranges; ++index)
+    {
+        if (ranges[index].status == READY)
+            lease(index);
+    }
+    if (!tokens.empty())
+        return tokens;
+
+    for (size_t index : backups)
+    {
+        if (tokens.size() == num_ranges)
+            break;
+        if (ranges[index].status == IN_PROGRESS)
+            lease(index);
+    }
+    return tokens;
+}
+
+namespace
+{
+    // Ranges are kept in (end, inner_end) order, which identifies each one
+    bool range_before(const LeaseRange &a, const LeaseRange &b)
+    {
+        return a.position.end != b.position.end ? a.position.end < b.position.end
+                                                : a.position.inner_end < b.position.inner_end;
+    }
+}
+
+size_t find_range(const std::vector<LeaseRange> &ranges, uint64_t end, uint64_t inner_end)
+{
+    LeaseRange key{{0, end, 0, 0, inner_end}, READY, 0};
+    auto range = std::lower_bound(ranges.begin(), ranges.end(), key, range_before);
+    if (range == ranges.end() || range->position.end != end || range->position.inner_end != inner_end)
+        return ranges.size();
+    return static_cast<size_t>(range - ranges.begin());
+}
+
+std::vector<size_t> reshape_ranges(std::vector<LeaseRange> &ranges, std::vector<LeaseRange> added,
+                                   const std::vector<bool> &removed)
+{
+    std::sort(added.begin(), added.end(), range_before);
+    std::vector<size_t> moved(ranges.size(), SIZE_MAX);
+    std::vector<LeaseRange> merged;
+    merged.reserve(ranges.size() + added.size());
+    size_t next = 0;
+    for (size_t index = 0; index < ranges.size(); ++index)
+    {
+        if (index < removed.size() && removed[index])
+            continue;
+        while (next < added.size() && range_before(added[next], ranges[index]))
+            merged.push_back(added[next++]);
+        moved[index] = merged.size();
+        merged.push_back(ranges[index]);
+    }
+    merged.insert(merged.end(), added.begin() + next, added.end());
+    ranges = std::move(merged);
+    return moved;
+}
+
+std::vector<LeaseRange> split_range(const RangeToken &range, bool inner, uint64_t parts)
+{
+    std::vector<LeaseRange> pieces;
+    const uint64_t first = inner ? range.inner_begin : range.cursor;
+    const uint64_t last = inner ? range.inner_end : range.end;
+    // An inner piece still spans every word of the range, so any size will do
+    parts = std::max<uint64_t>(parts, 1);
+    const uint64_t size = std::max((last - first) / parts + ((last - first) % parts != 0),
+                                   inner ? uint64_t(1) : MIN_RANGE_CANDIDATES);
+    for (uint64_t begin = first; begin < last;)
+    {
+        const uint64_t end = last - begin > size ? begin + size : last;
+        RangeToken piece = range;
+        if (inner)
+        {
+            // The word at cursor already did [inner_begin, inner) of the range
+            piece.inner_begin = begin;
+            piece.inner_end = end;
+            piece.inner = std::clamp(range.inner, begin, end);
+        }
+        else
+        {
+            piece.cursor = begin;
+            piece.end = end;
+            piece.inner = begin == range.cursor ? range.inner : range.inner_begin;
+        }
+        pieces.push_back({piece, READY, piece.cursor});
+        begin = end;
+    }
+    return pieces;
+}
+
+int update_range(const std::string &token, std::vector<LeaseRange> &ranges, size_t &index)
+{
+    RangeToken reported;
+    if (!parse_range(token, reported))
+        return -1;
+    index = find_range(ranges, reported.end, reported.inner_end);
+    if (index == ranges.size())
+        return -1;
+    // Copies of one range report independently; keep the furthest
+    auto &pos = ranges[index].position;
+    if (reported.cursor > pos.cursor || (reported.cursor == pos.cursor && reported.inner > pos.inner))
+    {
+        pos.cursor = reported.cursor;
+        pos.inner = reported.inner;
+    }
+    return 0;
+}
+
+void settle_range(LeaseRange &range, bool held)
+{
+    if (range.position.cursor >= range.position.end)
+        range.status = COMPLETED;
+    else
+        range.status = held ? IN_PROGRESS : READY;
+}
+
+bool ranges_exhausted(const std::vector<LeaseRange> &ranges)
+{
+    return std::all_of(ranges.begin(), ranges.end(),
+                       [](const LeaseRange &range) { return range.status == COMPLETED; });
+}
+
+double ranges_coverage(const std::vector<LeaseRange> &ranges)
+{
+    // Sizes reach 2^64 x 2^64, so sum in floating point
+    long double total = 0, covered = 0;
+    for (const auto &range : ranges)
+    {
+        const auto &pos = range.position;
+        const long double inner = pos.inner_end > 0 ? pos.inner_end - pos.inner_begin : 1;
+        const long double size = static_cast<long double>(pos.end - range.begin) * inner;
+        total += size;
+        if (range.status == COMPLETED)
+            covered += size;
+        else
+            covered += std::min(size, static_cast<long double>(pos.cursor - range.begin) * inner +
+                                          (pos.inner - pos.inner_begin));
+    }
+    return total > 0 ? static_cast<double>(covered / total) : 1.0;
+}
+
+std::string format_range(const RangeToken &range)
+{
+    char buf[128];
+    int n = std::snprintf(buf, sizeof(buf), "%llx:%llx", static_cast<unsigned long long>(range.cursor),
+                          static_cast<unsigned long long>(range.end));
+    if (range.inner_end > 0)
+        std::snprintf(buf + n, sizeof(buf) - n, "/%llx:%llx:%llx", static_cast<unsigned long long>(range.inner),
+                      static_cast<unsigned long long>(range.inner_begin),
+                      static_cast<unsigned long long>(range.inner_end));
+    else if (range.stride > 1)
+        std::snprintf(buf + n, sizeof(buf) - n, "*%llx", static_cast<unsigned long long>(range.stride));
+    return buf;
+}
+
+bool parse_range(const std::string &token, RangeToken &range)
+{
+    unsigned long long c = 0, e = 0;
+    unsigned long long i = 0, ib = 0, ie = 0, s = 1;
+    int used = 0;
+    if (std::sscanf(token.c_str(), "%llx:%llx%n", &c, &e, &used) != 2)
+        return false;
+    // A finished lane's cursor is its first index past the end
+    if (token[used] == '*')
+    {
+        int stride_used = 0;
+        if (std::sscanf(token.c_str() + used, "*%llx%n", &s, &stride_used) != 1 ||
+            static_cast<size_t>(used + stride_used) != token.size() || s < 2 || c >= e + s)
+            return false;
+    }
+    else if (c > e)
+        return false;
+    else if (static_cast<size_t>(used) != token.size())
+    {
+        int inner_used = 0;
+        if (std::sscanf(token.c_str() + used, "/%llx:%llx:%llx%n", &i, &ib, &ie, &inner_used) != 3 ||
+            static_cast<size_t>(used + inner_used) != token.size() || ib > i || i > ie || ie == 0)
+            return false;
+    }
+    range = {c, e, i, ib, ie, s};
+    return true;
+}
@@ -0,0 +1,193 @@
+#include "relay.h"
+
+#include <algorithm>
+#include <sstream>
+
+RelaySplit relay_split(const std::string &attack)
+{
+    std::istringstream options(attack.substr(0, attack.find('\n')));
+    std::string kind, size, inner;
+    options >> kind;
+    if (kind == "lengths" || kind == "mask")
+        return RelaySplit::OUTER;
+    if (kind == "wordlist" && options >> size >> inner && (inner == "rules" || inner == "mask" || inner == "mask-first"))
+        return RelaySplit::INNER;
+    return RelaySplit::NONE;
+}
+
+RangeToken upstream_position(const UpstreamLease &lease, const std::vector<LeaseRange> &ranges)
+{
+    RangeToken position = lease.range;
+    std::vector<const RangeToken *> open;
+    for (const auto &[end, inner_end] : lease.pieces)
+    {
+        size_t index = find_range(ranges, end, inner_end);
+        if (index < ranges.size() && ranges[index].status != COMPLETED &&
+            ranges[index].position.cursor < ranges[index].position.end)
+            open.push_back(&ranges[index].position);
+    }
+    if (open.empty())
+    {
+        position.cursor = position.end;
+        position.inner = position.inner_begin;
+        return position;
+    }
+    if (lease.split != RelaySplit::INNER)
+    {
+        // Pieces follow each other, so the first open one is where it stands
+        position.cursor = open.front()->cursor;
+        position.inner = open.front()->inner;
+        return position;
+    }
+    // Pieces share the words: the slowest word is where it stands, and that
+    // word is done up to the first piece still on it
+    position.cursor = (*std::min_element(open.begin(), open.end(), [](const RangeToken *a, const RangeToken *b) {
+                          return a->cursor < b->cursor;
+                      }))->cursor;
+    for (const RangeToken *piece : open)
+    {
+        if (piece->cursor == position.cursor)
+        {
+            position.inner = piece->inner;
+            break;
+        }
+    }
+    return position;
+}
+
+Upstream::~Upstream()
+{
+    if (thread_.joinable())
+    {
+        stop();
+    }
+}
+
+int Upstream::connect(const std::string &address)
+{
+    auto colon = address.rfind(':');
+    sockaddr_in server_addr{};
+    server_addr.sin_family = AF_INET;
+    int port = colon == std::string::npos ? 0 : std::atoi(address.c_str() + colon + 1);
+    if (port < 1 || port > 65535 || inet_pton(AF_INET, address.substr(0, colon).c_str(), &server_addr.sin_addr) <= 0)
+    {
+        std::cerr << "Error: upstream must be ip:port, got " << address << "\n";
+        return -1;
+    }
+    server_addr.sin_port = htons(port);
+
+    fd_ = Fd(::socket(AF_INET, SOCK_STREAM, 0));
+    if (fd_.get() < 0 || ::connect(fd_.get(), (sockaddr *)&server_addr, sizeof(server_addr)) < 0)
+    {
+        std::cerr << "Error: failed to connect to upstream controller " << address << "\n";
+        return -1;
+    }
+    return 0;
+}
+
+int Upstream::handshake(std::vector<std::string> &hashes, std::vector<uint32_t> &ids, std::string &attack)
+{
+    while (true)
+    {
+        std::vector<uint8_t> buffer;
+        Packet pkt;
+        if (recv_full_packet(fd_.get(), buffer) <= 0 || deserialize(buffer.data(), buffer.size(), pkt) != 0)
+        {
+            std::cerr << "Error: upstream controller closed the connection before CONACK\n";
+            return -1;
+        }
+        switch (pkt.header.flags)
+        {
+        case TARGETS:
+        {
+            uint32_t id = header_target_id(pkt.header);
+            std::istringstream lines(std::string(pkt.payload.begin(), pkt.payload.end()));
+            std::string line;
+            while (std::getline(lines, line))
+            {
+                hashes.push_back(line);
+                ids.push_back(id++);
+            }
+            break;
+        }
+        case CONACK:
+            attack.assign(pkt.payload.begin(), pkt.payload.end());
+            return 0;
+        case HEARTBEAT:
+            if (send(pkt) != 0)
+                return -1;
+            break;
+        default:
+            std::cerr << "Ignoring upstream packet with flag " << static_cast<int>(pkt.header.flags)
+                      << " before CONACK\n";
+            break;
+        }
+    }
+}
+
+void Upstream::start(MpscQueue<std::vector<ShardEvent>> &events, Wakeup &scheduler)
+{
+    thread_ = std::thread(&Upstream::run, this, std::ref(events), std::ref(scheduler));
+}
+
+int Upstream::send(const Packet &pkt)
+{
+    std::lock_guard<std::mutex> lock(send_mutex_);
+    return send_packet(fd_.get(), DEFAULT_RETRIES, pkt);
+}
+
+void Upstream::stop()
+{
+    stopping_.store(true, std::memory_order_release);
+    ::shutdown(fd_.get(), SHUT_RDWR);
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+void Upstream::run(MpscQueue<std::vector<ShardEvent>> &events, Wakeup &scheduler)
+{
+    // Tokens of WORKMORE packets, joined onto the WORK that ends the lease
+    std::vector<uint8_t> more;
+    while (true)
+    {
+        std::vector<uint8_t> buffer;
+        ShardEvent event;
+        event.conn = UPSTREAM_CONN;
+        if (recv_full_packet(fd_.get(), buffer) <= 0 ||
+            deserialize(buffer.data(), buffer.size(), event.packet) != 0)
+        {
+            if (stopping_.load(std::memory_order_acquire))
+            {
+                return;
+            }
+            event.kind = ShardEvent::CLOSED;
+            event.detail = "disconnect";
+            events.push({std::move(event)});
+            scheduler.notify();
+            return;
+        }
+        if (event.packet.header.flags == HEARTBEAT)
+        {
+            if (send(event.packet) != 0)
+            {
+                std::cerr << "Failed to answer upstream HEARTBEAT\n";
+            }
+            continue;
+        }
+        if (event.packet.header.flags == WORKMORE)
+        {
+            more.insert(more.end(), event.packet.payload.begin(), event.packet.payload.end());
+            more.push_back(' ');
+            continue;
+        }
+        if (event.packet.header.flags == WORK && !more.empty())
+        {
+            event.packet.payload.insert(event.packet.payload.begin(), more.begin(), more.end());
+            more.clear();
+        }
+        events.push({std::move(event)});
+        scheduler.notify();
+    }
+}
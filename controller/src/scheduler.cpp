@@ -0,0 +1,259 @@
+#include "scheduler.h"
+#include "relay.h"
+
+#include <poll.h>
+
+#include <iostream>
+#include <stdexcept>
+
+std::vector<std::string> lease_ranges(JobState &job, const Args &args, uint64_t client, uint8_t num_threads,
+                                      const SendPacket &send)
+{
+    auto now = std::chrono::steady_clock::now();
+    std::vector<size_t> leased;
+    auto tokens = generate_work_ranges(job.ranges, job.leases.stragglers(client, now), num_threads, leased);
+    if (tokens.empty())
+    {
+        return tokens;
+    }
+    for (size_t index : leased)
+    {
+        for (uint64_t holder : job.leases.holders(index))
+        {
+            std::cout << "Straggler: client " << holder << " is slow on " << format_range(job.ranges[index].position)
+                      << job.name << ", backup copy to client " << client << "\n";
+        }
+        job.leases.grant(index, client, now);
+    }
+    job.granted += leased.size();
+    for (auto &packet : work_packets(args, tokens))
+    {
+        send(client, std::move(packet));
+    }
+    if (!job.start_time_set)
+    {
+        job.start_time = now;
+        job.start_time_set = true;
+    }
+    return tokens;
+}
+
+size_t finish_lease(JobState &job, uint64_t client, const std::string &token, const SendPacket &send)
+{
+    size_t index = 0;
+    if (update_range(token, job.ranges, index) != 0)
+    {
+        std::cerr << "Failed to update range from WORKFIN packet: " << token << " (client: " << client << ")\n";
+        return job.ranges.size();
+    }
+    job.leases.release(index, client);
+    auto others = job.leases.holders(index);
+    settle_range(job.ranges[index], !others.empty());
+    // First copy to finish wins; stop the other
+    if (job.ranges[index].status == COMPLETED)
+    {
+        for (uint64_t other : others)
+        {
+            auto finished = format_range(job.ranges[index].position);
+            std::cout << "Range " << finished << job.name << " finished by client " << client
+                      << ", cancelling its copy on client " << other << "\n";
+            send(other, cancel_packet(finished));
+            job.leases.release(index, other);
+        }
+    }
+    return index;
+}
+
+size_t check_lease(JobState &job, uint64_t client, uint32_t done, const std::string &token, uint32_t &grown)
+{
+    size_t index = 0;
+    grown = 0;
+    if (update_range(token, job.ranges, index) != 0)
+    {
+        std::cerr << "Failed to update range from CHECK packet: " << token << " (client: " << client << ")\n";
+        return job.ranges.size();
+    }
+    grown = job.leases.report(index, client, done, std::chrono::steady_clock::now());
+    job.candidates += grown;
+    return index;
+}
+
+void drop_leases(JobState &job, uint64_t client)
+{
+    for (size_t index : job.leases.drop(client))
+    {
+        settle_range(job.ranges[index], !job.leases.holders(index).empty());
+    }
+}
+
+void cancel_leases(JobState &job, const SendPacket &send)
+{
+    for (size_t index = 0; index < job.ranges.size(); ++index)
+    {
+        for (uint64_t holder : job.leases.holders(index))
+        {
+            send(holder, cancel_packet(format_range(job.ranges[index].position)));
+            job.leases.release(index, holder);
+        }
+    }
+}
+
+bool record_crack(JobState &job, size_t id, const std::string &password)
+{
+    if (id >= job.cracked.size() || job.cracked[id])
+    {
+        return false;
+    }
+    job.cracked[id] = true;
+    job.found[id] = password;
+    --job.targets_left;
+    return true;
+}
+
+Dispatcher::Dispatcher(const Args &args, const std::string &attack, const std::vector<bool> &cracked)
+    : published_(std::make_shared<const std::vector<bool>>(cracked))
+{
+    for (size_t i = 0; i < args.io_threads; ++i)
+    {
+        shards_.push_back(std::make_unique<IoShard>(i, args.io_threads, args, attack, published_, events_, wakeup_));
+    }
+    outbox_.resize(shards_.size());
+}
+
+void Dispatcher::wait()
+{
+    pollfd ready{wakeup_.fd(), POLLIN, 0};
+    if (poll(&ready, 1, boards_.empty() ? 1000 : BOARD_POLL_MS) < 0 && errno != EINTR)
+    {
+        throw std::runtime_error("poll() failed");
+    }
+    wakeup_.drain();
+    for (const auto &entry : boards_)
+    {
+        read_board(entry.first);
+    }
+}
+
+void Dispatcher::handle(const ShardEvent &event)
+{
+    const uint64_t client = event.conn;
+    if (client == UPSTREAM_CONN)
+    {
+        handlers_.upstream(event);
+        return;
+    }
+    switch (event.kind)
+    {
+    case ShardEvent::CONNECTED:
+        std::cout << "Accepted connection from " << event.detail << " (client " << client << ")"
+                  << (event.board ? ", checkpoints through shared memory\n" : "\n");
+        clients_.insert(client);
+        if (event.board)
+        {
+            boards_[client] = {event.board, std::vector<uint32_t>(BOARD_SLOTS)};
+        }
+        ++connects_;
+        packets_ += 2; // the connection and its CONACK
+        handlers_.connected(event);
+        break;
+    case ShardEvent::CLOSED:
+        std::cout << "Client " << client << " closed: " << event.detail << "\n";
+        clients_.erase(client);
+        read_board(client);
+        boards_.erase(client);
+        handlers_.gone(client, event.detail.c_str());
+        break;
+    case ShardEvent::PACKET:
+        ++packets_;
+        if (event.packet.header.flags == DRAIN)
+        {
+            drain(client, event.packet);
+            break;
+        }
+        if (event.packet.header.flags == WORKREQ)
+        {
+            read_board(client); // checkpoints of the leases it just finished, before it gets more
+        }
+        handlers_.packet(client, event.packet);
+        break;
+    }
+}
+
+void Dispatcher::publish(const std::vector<bool> &cracked)
+{
+    std::atomic_store(&published_, CrackedSnapshot(std::make_shared<const std::vector<bool>>(cracked)));
+}
+
+void Dispatcher::send(uint64_t client, Packet packet)
+{
+    outbox_[client % shards_.size()].push_back({client, std::move(packet)});
+    ++packets_;
+}
+
+void Dispatcher::kill_all()
+{
+    for (uint64_t client : clients_)
+    {
+        std::cout << "Active client: " << client << "\n";
+        send(client, kill_packet());
+    }
+}
+
+void Dispatcher::flush()
+{
+    for (size_t i = 0; i < shards_.size(); ++i)
+    {
+        if (!outbox_[i].empty())
+        {
+            shards_[i]->post(std::move(outbox_[i]));
+            outbox_[i].clear();
+        }
+    }
+}
+
+void Dispatcher::stop()
+{
+    for (auto &shard : shards_)
+    {
+        shard->stop();
+    }
+}
+
+void Dispatcher::rtt(double &sum_ms, size_t &measured) const
+{
+    for (const auto &shard : shards_)
+    {
+        shard->rtt(sum_ms, measured);
+    }
+}
+
+void Dispatcher::read_board(uint64_t client)
+{
+    auto it = boards_.find(client);
+    if (it == boards_.end())
+        return;
+    auto &[board, seen] = it->second;
+    uint32_t work_done = 0;
+    std::string token;
+    for (size_t slot = 0; slot < BOARD_SLOTS; ++slot)
+    {
+        if (board->read(slot, seen[slot], work_done, token))
+            handlers_.packet(client, check_packet(work_done, token));
+    }
+}
+
+void Dispatcher::drain(uint64_t client, const Packet &pkt)
+{
+    read_board(client);
+    if (pkt.payload.empty())
+    {
+        std::cout << "Client " << client << " drained\n";
+        clients_.erase(client);
+        boards_.erase(client);
+        handlers_.gone(client, "drained");
+        return;
+    }
+    std::string token(pkt.payload.begin(), pkt.payload.end());
+    handlers_.packet(client, check_packet(header_target_id(pkt.header), token));
+    handlers_.packet(client, workfin_packet(token));
+}
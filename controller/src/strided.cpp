@@ -0,0 +1,172 @@
+#include "strided.h"
+
+#include <algorithm>
+#include <queue>
+
+StridePlan::StridePlan(uint64_t keyspace) : keyspace_(keyspace)
+{
+    spare_.push_back({0, keyspace});
+}
+
+void StridePlan::join(uint64_t client, uint8_t threads)
+{
+    auto &member = members_[client];
+    member.threads = std::max<uint8_t>(threads, 1);
+    member.running = false;
+    // One already stopping for a deal takes part in it as it is
+    awaiting_.erase(client);
+    if (!syncing_)
+        changed_ = true;
+}
+
+void StridePlan::leave(uint64_t client)
+{
+    auto it = members_.find(client);
+    if (it == members_.end())
+        return;
+    spare_.insert(spare_.end(), it->second.lanes.begin(), it->second.lanes.end());
+    members_.erase(it);
+    awaiting_.erase(client);
+    if (!syncing_)
+        changed_ = true;
+}
+
+bool StridePlan::report(uint64_t client, uint16_t generation, const std::string &token)
+{
+    RangeToken reported;
+    auto it = members_.find(client);
+    if (generation != generation_ || it == members_.end() || !parse_range(token, reported))
+        return false;
+    for (auto &lane : it->second.lanes)
+    {
+        if (lane.stride == reported.stride && lane.end == reported.end &&
+            lane.cursor % lane.stride == reported.cursor % reported.stride)
+        {
+            lane.cursor = std::max(lane.cursor, reported.cursor);
+            return true;
+        }
+    }
+    return false;
+}
+
+void StridePlan::stopped(uint64_t client)
+{
+    auto it = members_.find(client);
+    if (it == members_.end())
+        return;
+    it->second.running = false;
+    awaiting_.erase(client);
+}
+
+std::vector<uint64_t> StridePlan::start_sync()
+{
+    changed_ = false;
+    syncing_ = true;
+    for (const auto &[client, member] : members_)
+    {
+        if (member.running)
+            awaiting_.insert(client);
+    }
+    return {awaiting_.begin(), awaiting_.end()};
+}
+
+std::vector<std::pair<uint64_t, std::vector<std::string>>> StridePlan::deal()
+{
+    syncing_ = false;
+    ++generation_;
+
+    std::vector<RangeToken> lanes;
+    lanes.swap(spare_);
+    size_t threads = 0;
+    for (auto &[client, member] : members_)
+    {
+        lanes.insert(lanes.end(), member.lanes.begin(), member.lanes.end());
+        member.lanes.clear();
+        threads += member.threads;
+    }
+    lanes.erase(std::remove_if(lanes.begin(), lanes.end(),
+                               [](const RangeToken &lane) { return remaining(lane) == 0; }),
+                lanes.end());
+    if (members_.empty())
+    {
+        spare_ = std::move(lanes);
+        return {};
+    }
+
+    // Halve the longest lanes until every thread can have one
+    auto shorter = [](const RangeToken &a, const RangeToken &b) { return remaining(a) < remaining(b); };
+    std::priority_queue<RangeToken, std::vector<RangeToken>, decltype(shorter)> longest(shorter, std::move(lanes));
+    while (longest.size() < threads && !longest.empty() && remaining(longest.top()) >= 2 &&
+           longest.top().stride <= UINT64_MAX / 2)
+    {
+        RangeToken lane = longest.top();
+        longest.pop();
+        RangeToken other = lane;
+        lane.stride *= 2;
+        other.cursor += other.stride;
+        other.stride = lane.stride;
+        longest.push(lane);
+        longest.push(other);
+    }
+
+    // Longest first, each to the member with the least work per thread
+    using Load = std::pair<double, uint64_t>;
+    std::priority_queue<Load, std::vector<Load>, std::greater<Load>> least;
+    for (const auto &[client, member] : members_)
+        least.push({0.0, client});
+    while (!longest.empty())
+    {
+        auto [load, client] = least.top();
+        least.pop();
+        auto &member = members_[client];
+        member.lanes.push_back(longest.top());
+        least.push({load + static_cast<double>(remaining(longest.top())) / member.threads, client});
+        longest.pop();
+    }
+
+    std::vector<std::pair<uint64_t, std::vector<std::string>>> dealt;
+    for (auto &[client, member] : members_)
+    {
+        member.running = !member.lanes.empty();
+        if (!member.running)
+            continue; // nothing left to split; waits for the next deal
+        std::vector<std::string> tokens;
+        for (const auto &lane : member.lanes)
+            tokens.push_back(format_range(lane));
+        dealt.emplace_back(client, std::move(tokens));
+    }
+    return dealt;
+}
+
+uint64_t StridePlan::covered() const
+{
+    uint64_t left = 0;
+    for (const auto &lane : spare_)
+        left += remaining(lane);
+    for (const auto &[client, member] : members_)
+    {
+        for (const auto &lane : member.lanes)
+            left += remaining(lane);
+    }
+    return keyspace_ - left;
+}
+
+double StridePlan::coverage() const
+{
+    return keyspace_ > 0 ? static_cast<double>(covered()) / keyspace_ : 1.0;
+}
+
+bool StridePlan::exhausted() const
+{
+    auto done = [](const RangeToken &lane) { return remaining(lane) == 0; };
+    if (syncing_ || !std::all_of(spare_.begin(), spare_.end(), done))
+        return false;
+    return std::all_of(members_.begin(), members_.end(), [&](const auto &entry) {
+        return std::all_of(entry.second.lanes.begin(), entry.second.lanes.end(), done);
+    });
+}
+
+uint64_t StridePlan::remaining(const RangeToken &lane)
+{
+    return lane.cursor >= lane.end ? 0 : (lane.end - lane.cursor - 1) / lane.stride + 1;
+}
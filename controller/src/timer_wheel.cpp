@@ -0,0 +1,60 @@
+#include "timer_wheel.h"
+
+#include <algorithm>
+
+namespace
+{
+    constexpr uint64_t WHEEL_REACH = uint64_t(1) << (WHEEL_SLOT_BITS * WHEEL_LEVELS);
+}
+
+uint64_t TimerWheel::tick_of(Clock::time_point when) const
+{
+    if (when <= start_)
+        return 0;
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(when - start_).count();
+    return static_cast<uint64_t>(elapsed) / WHEEL_TICK_MS;
+}
+
+void TimerWheel::schedule(Clock::time_point when, const ConnectionTimer &timer)
+{
+    // Never into a tick already processed; round up so a timer never fires early
+    uint64_t due = std::max(tick_of(when) + 1, current_ + 1);
+    due = std::min(due, current_ + WHEEL_REACH - 1);
+    insert({due, timer});
+}
+
+void TimerWheel::insert(const Entry &entry)
+{
+    // The lowest level whose span still reaches the due tick
+    const uint64_t delta = entry.due - current_;
+    size_t level = 0;
+    while (level + 1 < WHEEL_LEVELS && delta >= (uint64_t(1) << (WHEEL_SLOT_BITS * (level + 1))))
+        ++level;
+    const size_t slot = (entry.due >> (WHEEL_SLOT_BITS * level)) & (WHEEL_SLOTS - 1);
+    slots_[level][slot].push_back(entry);
+}
+
+void TimerWheel::advance(Clock::time_point now, std::vector<ConnectionTimer> &expired)
+{
+    const uint64_t target = tick_of(now);
+    while (current_ < target)
+    {
+        ++current_;
+        // Each time a level's digit wraps, the next level's slot for this
+        // tick comes due and its timers spread over the levels below
+        for (size_t level = 1; level < WHEEL_LEVELS; ++level)
+        {
+            if ((current_ & ((uint64_t(1) << (WHEEL_SLOT_BITS * level)) - 1)) != 0)
+                break;
+            auto &slot = slots_[level][(current_ >> (WHEEL_SLOT_BITS * level)) & (WHEEL_SLOTS - 1)];
+            auto entries = std::move(slot);
+            slot.clear();
+            for (const auto &entry : entries)
+                insert(entry);
+        }
+        auto &due = slots_[0][current_ & (WHEEL_SLOTS - 1)];
+        for (const auto &entry : due)
+            expired.push_back(entry.timer);
+        due.clear();
+    }
+}
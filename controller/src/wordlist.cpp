@@ -0,0 +1,91 @@
+#include "wordlist.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+namespace
+{
+    // None so small that leases mostly seek
+    constexpr uint64_t MIN_RANGE_BYTES = 4 * 1024;
+    constexpr uint64_t MAX_RANGE_BYTES = 64 * 1024 * 1024;
+    constexpr uint32_t RULES_PER_RANGE = 256;
+}
+
+int count_rules(const std::string &path, uint32_t &count)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        std::cerr << "Cannot open rules file " << path << "\n";
+        return -1;
+    }
+    count = 0;
+    std::string line;
+    while (std::getline(in, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty() && line[0] != '#')
+            ++count;
+    }
+    return 0;
+}
+
+std::vector<IndexRange> rule_chunks(uint32_t rule_count)
+{
+    std::vector<IndexRange> chunks;
+    for (uint32_t rule = 0; rule < rule_count; rule += RULES_PER_RANGE)
+        chunks.emplace_back(rule, std::min(rule + RULES_PER_RANGE, rule_count));
+    return chunks;
+}
+
+std::vector<IndexRange> split_lines(const std::string &path, uint64_t target, uint64_t &file_size)
+{
+    std::vector<IndexRange> ranges;
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cerr << "Cannot open wordlist " << path << ": " << std::strerror(errno) << "\n";
+        return ranges;
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size == 0)
+    {
+        std::cerr << "Wordlist " << path << " is empty or unreadable\n";
+        ::close(fd);
+        return ranges;
+    }
+    file_size = static_cast<uint64_t>(st.st_size);
+    void *map = mmap(nullptr, file_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        std::cerr << "Cannot map wordlist " << path << ": " << std::strerror(errno) << "\n";
+        return ranges;
+    }
+    const char *data = static_cast<const char *>(map);
+
+    const uint64_t range_bytes = std::clamp(file_size / target, MIN_RANGE_BYTES, MAX_RANGE_BYTES);
+    uint64_t begin = 0;
+    while (begin < file_size)
+    {
+        uint64_t split = std::min(begin + range_bytes, file_size);
+        if (split < file_size)
+        {
+            // Move the split just past the next newline
+            auto nl = static_cast<const char *>(std::memchr(data + split, '\n', file_size - split));
+            split = nl ? static_cast<uint64_t>(nl - data) + 1 : file_size;
+        }
+        ranges.emplace_back(begin, split);
+        begin = split;
+    }
+    munmap(map, file_size);
+    return ranges;
+}
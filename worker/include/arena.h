@@ -0,0 +1,53 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// Large anonymous mapping for memory-hard hashes. Backed by explicit huge
+// pages when the system has them reserved, otherwise by regular pages with a
+// transparent-huge-page hint. The whole region is faulted in up front so the
+// hashing loop never takes page faults, by the thread that maps it, so its
+// pages are on that thread's NUMA node.
+class MemoryArena {
+public:
+    explicit MemoryArena(size_t bytes);
+    ~MemoryArena();
+
+    MemoryArena(const MemoryArena &) = delete;
+    MemoryArena &operator=(const MemoryArena &) = delete;
+
+    void *data() const { return data_; }
+    size_t size() const { return size_; }
+    bool huge_pages() const { return huge_; }
+    int node() const { return node_; }
+
+private:
+    void *data_ = nullptr;
+    size_t size_ = 0;
+    bool huge_ = false;
+    int node_ = 0;
+};
+
+// Returns the arena to the process-wide pool instead of unmapping it
+struct ArenaRelease {
+    void operator()(MemoryArena *arena) const;
+};
+using PooledArena = std::unique_ptr<MemoryArena, ArenaRelease>;
+
+// Takes a pre-faulted arena of at least bytes from the pool (mapping one if
+// none fits), so hashing never maps fresh memory once the pool is warm.
+// One on the caller's NUMA node is preferred.
+PooledArena arena_acquire(size_t bytes);
+
+// Unmaps every pooled arena but those of bytes (rounded up to huge pages,
+// as arenas are), so one job's arenas don't stay pinned through the next;
+// returns the bytes still pooled, which MemAvailable no longer counts
+size_t arena_trim(size_t bytes);
+
+// MemAvailable from /proc/meminfo, 0 if unknown
+size_t available_memory_bytes();
+
+#endif // ARENA_H
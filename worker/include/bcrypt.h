@@ -0,0 +1,44 @@
+#ifndef BCRYPT_H
+#define BCRYPT_H
+
+#include <cstddef>
+#include <cstdint>
+
+// In-tree bcrypt ($2a$/$2b$/$2y$, Eksblowfish). Several candidates are hashed
+// in interleaved scalar lanes so the dependent S-box lookups of one lane
+// overlap with the others' instead of stalling the core.
+constexpr size_t BLOWFISH_P_WORDS = 18;
+constexpr size_t BCRYPT_SALT_BYTES = 16;
+constexpr size_t BCRYPT_HASH_BYTES = 23;
+constexpr size_t BCRYPT_SALT_CHARS = 22;
+constexpr size_t BCRYPT_HASH_CHARS = 31;
+constexpr size_t BCRYPT_MAX_KEY = 72;
+constexpr unsigned BCRYPT_MIN_COST = 4;
+constexpr unsigned BCRYPT_MAX_COST = 31;
+
+// Widest lane group (4 x 4 KB of state stays in L1). From BCRYPT_NARROW_COST
+// on a single candidate takes seconds, so the engine batches fewer lanes to
+// bound the work wasted when a batch straddles a find or the work_size limit.
+constexpr size_t BCRYPT_LANES = 4;
+constexpr size_t BCRYPT_NARROW_LANES = 2;
+constexpr unsigned BCRYPT_NARROW_COST = 14;
+
+extern const uint32_t BLOWFISH_P_INIT[BLOWFISH_P_WORDS];
+extern const uint32_t BLOWFISH_S_INIT[4][256];
+
+struct alignas(64) BlowfishState {
+    uint32_t P[BLOWFISH_P_WORDS];
+    uint32_t S[4][256];
+};
+
+// Decodes bcrypt's base64 variant; false on characters outside the alphabet
+bool bcrypt_decode_base64(const char *src, size_t src_len, uint8_t *dst, size_t dst_len);
+
+// Hashes count (1..BCRYPT_LANES) keys in one interleaved lane group. states
+// is the caller's arena of BCRYPT_LANES states, reused across calls.
+void bcrypt_hash_lanes(BlowfishState *states,
+                       const char *const *keys, const size_t *key_lens, size_t count,
+                       const uint8_t salt[BCRYPT_SALT_BYTES], unsigned cost,
+                       uint8_t out[][BCRYPT_HASH_BYTES]);
+
+#endif // BCRYPT_H
@@ -0,0 +1,20 @@
+#ifndef CALIBRATE_H
+#define CALIBRATE_H
+
+#include <vector>
+
+#include "hash_engine.h"
+
+constexpr int CALIBRATION_MS = 250;     // hashing time per thread count tried
+constexpr int MAX_AUTO_THREADS = 255;   // WORKREQ carries the count in one byte
+
+// --threads auto: the thread count, up to max_threads, with the highest
+// total rate on these target groups. A few counts along the placement order
+// of cpu_topology() are tried (half the cores, every core, half and all of
+// the SMT siblings), each with pinned threads hashing throwaway candidates
+// through the job's own engines, so a memory-bound algorithm settles lower
+// than a compute-bound one. Results are kept per algorithm and cap, so a
+// job with the same algorithm again is not measured twice.
+int calibrate_threads(const std::vector<TargetGroup> &groups, int max_threads);
+
+#endif // CALIBRATE_H
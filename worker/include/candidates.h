@@ -0,0 +1,137 @@
+#ifndef CANDIDATES_H
+#define CANDIDATES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "wordlist.h"
+#include "rules.h"
+#include "mask.h"
+#include "markov.h"
+
+// Attack modes, announced by the controller in CONACK
+enum class AttackMode : uint8_t {
+    BRUTE_FORCE = 0,    // CHAR_SET combinations from a prefix
+    WORDLIST,           // byte ranges of a shared wordlist
+    MASK,               // index ranges of a mask's keyspace
+    BY_LENGTH,          // index ranges of all CHAR_SET strings, shortest first
+};
+
+// What a WORDLIST attack pairs with every word (the lease's inner range)
+enum class InnerDimension : uint8_t {
+    NONE = 0,
+    RULES,              // each rule applied to the word
+    MASK_SUFFIX,        // word + each mask candidate (hybrid)
+    MASK_PREFIX,        // each mask candidate + word (hybrid)
+    SECOND_LIST,        // word + each word of a second list (combinator)
+};
+
+// Node-wide inputs the attack reads from; loaded once at CONACK
+struct AttackInputs {
+    const Wordlist *wordlist = nullptr;
+    InnerDimension inner = InnerDimension::NONE;
+    const RuleSet *rules = nullptr;
+    const Mask *mask = nullptr;         // MASK mode, or a hybrid's mask
+    const Wordlist *second = nullptr;   // combinator's second list
+    uint32_t min_length = 0;            // BY_LENGTH: length at index 0
+    uint64_t keyspace = 0;              // BY_LENGTH: strings up to the max length
+};
+
+// This node's copies of the files the controller's attack names
+struct AttackFiles {
+    std::string wordlist;
+    std::string rules;
+    std::string markov;     // training corpus for Markov-ordered masks
+    std::string combine;    // combinator's second list
+};
+
+// The job's attack, set up from the CONACK payload: empty for brute force,
+// otherwise a line of options, followed by the mask and its four custom
+// charsets (one per line) if the attack has a mask. Options:
+//   wordlist <size hex>     words of the node's --wordlist, paired with
+//     rules <n>             each of n rules of --rules, or
+//     combine <size hex>    each word of --combine, or
+//     mask | mask-first     each candidate of the mask, after/before the word
+//   mask                    (without wordlist) the mask alone
+//   markov <size hex>       the mask in Markov order learned from --markov
+//   lengths <min> <max>     brute force, every length finished before the next
+// Sizes must match this node's copies. Files stay open across jobs.
+class Attack {
+public:
+    // Throws std::runtime_error if this node lacks an input the attack needs
+    // or its copy doesn't match the controller's
+    void configure(const std::string &payload, const AttackFiles &files);
+
+    AttackMode mode() const { return mode_; }
+    const AttackInputs &inputs() const { return inputs_; }
+
+private:
+    AttackMode mode_ = AttackMode::BRUTE_FORCE;
+    AttackInputs inputs_;
+    std::unique_ptr<Wordlist> wordlist_;
+    std::unique_ptr<RuleSet> rules_;
+    std::unique_ptr<Wordlist> second_;
+    std::unique_ptr<Mask> mask_;
+    std::unique_ptr<MarkovModel> markov_;
+    uint64_t markov_corpus_size_ = 0;   // bytes of the corpus markov_ was trained on
+};
+
+// Candidates of one lease token for one hashing thread. Every source fills
+// the caller's batch in place (strings keep their capacity between batches,
+// so steady state allocates nothing) and can report where to resume.
+class CandidateSource {
+public:
+    // token is one entry of the WORK payload
+    CandidateSource(AttackMode mode, const std::string &token, const AttackInputs &inputs);
+
+    // Up to max candidates into batch; 0 once the lease has nothing left
+    size_t fill(std::string *batch, size_t max);
+    // Token that resumes right after the last candidate handed out
+    std::string position() const;
+
+private:
+    struct BruteForce {
+        std::string next;
+    };
+    struct WordlistRange {
+        const Wordlist *list;
+        RangeToken range;
+    };
+    // Every item of the lease's inner range (a rule, a mask candidate, a
+    // word of the second list) paired with each word in turn. range.cursor
+    // stays on the current word until its inner range is done.
+    struct CrossRange {
+        AttackInputs inputs;
+        RangeToken range;
+        std::string word;
+        uint64_t next_word = 0;     // offset after word
+        bool have_word = false;
+        std::string inner;          // current mask candidate or second-list word
+        std::vector<uint8_t> digits;
+    };
+
+    // A mixed-radix counter over the mask's positions: each step bumps the
+    // last digit and carries left, rewriting only the characters that change.
+    // A strided lane decodes every index it visits instead.
+    struct MaskRange {
+        const Mask *mask;
+        RangeToken range;
+        std::string current;
+        std::vector<uint8_t> digits;
+    };
+
+    // Shortest first: overflowing the current length moves to the next
+    struct LengthRange {
+        RangeToken range;
+        size_t min_length;
+        std::string current;
+    };
+
+    std::variant<BruteForce, WordlistRange, CrossRange, MaskRange, LengthRange> source_;
+};
+
+#endif // CANDIDATES_H
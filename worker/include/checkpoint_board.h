@@ -0,0 +1,63 @@
+#ifndef CHECKPOINT_BOARD_H
+#define CHECKPOINT_BOARD_H
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "network.h"
+
+// Workers on the controller's machine (--server unix:path) checkpoint into
+// shared memory instead of sending CHECKs. The worker creates a board named
+// after its pid before it connects; the controller maps it when it accepts
+// the connection (a Unix socket tells it the peer's pid), unlinks the name
+// and marks it attached, so by CONACK the worker knows which way to report.
+// Lease i of a WORK owns slot i and rewrites it under a sequence lock; the
+// scheduler polls the slots and handles every new entry as the CHECK it
+// replaces. WORK, WORKFIN and the rest still go over the socket.
+constexpr size_t BOARD_SLOTS = 256;     // a WORK has at most 255 leases
+constexpr int BOARD_POLL_MS = 100;      // how often the scheduler reads the boards
+
+class CheckpointBoard
+{
+public:
+    // Worker: a fresh board for process pid; nullptr (after printing why) if it can't be made
+    static std::unique_ptr<CheckpointBoard> create(pid_t pid);
+    // Controller: the board worker process pid made, nullptr if none
+    static std::unique_ptr<CheckpointBoard> attach(pid_t pid);
+    ~CheckpointBoard();
+
+    CheckpointBoard(const CheckpointBoard &) = delete;
+    CheckpointBoard &operator=(const CheckpointBoard &) = delete;
+
+    bool attached() const { return layout_->attached.load(std::memory_order_acquire) != 0; }
+    // Worker: lease slot's latest checkpoint
+    void write(size_t slot, uint32_t work_done, const std::string &token);
+    // Controller: slot's checkpoint if it changed since seq, which is updated
+    bool read(size_t slot, uint32_t &seq, uint32_t &work_done, std::string &token) const;
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32_t> seq;      // odd while the worker writes
+        std::atomic<uint32_t> work_done;
+        std::atomic<uint8_t> len;
+        char token[MAX_PAYLOAD];
+    };
+    struct Layout
+    {
+        std::atomic<uint32_t> attached;
+        Slot slots[BOARD_SLOTS];
+    };
+
+    CheckpointBoard(Layout *layout, std::string name) : layout_(layout), name_(std::move(name)) {}
+    static std::string board_name(pid_t pid);
+
+    Layout *layout_;
+    std::string name_;      // still to unlink; empty once the controller has
+};
+
+#endif // CHECKPOINT_BOARD_H
@@ -0,0 +1,27 @@
+#ifndef CPU_TOPOLOGY_H
+#define CPU_TOPOLOGY_H
+
+#include <cstddef>
+#include <vector>
+
+// Where --threads auto puts its hashing threads. Read once from sysfs and
+// limited to the CPUs this process may run on (taskset, cgroup cpusets).
+// Thread i goes on order[i]: first one hardware thread of every physical
+// core, taking the nodes in turn so both sockets' caches and memory
+// controllers are in use from two threads up, then the SMT siblings in the
+// same order. Without sysfs every allowed CPU counts as its own core on
+// node 0.
+struct CpuTopology {
+    std::vector<int> order;     // logical CPU ids in placement order
+    size_t cores = 0;           // physical cores among them; order[0, cores) are on distinct ones
+    size_t nodes = 1;           // NUMA nodes among them
+};
+
+const CpuTopology &cpu_topology();
+
+// Binds the calling thread to one CPU; false if the kernel refuses
+bool pin_current_thread(int cpu);
+// NUMA node of the CPU the calling thread is running on, 0 if unknown
+int current_numa_node();
+
+#endif // CPU_TOPOLOGY_H
@@ -0,0 +1,51 @@
+#ifndef DIGEST_SET_H
+#define DIGEST_SET_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+// Read-only set of fixed-size binary digests (unsalted targets), built once
+// per node and shared by every hashing thread.
+//
+// A split-block Bloom filter sits in front of a sorted table of the digests.
+// A lookup touches one 32-byte filter block (half a cache line), and ~99.9%
+// of candidates stop there. Only filter hits binary-search the table. Cost
+// stays flat from one target to tens of millions. The digests are already
+// uniformly distributed, so their own bytes serve as the filter hashes.
+class DigestSet {
+public:
+    // digests holds count records of digest_bytes (>= 16) each; record i is target i
+    DigestSet(size_t digest_bytes, std::vector<uint8_t> digests);
+
+    size_t size() const { return targets_.size(); }
+    size_t digest_bytes() const { return digest_bytes_; }
+
+    // Pulls the filter block for digest towards L1 ahead of contains()
+    void prefetch(const uint8_t *digest) const { __builtin_prefetch(&blocks_[block_of(digest)]); }
+    // False means the digest is definitely not a target
+    bool maybe_contains(const uint8_t *digest) const;
+    // Table positions [first, second) holding digest; empty if absent
+    std::pair<size_t, size_t> find(const uint8_t *digest) const;
+    uint32_t target(size_t pos) const { return targets_[pos]; }
+
+private:
+    static constexpr size_t BLOCK_WORDS = 8;
+    static constexpr size_t BITS_PER_DIGEST = 16;   // ~0.1% false positives
+
+    struct Block {
+        uint32_t words[BLOCK_WORDS];
+    };
+
+    size_t block_of(const uint8_t *digest) const;
+    static void block_mask(const uint8_t *digest, uint32_t *mask);
+
+    size_t digest_bytes_;
+    std::vector<Block> blocks_;
+    std::vector<uint8_t> digests_;       // sorted records
+    std::vector<uint32_t> targets_;      // target index of each record
+};
+
+#endif // DIGEST_SET_H
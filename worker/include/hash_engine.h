@@ -0,0 +1,231 @@
+#ifndef HASH_ENGINE_H
+#define HASH_ENGINE_H
+
+#include <crypt.h>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <variant>
+#include <vector>
+
+#include "worker.h"
+#include "bcrypt.h"
+#include "yescrypt.h"
+#include "arena.h"
+#include "multibuffer.h"
+#include "md5crypt.h"
+#include "digest_set.h"
+
+// Algorithm families that get their own engine. The family is resolved once
+// per target when the job's targets arrive, so nothing is re-parsed or
+// re-branched on per candidate.
+enum class HashFamily : uint8_t {
+    CRYPT = 0,      // anything libcrypt's crypt_r understands
+    BCRYPT,         // $2a$ / $2b$ / $2y$, in-tree multi-lane Eksblowfish
+    YESCRYPT,       // $y$ and classic scrypt $7$, in-tree with a reusable arena
+    MD5CRYPT,       // $1$, multi-buffer MD5
+    RAW,            // unsalted MD5 / SHA-1 / SHA-256 / NTLM, multi-buffer
+};
+
+// One hash of the job; id is the controller's index, echoed back in PWDFND.
+// Raw targets keep only their binary digest (in the group's DigestSet), so
+// hash is empty for them.
+struct Target {
+    std::string hash;
+    uint32_t id;
+};
+
+// Targets sharing family, algorithm, options and salt: a candidate is hashed
+// once per group and the result checked against every digest in it
+struct TargetGroup {
+    HashFamily family;
+    hash_info info;                             // parsed first target
+    std::vector<Target> targets;
+    std::shared_ptr<const DigestSet> digests;   // RAW only, built once per node
+};
+
+std::vector<TargetGroup> group_targets(std::vector<std::string> hashes, const std::vector<uint32_t> &ids);
+
+// Which targets are cracked, shared by all hashing threads. A group whose
+// targets are all cracked is skipped entirely.
+class CrackState {
+public:
+    explicit CrackState(const std::vector<TargetGroup> &groups);
+
+    // True for exactly one caller per target
+    bool claim(size_t group, size_t target);
+    bool group_done(size_t group) const { return group_left_[group].load(std::memory_order_relaxed) == 0; }
+    size_t remaining() const { return left_.load(std::memory_order_relaxed); }
+
+private:
+    std::vector<size_t> first_;                         // flat index of each group's first target
+    std::unique_ptr<std::atomic<bool>[]> cracked_;
+    std::unique_ptr<std::atomic<size_t>[]> group_left_;
+    std::atomic<size_t> left_;
+};
+
+// A candidate that matched target `target` of the engine's group
+struct EngineHit {
+    size_t candidate;
+    size_t target;
+};
+
+// Every engine is built from one TargetGroup and hashes candidates in
+// batches of up to LANES:
+//   size_t batch_size() const;  how many candidates it wants per call
+//   void find_matches(const std::string *candidates, size_t count,
+//                     std::vector<EngineHit> &hits);
+//                               appends every (candidate, target) match
+
+template <HashFamily Family>
+class HashEngine;
+
+// Generic crypt_r engine. The setting string is built once and the (32 KB)
+// crypt_data scratch area is allocated and zeroed once per thread.
+template <>
+class HashEngine<HashFamily::CRYPT> {
+public:
+    static constexpr size_t LANES = 1;
+
+    explicit HashEngine(const TargetGroup &group);
+
+    size_t batch_size() const { return LANES; }
+    void find_matches(const std::string *candidates, size_t count, std::vector<EngineHit> &hits);
+
+private:
+    std::string setting_;
+    std::vector<std::string> targets_;
+    std::unique_ptr<crypt_data> data_;
+};
+
+// Native bcrypt. Salt, cost and target digests are decoded once; the expanded
+// Blowfish states of all lanes live in a per-thread arena reused every batch.
+template <>
+class HashEngine<HashFamily::BCRYPT> {
+public:
+    static constexpr size_t LANES = BCRYPT_LANES;
+
+    explicit HashEngine(const TargetGroup &group);
+
+    size_t batch_size() const { return batch_; }
+    void find_matches(const std::string *candidates, size_t count, std::vector<EngineHit> &hits);
+
+private:
+    unsigned cost_ = 0;
+    size_t batch_ = LANES;
+    uint8_t salt_[BCRYPT_SALT_BYTES] = {0};
+    std::vector<std::array<uint8_t, BCRYPT_HASH_BYTES>> targets_;
+    std::unique_ptr<BlowfishState[]> arena_;
+};
+
+// yescrypt / scrypt. Cost parameters and salt are parsed once; the V/XY/S
+// working region is a pre-faulted (huge page backed where possible) arena
+// borrowed from the process-wide pool for each call, so a thread holds one
+// arena at a time however many salts the job has.
+template <>
+class HashEngine<HashFamily::YESCRYPT> {
+public:
+    static constexpr size_t LANES = 1;
+
+    explicit HashEngine(const TargetGroup &group);
+
+    size_t batch_size() const { return LANES; }
+    void find_matches(const std::string *candidates, size_t count, std::vector<EngineHit> &hits);
+
+private:
+    YescryptParams params_;
+    std::vector<uint8_t> salt_;
+    std::vector<std::array<uint8_t, YESCRYPT_HASH_BYTES>> targets_;
+};
+
+template <>
+class HashEngine<HashFamily::MD5CRYPT> {
+public:
+    static constexpr size_t LANES = MB_LANES;
+
+    explicit HashEngine(const TargetGroup &group);
+
+    size_t batch_size() const { return LANES; }
+    void find_matches(const std::string *candidates, size_t count, std::vector<EngineHit> &hits);
+
+private:
+    std::string salt_;
+    std::vector<std::array<char, MD5CRYPT_HASH_CHARS>> targets_;
+};
+
+enum class RawDigest : uint8_t {
+    MD5,
+    SHA1,
+    SHA256,
+    NTLM,           // MD4 of the UTF-16LE password
+};
+
+// Raw digests cost tens of nanoseconds, so the whole batch is hashed in one
+// multi-buffer call and each digest looked up in the group's shared
+// DigestSet (prefetched for the whole batch first).
+template <>
+class HashEngine<HashFamily::RAW> {
+public:
+    static constexpr size_t LANES = MB_LANES;
+
+    explicit HashEngine(const TargetGroup &group);
+
+    size_t batch_size() const { return LANES; }
+    void find_matches(const std::string *candidates, size_t count, std::vector<EngineHit> &hits);
+
+private:
+    RawDigest digest_ = RawDigest::MD5;
+    size_t digest_bytes_ = 0;
+    std::shared_ptr<const DigestSet> targets_;
+    std::string wide_[LANES];                   // NTLM's UTF-16LE candidates
+};
+
+constexpr size_t MAX_ENGINE_LANES = std::max({HashEngine<HashFamily::CRYPT>::LANES,
+                                              HashEngine<HashFamily::BCRYPT>::LANES,
+                                              HashEngine<HashFamily::YESCRYPT>::LANES,
+                                              HashEngine<HashFamily::MD5CRYPT>::LANES,
+                                              HashEngine<HashFamily::RAW>::LANES});
+
+// A candidate that matched target `target` of group `group`
+struct GroupHit {
+    size_t candidate;
+    size_t group;
+    size_t target;
+};
+
+// One engine per target group, owned by a single hashing thread. Engines are
+// held by value in a variant, so each call is a switch on the family and the
+// engine's own code is fully specialized.
+class EngineSet {
+public:
+    explicit EngineSet(const std::vector<TargetGroup> &groups);
+
+    // Candidates the hashing loop should gather per call (<= MAX_ENGINE_LANES)
+    size_t batch_size() const { return batch_; }
+    // Runs the batch through every group that still has uncracked targets
+    void find_matches(const std::string *candidates, size_t count, const CrackState &state,
+                      std::vector<GroupHit> &hits);
+
+private:
+    using AnyEngine = std::variant<HashEngine<HashFamily::CRYPT>,
+                                   HashEngine<HashFamily::BCRYPT>,
+                                   HashEngine<HashFamily::YESCRYPT>,
+                                   HashEngine<HashFamily::MD5CRYPT>,
+                                   HashEngine<HashFamily::RAW>>;
+
+    std::vector<AnyEngine> engines_;
+    std::vector<EngineHit> scratch_;
+    size_t batch_ = 1;
+};
+
+HashFamily resolve_hash_family(const hash_info &info);
+const char *hash_family_name(HashFamily family);
+
+// Working memory one hashing thread needs for these groups, 0 if negligible
+size_t hash_memory_per_thread(const std::vector<TargetGroup> &groups);
+
+#endif // HASH_ENGINE_H
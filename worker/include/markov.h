@@ -0,0 +1,29 @@
+#ifndef MARKOV_H
+#define MARKOV_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "wordlist.h"
+
+// Character statistics of a training corpus (one password per line): how
+// often each byte appears at each position, and how often each byte
+// follows another. Every node trains on its own copy of the same corpus,
+// so all of them derive the same candidate order.
+class MarkovModel {
+public:
+    explicit MarkovModel(const Wordlist &corpus);
+
+    uint64_t position_count(size_t pos, unsigned char c) const;
+    uint64_t follow_count(unsigned char prev, unsigned char c) const;
+    uint64_t words() const { return words_; }
+
+private:
+    std::vector<std::array<uint64_t, 256>> position_;   // MAX_MASK_LEN positions
+    std::vector<std::array<uint64_t, 256>> follow_;     // by previous byte
+    uint64_t words_ = 0;
+};
+
+#endif // MARKOV_H
@@ -0,0 +1,71 @@
+#ifndef MASK_H
+#define MASK_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr size_t MASK_CUSTOM_CHARSETS = 4;
+constexpr size_t MAX_MASK_LEN = 64;
+
+// hashcat-style mask: one charset per position.
+//   ?l ?u ?d ?s  lower, upper, digit, special    ?a  all of those
+//   ?h ?H        lower / upper hex digits        ?1 - ?4  custom charsets
+//   ??           a literal '?'                   anything else is literal
+// Custom charsets are written the same way (built-ins and literals).
+// A candidate is a digit per position; digit d picks the d-th character of
+// the position's charset. Candidate i is i in mixed radix, last position
+// least significant, until reorder() switches to Markov order.
+class MarkovModel;
+
+class Mask {
+public:
+    // Throws std::invalid_argument for bad syntax, an undefined ?1-?4, or a
+    // keyspace over 2^64
+    Mask(const std::string &mask, const std::array<std::string, MASK_CUSTOM_CHARSETS> &custom);
+
+    size_t length() const { return positions_.size(); }
+    uint64_t keyspace() const { return keyspace_; }
+
+    // Switches to Markov order. Each position's charset is sorted most likely
+    // first: the first position by how often each character starts a word,
+    // the rest by how often each follows the previous character (ties by
+    // position frequency, then mask order). A digit is then a rank, and
+    // candidates go by level, the sum of their ranks, so ones that are
+    // likely everywhere come before ones with a single unlikely character.
+    // Within a level the order is lexicographic by digits. Every index still
+    // names exactly one candidate, so leases and resume work unchanged.
+    void reorder(const MarkovModel &model);
+
+    // Candidate number index, and its per-position digits
+    void decode(uint64_t index, std::string &candidate, std::vector<uint8_t> &digits) const;
+    // Steps candidate/digits to the next index (wrapping after the last),
+    // rewriting only the positions from the first one that changes
+    void next(std::string &candidate, std::vector<uint8_t> &digits) const;
+
+private:
+    // Lexicographically smallest digits from pos on that sum to level
+    void fill_level(size_t pos, uint32_t level, std::vector<uint8_t> &digits) const;
+    void spell(size_t pos, std::string &candidate, const std::vector<uint8_t> &digits) const;
+
+    const std::string &charset(size_t pos, char prev) const
+    {
+        return pos > 0 && !after_.empty() ? after_[pos][static_cast<unsigned char>(prev)] : positions_[pos];
+    }
+
+    std::vector<std::string> positions_;
+    // After reorder(): after_[pos][prev] is position pos's charset ordered
+    // for the previous character prev
+    std::vector<std::array<std::string, 256>> after_;
+    // Also after reorder(): ways_[pos][level] counts digit suffixes from pos
+    // on summing to level, level_start_[level] is the index of the level's
+    // first candidate, and max_level_[pos] is the largest suffix sum
+    std::vector<std::vector<uint64_t>> ways_;
+    std::vector<uint64_t> level_start_;
+    std::vector<uint32_t> max_level_;
+    uint64_t keyspace_ = 1;
+};
+
+#endif // MASK_H
@@ -0,0 +1,19 @@
+#ifndef MD5CRYPT_H
+#define MD5CRYPT_H
+
+#include <cstddef>
+#include <string>
+
+#include "multibuffer.h"
+
+// FreeBSD-style md5crypt ($1$) on top of the multi-buffer MD5: all 1000
+// rounds of up to MB_LANES candidates advance together.
+constexpr size_t MD5CRYPT_MAX_SALT = 8;
+constexpr size_t MD5CRYPT_HASH_CHARS = 22;
+
+// Hashes count (1..MB_LANES) passwords under one salt; out[i] receives the
+// 22-character encoded digest (no terminator)
+void md5crypt_lanes(const std::string *passwords, size_t count, const std::string &salt,
+                    char out[][MD5CRYPT_HASH_CHARS]);
+
+#endif // MD5CRYPT_H
@@ -0,0 +1,27 @@
+#ifndef MULTIBUFFER_H
+#define MULTIBUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "sha256.h"
+
+// Multi-buffer MD4 / MD5 / SHA-1 / SHA-256: MB_LANES independent messages are
+// hashed together with their words laid out lane-minor, so every step of the
+// compression function is one loop over lanes that the compiler turns into
+// SIMD instructions (SSE2 on plain x86-64, wider with -march).
+constexpr size_t MB_LANES = 8;
+
+constexpr size_t MD4_DIGEST_BYTES = 16;
+constexpr size_t MD5_DIGEST_BYTES = 16;
+constexpr size_t SHA1_DIGEST_BYTES = 20;
+
+// Hashes count (1..MB_LANES) messages; digest i is written to
+// out + i * <ALGO>_DIGEST_BYTES. Lanes whose padded lengths span a different
+// number of 64-byte blocks are hashed in separate passes.
+void md4_lanes(const uint8_t *const *msgs, const size_t *lens, size_t count, uint8_t *out);
+void md5_lanes(const uint8_t *const *msgs, const size_t *lens, size_t count, uint8_t *out);
+void sha1_lanes(const uint8_t *const *msgs, const size_t *lens, size_t count, uint8_t *out);
+void sha256_lanes(const uint8_t *const *msgs, const size_t *lens, size_t count, uint8_t *out);
+
+#endif // MULTIBUFFER_H
@@ -16,6 +16,8 @@
 #include "parse_args.h"
 
 constexpr int DEFAULT_RETRIES = 3;
+constexpr int LEASE_POLL_MS = 100;     // how often the network thread checks for CANCEL/KILL mid-WORK
+constexpr int STRIDE_REPORT_SEC = 10;  // between progress reports on strided lanes
 constexpr size_t HEADER_SIZE = 6;
 
 enum Header_Flags : uint8_t {
@@ -27,7 +29,13 @@ enum Header_Flags : uint8_t {
     WORKREQ,
     WORKFIN,
     CHECK,
-    PWDFND
+    PWDFND,
+    TARGETS,
+    CANCEL,
+    HEARTBEAT,
+    STRIDE,
+    DRAIN,
+    WORKMORE
 };
 
 struct Header {
@@ -42,19 +50,88 @@ struct Packet {
     std::vector<uint8_t> payload;
 };
 
+// Multi-target jobs: on connect the controller streams the uncracked targets
+// as TARGETS packets (newline-separated hashes; the 32-bit id of the first is
+// split across work_size (high) and checkpoint_interval (low), the rest
+// follow consecutively), then sends CONACK to mark the end of the list.
+// A job queue (--jobs) may send another list and CONACK between leases to
+// move the worker to another job; its CONACKs have work_size 1, so the
+// worker asks for more work once its targets are all cracked instead of
+// leaving.
+// PWDFND carries the cracked target's id in the same two fields, and CHECK
+// the work its lease has done so far (which a relay's leases run past 16 bits).
+// CANCEL names a range lease (its token) whose other copy finished first;
+// the worker stops hashing it and reports where it got to with WORKFIN.
+// HEARTBEAT carries the controller's send time (steady clock, microseconds,
+// hex); the worker's network thread echoes it straight back, which proves
+// the worker alive however slow its hashing and measures the round trip.
+// STRIDE (--strided) replaces WORK and CHECK. From the controller it lists
+// the worker's lanes ("cursor:end*stride" tokens) for generation work_size,
+// checkpoint_interval counting the packets still to follow; an empty one
+// asks the worker to stop and report. From the worker it lists where each
+// lane got to, work_size again the generation, checkpoint_interval 1 once
+// the lanes are stopped or done (0 for a progress report).
+// DRAIN is a worker leaving on SIGTERM. It sends one DRAIN per lease still
+// running: the work that lease did, in the same two fields as CHECK, and
+// where it stopped. The next candidate is the token's, so the range is
+// re-leased from there. Strided lanes are reported with a final STRIDE
+// instead. An empty DRAIN comes last, and then the worker disconnects.
+// WORKMORE carries the leading tokens of a WORK that does not fit one
+// payload; the WORK that follows carries the rest, and the lease is all of
+// them, so a worker gets a token for each of its threads.
+constexpr size_t MAX_PAYLOAD = 255;
+
+inline uint32_t header_target_id(const Header &header)
+{
+    return (static_cast<uint32_t>(header.work_size) << 16) | header.checkpoint_interval;
+}
+
+inline void set_header_target_id(Header &header, uint32_t id)
+{
+    header.work_size = static_cast<uint16_t>(id >> 16);
+    header.checkpoint_interval = static_cast<uint16_t>(id & 0xffff);
+}
+
 int connect_to_server(const Args &args);
+std::string local_endpoint(int fd);
 
 ssize_t send_all(int fd, const uint8_t* data, size_t len);
+// 0 if the peer closed. A signal before the first byte fails them with
+// errno EINTR, so a blocking wait can notice it; one after that is retried.
 ssize_t recv_all(int fd, uint8_t* buffer, size_t len);
 ssize_t recv_full_packet(int fd, std::vector<uint8_t> &buffer);
 
 ssize_t serialize(const Packet &packet, std::vector<uint8_t> &buffer);
 int deserialize(const uint8_t *buf, size_t len, Packet &result);
 
+// eventfd a hashing thread wakes the network thread's poll() with, so the
+// end of a lease is noticed at once instead of at the next LEASE_POLL_MS
+class Wakeup
+{
+public:
+    Wakeup();
+    ~Wakeup();
+    Wakeup(const Wakeup &) = delete;
+    Wakeup &operator=(const Wakeup &) = delete;
+
+    int fd() const { return fd_; }
+    void notify();
+    void drain();
+
+private:
+    int fd_;
+};
+
 ssize_t threadsafe_send_all(int fd, const uint8_t *data, size_t len);
 int send_workreq(int server_fd, int retries, int num_threads);
 int send_workfin(int server_fd, int retries, std::string &last_prefix);
-int send_check(int server_fd, int retries, uint16_t work_done, uint16_t work_size, std::string &last_prefix);
-int send_pwdfind(int server_fd, int retries, const std::string &found_password);
+int send_check(int server_fd, int retries, uint32_t work_done, std::string &last_prefix);
+int send_heartbeat(int server_fd, int retries, const std::vector<uint8_t> &echo);
+int send_pwdfind(int server_fd, int retries, uint32_t target_id, const std::string &found_password);
+// Where each strided lane got to, in as many packets as it takes; stopped
+// marks the last one as the final word on these lanes
+int send_stride(int server_fd, int retries, uint16_t generation, bool stopped, const std::vector<std::string> &positions);
+// One lease's last position and work on SIGTERM; an empty position ends the drain
+int send_drain(int server_fd, int retries, uint32_t work_done, const std::string &position);
 
 #endif // NETWORK_H
@@ -8,9 +8,16 @@
 #include <sstream>
 
 struct Args {
-    int server_port;
-    int threads;
+    int server_port = 0;
+    int threads = 0;
+    bool auto_threads = false;  // --threads auto: pinned, count calibrated per algorithm
     std::string serverIP;
+    std::string server_path;    // --server unix:path, a controller on this machine
+    std::string trace_path;     // empty = tracing disabled
+    std::string wordlist;       // local copy of the controller's wordlist
+    std::string rules;          // local copy of the controller's rules file
+    std::string markov;         // local copy of the controller's Markov corpus
+    std::string combine;        // local copy of the controller's combinator list
 };
 
 void print_args(const Args &args);
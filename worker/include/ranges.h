@@ -0,0 +1,27 @@
+#ifndef RANGES_H
+#define RANGES_H
+
+#include <cstdint>
+#include <string>
+
+// Range leases (wordlist byte offsets, mask keyspace indices) travel as
+// "cursor:end" in hex. Wordlist attacks with a second dimension (rules, a
+// hybrid mask's indices, byte offsets of a combinator's second list) add
+// "/inner:first:last": the lease covers that dimension's [first, last) for
+// every word, and inner is where the word at cursor resumes in it.
+// Strided lanes of an index space add "*stride": every stride-th index from
+// cursor up to end (cursor stays on the progression, so it passes end when
+// the lane is done).
+struct RangeToken {
+    uint64_t cursor = 0;
+    uint64_t end = 0;
+    uint64_t inner = 0;
+    uint64_t inner_begin = 0;
+    uint64_t inner_end = 0;     // 0 = no second dimension
+    uint64_t stride = 1;
+};
+
+std::string format_range(const RangeToken &range);
+bool parse_range(const std::string &token, RangeToken &range);
+
+#endif // RANGES_H
@@ -0,0 +1,43 @@
+#ifndef RULES_H
+#define RULES_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Word-mangling rules, a subset of hashcat's rule language:
+//   :  no-op           l  lowercase        u  uppercase
+//   c  capitalize      C  invert capitalize t  toggle case
+//   TN toggle at N     r  reverse          d  duplicate
+//   $X append X        ^X prepend X        [  delete first
+//   ]  delete last     DN delete at N      'N truncate at N
+//   sXY replace X with Y (leetspeak)       @X purge X
+// Positions N are 0-9 then A-Z (10-35). Functions run left to right;
+// spaces between them are ignored.
+constexpr size_t MAX_RULE_WORD_LEN = 256;
+
+// Rules compile once into a flat bytecode: an opcode byte followed by its
+// (at most two) operand bytes, so applying one is a tight switch loop.
+class RuleSet {
+public:
+    // One rule per line; blank lines and lines starting with '#' are not
+    // rules. Rules that don't compile stay in place (so rule numbers match
+    // the controller's) but produce no candidates. Throws if the file can't be read.
+    explicit RuleSet(const std::string &path);
+
+    size_t size() const { return offsets_.size() - 1; }
+    size_t invalid() const { return invalid_; }
+
+    // Writes rule i applied to word into out, reusing out's capacity; false
+    // if the rule rejects the word (or is invalid). A rule that deletes every
+    // character yields the empty candidate, which is hashed like any other.
+    bool apply(size_t i, const std::string &word, std::string &out) const;
+
+private:
+    std::vector<uint8_t> code_;     // every rule's bytecode, back to back
+    std::vector<size_t> offsets_;   // rule i is code_[offsets_[i], offsets_[i + 1])
+    size_t invalid_ = 0;
+};
+
+#endif // RULES_H
@@ -0,0 +1,33 @@
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <cstddef>
+#include <cstdint>
+
+constexpr size_t SHA256_DIGEST_BYTES = 32;
+constexpr size_t SHA256_BLOCK_BYTES = 64;
+
+extern const uint32_t SHA256_K[64];
+extern const uint32_t SHA256_H0[8];
+
+struct Sha256Ctx {
+    uint32_t state[8];
+    uint64_t length;                    // bytes hashed so far
+    uint8_t block[SHA256_BLOCK_BYTES];
+    size_t used;                        // bytes pending in block
+};
+
+void sha256_init(Sha256Ctx &ctx);
+void sha256_update(Sha256Ctx &ctx, const void *data, size_t len);
+void sha256_final(Sha256Ctx &ctx, uint8_t out[SHA256_DIGEST_BYTES]);
+void sha256(const void *data, size_t len, uint8_t out[SHA256_DIGEST_BYTES]);
+
+// Compression function on one 64-byte block (big-endian message words)
+void sha256_compress(uint32_t state[8], const uint8_t block[SHA256_BLOCK_BYTES]);
+
+void hmac_sha256(const void *key, size_t key_len, const void *msg, size_t msg_len,
+                 uint8_t out[SHA256_DIGEST_BYTES]);
+void pbkdf2_sha256(const void *passwd, size_t passwd_len, const void *salt, size_t salt_len,
+                   uint64_t iterations, uint8_t *out, size_t out_len);
+
+#endif // SHA256_H
@@ -0,0 +1,40 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <string>
+
+// Optional span tracing in the Chrome trace event format (JSON array form),
+// loadable in chrome://tracing or ui.perfetto.dev.
+//
+// Every connection is traced under pid = trace_conn_id("ip:port") of the
+// worker's socket, which both the controller and the worker compute the same
+// way, so the per-process files can be merged into one timeline:
+//
+//     jq -s add controller.json worker-*.json > run.json
+//
+// Lanes (tid) inside a connection are fixed so merged files do not collide.
+constexpr uint32_t TRACE_PID_CONTROLLER = 0;    // job-wide controller events
+constexpr uint32_t TRACE_TID_CONTROLLER = 0;    // controller side of a connection
+constexpr uint32_t TRACE_TID_WORKER_NET = 1;    // worker network thread
+constexpr uint32_t TRACE_TID_WORKER_HASH = 2;   // first worker hashing thread
+
+bool trace_open(const std::string &path);
+void trace_close();
+bool trace_enabled();
+
+uint64_t trace_now_us();
+uint32_t trace_conn_id(const std::string &endpoint);
+
+void trace_name_process(uint32_t pid, const std::string &name);
+void trace_name_thread(uint32_t pid, uint32_t tid, const std::string &name);
+void trace_instant(const std::string &name, uint32_t pid, uint32_t tid,
+                   const std::string &detail = "");
+void trace_span(const std::string &name, uint32_t pid, uint32_t tid,
+                uint64_t start_us, uint64_t end_us,
+                const std::string &detail = "");
+
+#endif // TRACE_H
@@ -0,0 +1,37 @@
+#ifndef WORDLIST_H
+#define WORDLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "ranges.h"
+
+// Read-only mapping of the node's copy of a wordlist. Nothing is read up
+// front, so a list of any size opens instantly; pages come in as leases
+// touch them.
+class Wordlist {
+public:
+    explicit Wordlist(const std::string &path);
+    ~Wordlist();
+
+    Wordlist(const Wordlist &) = delete;
+    Wordlist &operator=(const Wordlist &) = delete;
+
+    const char *data() const { return data_; }
+    uint64_t size() const { return size_; }
+
+    // Starts readahead of [begin, end) so the first words of a lease don't stall
+    void will_need(uint64_t begin, uint64_t end) const;
+
+private:
+    const char *data_ = nullptr;
+    uint64_t size_ = 0;
+};
+
+// Copies the next non-blank line in [offset, end) into word, reusing its
+// capacity, and moves offset past it. Trailing CRs are dropped. Returns
+// false once the range is used up.
+bool next_word(const Wordlist &list, uint64_t &offset, uint64_t end, std::string &word);
+
+#endif // WORDLIST_H
@@ -12,17 +12,11 @@
 #include <iostream>
 #include <mutex>
 
+#include "password.h"
+
 constexpr int MIN_HASH_TOKENS = 3;
 constexpr int MAX_HASH_TOKENS = 4;
 
-// character set for generating password candidates
-const char CHAR_SET[] =
-    "abcdefghijklmnopqrstuvwxyz"
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-    "0123456789"
-    "@#%^&*()_+-=.,:;?";  
-
-constexpr auto CHAR_SET_SIZE = sizeof(CHAR_SET) - 1;
 
 struct hash_info {
     std::string algorithm;
@@ -36,12 +30,17 @@ void print_hash_info(const hash_info& info);
 hash_info parse_hash_info(const std::string& hash_field);
 std::vector<std::string> split(const std::string& str, char delim);
 
-std::string generate_hash(const std::string& password_candidate, 
-                          const hash_info& hashData);
 std::string generate_salt_for_hash(const hash_info& hashData);
 
 void generate_combination(std::string &starter);
-void update_total_work_done(std::shared_ptr<std::atomic<uint16_t>> &total_work_done, 
+// Brute force in length order: CHAR_SET strings of min_length and up as one
+// index space, shortest first, last character least significant
+void length_order_candidate(uint64_t index, size_t min_length, std::string &candidate);
+// The string after candidate in that order (the first one longer after the
+// last of its length)
+void next_length_order(std::string &candidate);
+void update_total_work_done(std::shared_ptr<std::atomic<uint32_t>> &total_work_done, 
+                            const size_t count,
                             const uint16_t work_size, 
                             std::shared_ptr<std::atomic<bool>> &work_completed);
 
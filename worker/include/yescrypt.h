@@ -0,0 +1,49 @@
+#ifndef YESCRYPT_H
+#define YESCRYPT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// In-tree yescrypt ($y$) and classic scrypt ($7$) that run in caller-owned
+// working memory instead of allocating the V region on every hash.
+constexpr uint32_t YESCRYPT_WORM = 0x001;
+constexpr uint32_t YESCRYPT_RW = 0x002;
+constexpr uint32_t YESCRYPT_RW_FLAVOR_MASK = 0x3fc;
+// RW | ROUNDS_6 | GATHER_4 | SIMPLE_2 | SBOX_12K, the only RW flavor defined
+constexpr uint32_t YESCRYPT_RW_DEFAULTS = 0x0b6;
+constexpr uint32_t YESCRYPT_PREHASH = 0x10000000;
+
+constexpr size_t YESCRYPT_HASH_BYTES = 32;
+constexpr size_t YESCRYPT_HASH_CHARS = 43;
+constexpr size_t YESCRYPT_MAX_SALT = 64;
+
+struct YescryptParams {
+    uint32_t flags = 0;
+    uint64_t N = 0;
+    uint32_t r = 0;
+    uint32_t p = 1;
+    uint32_t t = 0;
+    uint32_t g = 0;
+    uint64_t NROM = 0;
+};
+
+// Parses a "$y$..." or "$7$..." setting (everything up to the hash). Returns
+// false for malformed settings and for features this engine does not
+// implement (ROM, hash upgrades, non-default RW flavors).
+bool yescrypt_parse_setting(const std::string &setting, YescryptParams &params,
+                            std::vector<uint8_t> &salt);
+
+// yescrypt's little-endian base64; dst_len is in/out
+bool yescrypt_decode64(const char *src, size_t src_len, uint8_t *dst, size_t &dst_len);
+
+// Working memory one yescrypt_hash call needs
+size_t yescrypt_arena_bytes(const YescryptParams &params);
+
+void yescrypt_hash(const YescryptParams &params,
+                   const uint8_t *passwd, size_t passwd_len,
+                   const uint8_t *salt, size_t salt_len,
+                   void *arena, uint8_t out[YESCRYPT_HASH_BYTES]);
+
+#endif // YESCRYPT_H
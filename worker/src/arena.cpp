@@ -0,0 +1,111 @@
+#include "arena.h"
+#include "cpu_topology.h"
+
+#include <sys/mman.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+    std::mutex arena_mutex;
+    std::vector<std::unique_ptr<MemoryArena>> free_arenas;
+}
+
+MemoryArena::MemoryArena(size_t bytes)
+{
+    size_ = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    node_ = current_numa_node();
+
+#ifdef MAP_HUGETLB
+    // Explicit huge pages only succeed if the admin reserved them
+    data_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+    if (data_ != MAP_FAILED)
+    {
+        huge_ = true;
+        return;
+    }
+#endif
+
+    data_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (data_ == MAP_FAILED)
+    {
+        data_ = nullptr;
+        throw std::bad_alloc();
+    }
+#ifdef MADV_HUGEPAGE
+    huge_ = madvise(data_, size_, MADV_HUGEPAGE) == 0;
+#endif
+    // Fault everything in now (after the hint, so THP can back it)
+    std::memset(data_, 0, size_);
+}
+
+MemoryArena::~MemoryArena()
+{
+    if (data_)
+        munmap(data_, size_);
+}
+
+PooledArena arena_acquire(size_t bytes)
+{
+    {
+        const int node = current_numa_node();
+        std::lock_guard<std::mutex> lock(arena_mutex);
+        auto best = free_arenas.end();
+        for (auto it = free_arenas.begin(); it != free_arenas.end(); ++it)
+        {
+            if ((*it)->size() >= bytes && (best == free_arenas.end() || (*it)->node() == node))
+            {
+                best = it;
+                if ((*it)->node() == node)
+                    break;
+            }
+        }
+        if (best != free_arenas.end())
+        {
+            PooledArena arena((*best).release());
+            free_arenas.erase(best);
+            return arena;
+        }
+    }
+    return PooledArena(new MemoryArena(bytes));
+}
+
+void ArenaRelease::operator()(MemoryArena *arena) const
+{
+    std::lock_guard<std::mutex> lock(arena_mutex);
+    free_arenas.emplace_back(arena);
+}
+
+size_t arena_trim(size_t bytes)
+{
+    const size_t keep = (bytes + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+    std::lock_guard<std::mutex> lock(arena_mutex);
+    free_arenas.erase(std::remove_if(free_arenas.begin(), free_arenas.end(),
+                                     [&](const std::unique_ptr<MemoryArena> &arena) { return arena->size() != keep; }),
+                      free_arenas.end());
+    return free_arenas.size() * keep;
+}
+
+size_t available_memory_bytes()
+{
+    std::ifstream meminfo("/proc/meminfo");
+    std::string line;
+    while (std::getline(meminfo, line))
+    {
+        if (line.rfind("MemAvailable:", 0) == 0)
+        {
+            std::istringstream iss(line.substr(13));
+            size_t kb = 0;
+            iss >> kb;
+            return kb * 1024;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,252 @@
+#include "bcrypt.h"
+
+#include <cstring>
+
+namespace
+{
+    const char BCRYPT_ALPHABET[] =
+        "./ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+
+    // "OrpheanBeholderScryDoubt" as big-endian words
+    constexpr uint32_t BCRYPT_CTEXT[6] = {
+        0x4f727068, 0x65616e42, 0x65686f6c, 0x64657253, 0x63727944, 0x6f756274};
+
+    int base64_value(char c)
+    {
+        const char *pos = std::strchr(BCRYPT_ALPHABET, c);
+        return (c != '\0' && pos != nullptr) ? static_cast<int>(pos - BCRYPT_ALPHABET) : -1;
+    }
+
+    // Big-endian words cycled over data, as Blowfish's key schedule reads it
+    void stream_words(const uint8_t *data, size_t len, uint32_t *words, size_t count)
+    {
+        size_t j = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            uint32_t w = 0;
+            for (int b = 0; b < 4; ++b)
+            {
+                w = (w << 8) | data[j];
+                j = (j + 1) % len;
+            }
+            words[i] = w;
+        }
+    }
+
+    inline uint32_t feistel(const BlowfishState &st, uint32_t x)
+    {
+        return ((st.S[0][x >> 24] + st.S[1][(x >> 16) & 0xff]) ^ st.S[2][(x >> 8) & 0xff]) +
+               st.S[3][x & 0xff];
+    }
+
+    // One Blowfish block per lane, rounds interleaved across lanes
+    template <size_t L>
+    inline void encrypt_lanes(const BlowfishState *st, uint32_t *l, uint32_t *r)
+    {
+        for (size_t k = 0; k < L; ++k)
+            l[k] ^= st[k].P[0];
+        for (size_t i = 1; i <= 16; i += 2)
+        {
+            for (size_t k = 0; k < L; ++k)
+                r[k] ^= feistel(st[k], l[k]) ^ st[k].P[i];
+            for (size_t k = 0; k < L; ++k)
+                l[k] ^= feistel(st[k], r[k]) ^ st[k].P[i + 1];
+        }
+        for (size_t k = 0; k < L; ++k)
+        {
+            uint32_t t = l[k];
+            l[k] = r[k] ^ st[k].P[17];
+            r[k] = t;
+        }
+    }
+
+    // Re-derives P and S by chained encryption. With salt == nullptr this is
+    // Blowfish_expand0state, otherwise the salted Blowfish_expandstate.
+    template <size_t L>
+    inline void rekey_lanes(BlowfishState *st, const uint32_t *salt)
+    {
+        uint32_t l[L] = {0};
+        uint32_t r[L] = {0};
+        size_t s = 0;
+        for (size_t i = 0; i < BLOWFISH_P_WORDS; i += 2)
+        {
+            if (salt)
+            {
+                for (size_t k = 0; k < L; ++k)
+                {
+                    l[k] ^= salt[s];
+                    r[k] ^= salt[s + 1];
+                }
+                s ^= 2;
+            }
+            encrypt_lanes<L>(st, l, r);
+            for (size_t k = 0; k < L; ++k)
+            {
+                st[k].P[i] = l[k];
+                st[k].P[i + 1] = r[k];
+            }
+        }
+        for (size_t b = 0; b < 4; ++b)
+        {
+            for (size_t i = 0; i < 256; i += 2)
+            {
+                if (salt)
+                {
+                    for (size_t k = 0; k < L; ++k)
+                    {
+                        l[k] ^= salt[s];
+                        r[k] ^= salt[s + 1];
+                    }
+                    s ^= 2;
+                }
+                encrypt_lanes<L>(st, l, r);
+                for (size_t k = 0; k < L; ++k)
+                {
+                    st[k].S[b][i] = l[k];
+                    st[k].S[b][i + 1] = r[k];
+                }
+            }
+        }
+    }
+
+    template <size_t L>
+    inline void xor_key_lanes(BlowfishState *st, const uint32_t (*words)[BLOWFISH_P_WORDS])
+    {
+        for (size_t k = 0; k < L; ++k)
+            for (size_t i = 0; i < BLOWFISH_P_WORDS; ++i)
+                st[k].P[i] ^= words[k][i];
+    }
+
+    template <size_t L>
+    void eksblowfish_lanes(BlowfishState *st, const uint32_t (*key_words)[BLOWFISH_P_WORDS],
+                           const uint32_t (*salt_words)[BLOWFISH_P_WORDS], unsigned cost,
+                           uint8_t out[][BCRYPT_HASH_BYTES])
+    {
+        for (size_t k = 0; k < L; ++k)
+        {
+            std::memcpy(st[k].P, BLOWFISH_P_INIT, sizeof(st[k].P));
+            std::memcpy(st[k].S, BLOWFISH_S_INIT, sizeof(st[k].S));
+        }
+
+        xor_key_lanes<L>(st, key_words);
+        rekey_lanes<L>(st, salt_words[0]);
+
+        const uint64_t rounds = uint64_t(1) << cost;
+        for (uint64_t n = 0; n < rounds; ++n)
+        {
+            xor_key_lanes<L>(st, key_words);
+            rekey_lanes<L>(st, nullptr);
+            xor_key_lanes<L>(st, salt_words);
+            rekey_lanes<L>(st, nullptr);
+        }
+
+        uint32_t cdata[L][6];
+        for (size_t k = 0; k < L; ++k)
+            std::memcpy(cdata[k], BCRYPT_CTEXT, sizeof(BCRYPT_CTEXT));
+
+        for (int n = 0; n < 64; ++n)
+        {
+            for (size_t blk = 0; blk < 6; blk += 2)
+            {
+                uint32_t l[L], r[L];
+                for (size_t k = 0; k < L; ++k)
+                {
+                    l[k] = cdata[k][blk];
+                    r[k] = cdata[k][blk + 1];
+                }
+                encrypt_lanes<L>(st, l, r);
+                for (size_t k = 0; k < L; ++k)
+                {
+                    cdata[k][blk] = l[k];
+                    cdata[k][blk + 1] = r[k];
+                }
+            }
+        }
+
+        for (size_t k = 0; k < L; ++k)
+        {
+            uint8_t full[24];
+            for (size_t i = 0; i < 6; ++i)
+            {
+                full[4 * i] = cdata[k][i] >> 24;
+                full[4 * i + 1] = (cdata[k][i] >> 16) & 0xff;
+                full[4 * i + 2] = (cdata[k][i] >> 8) & 0xff;
+                full[4 * i + 3] = cdata[k][i] & 0xff;
+            }
+            std::memcpy(out[k], full, BCRYPT_HASH_BYTES);
+        }
+    }
+}
+
+bool bcrypt_decode_base64(const char *src, size_t src_len, uint8_t *dst, size_t dst_len)
+{
+    size_t produced = 0;
+    size_t i = 0;
+    while (produced < dst_len)
+    {
+        int c[4] = {0, 0, 0, 0};
+        for (int n = 0; n < 4; ++n)
+        {
+            if (i + n < src_len)
+            {
+                c[n] = base64_value(src[i + n]);
+                if (c[n] < 0)
+                    return false;
+            }
+            else if (n < 2)
+            {
+                return false;
+            }
+        }
+        i += 4;
+
+        dst[produced++] = static_cast<uint8_t>((c[0] << 2) | ((c[1] & 0x30) >> 4));
+        if (produced >= dst_len)
+            break;
+        dst[produced++] = static_cast<uint8_t>(((c[1] & 0x0f) << 4) | ((c[2] & 0x3c) >> 2));
+        if (produced >= dst_len)
+            break;
+        dst[produced++] = static_cast<uint8_t>(((c[2] & 0x03) << 6) | c[3]);
+    }
+    return true;
+}
+
+void bcrypt_hash_lanes(BlowfishState *states,
+                       const char *const *keys, const size_t *key_lens, size_t count,
+                       const uint8_t salt[BCRYPT_SALT_BYTES], unsigned cost,
+                       uint8_t out[][BCRYPT_HASH_BYTES])
+{
+    uint32_t key_words[BCRYPT_LANES][BLOWFISH_P_WORDS];
+    uint32_t salt_words[BCRYPT_LANES][BLOWFISH_P_WORDS];
+    uint32_t salt_stream[4];
+    stream_words(salt, BCRYPT_SALT_BYTES, salt_stream, 4);
+
+    // Narrowest instantiation that covers count, so partial groups do not
+    // pay for idle lanes
+    const size_t lanes = count > BCRYPT_NARROW_LANES ? BCRYPT_LANES
+                         : count > 1                 ? BCRYPT_NARROW_LANES
+                                                     : 1;
+    for (size_t k = 0; k < lanes; ++k)
+    {
+        // Idle lanes repeat the first key; their output is discarded
+        size_t src = k < count ? k : 0;
+        uint8_t key[BCRYPT_MAX_KEY + 1];
+        size_t len = key_lens[src] > BCRYPT_MAX_KEY ? BCRYPT_MAX_KEY : key_lens[src];
+        std::memcpy(key, keys[src], len);
+        key[len] = '\0'; // $2b$ keys include the terminating NUL
+        stream_words(key, len + 1, key_words[k], BLOWFISH_P_WORDS);
+        for (size_t i = 0; i < BLOWFISH_P_WORDS; ++i)
+            salt_words[k][i] = salt_stream[i % 4];
+    }
+
+    uint8_t result[BCRYPT_LANES][BCRYPT_HASH_BYTES];
+    if (lanes == BCRYPT_LANES)
+        eksblowfish_lanes<BCRYPT_LANES>(states, key_words, salt_words, cost, result);
+    else if (lanes == BCRYPT_NARROW_LANES)
+        eksblowfish_lanes<BCRYPT_NARROW_LANES>(states, key_words, salt_words, cost, result);
+    else
+        eksblowfish_lanes<1>(states, key_words, salt_words, cost, result);
+
+    for (size_t k = 0; k < count; ++k)
+        std::memcpy(out[k], result[k], BCRYPT_HASH_BYTES);
+}
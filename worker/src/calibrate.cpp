@@ -0,0 +1,99 @@
+#include "calibrate.h"
+#include "cpu_topology.h"
+
+#include <array>
+#include <chrono>
+#include <map>
+#include <thread>
+
+namespace
+{
+    // Candidates per second of count pinned threads, each timed to the end
+    // of the batch it was hashing when the time ran out
+    double measure(const std::vector<TargetGroup> &groups, size_t count)
+    {
+        const auto &order = cpu_topology().order;
+        const CrackState state(groups);
+        std::atomic<size_t> ready(0);
+        std::atomic<bool> stop(false);
+        std::vector<double> rates(count, 0);
+        std::vector<std::thread> pool;
+        for (size_t t = 0; t < count; ++t)
+        {
+            pool.emplace_back([&, t]() {
+                pin_current_thread(order[t % order.size()]);
+                EngineSet engines(groups);
+                std::array<std::string, MAX_ENGINE_LANES> batch;
+                for (size_t i = 0; i < batch.size(); ++i)
+                    batch[i] = "calib" + std::to_string(100 + i);
+                std::vector<GroupHit> hits;
+                ready.fetch_add(1);
+                while (ready.load() < count)
+                    std::this_thread::yield();
+                const auto start = std::chrono::steady_clock::now();
+                size_t hashed = 0;
+                while (!stop.load(std::memory_order_relaxed))
+                {
+                    hits.clear();
+                    engines.find_matches(batch.data(), engines.batch_size(), state, hits);
+                    hashed += engines.batch_size();
+                }
+                rates[t] = hashed / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            });
+        }
+        while (ready.load() < count)
+            std::this_thread::yield();
+        std::this_thread::sleep_for(std::chrono::milliseconds(CALIBRATION_MS));
+        stop.store(true);
+        double total = 0;
+        for (size_t t = 0; t < count; ++t)
+        {
+            pool[t].join();
+            total += rates[t];
+        }
+        return total;
+    }
+}
+
+int calibrate_threads(const std::vector<TargetGroup> &groups, int max_threads)
+{
+    static std::map<std::string, int> measured;
+    std::string key = std::to_string(max_threads);
+    for (const auto &group : groups)
+        key += " " + group.info.algorithm + "$" + group.info.options;
+    auto known = measured.find(key);
+    if (known != measured.end())
+        return known->second;
+
+    const auto &topology = cpu_topology();
+    const size_t logical = topology.order.size();
+    const size_t cap = std::min(static_cast<size_t>(max_threads), logical);
+    std::vector<size_t> counts;
+    for (size_t count : {topology.cores / 2, topology.cores, (topology.cores + logical) / 2, logical})
+    {
+        count = std::min(count, cap);
+        if (count > 0 && (counts.empty() || count > counts.back()))
+            counts.push_back(count);
+    }
+
+    int best = static_cast<int>(counts.back());
+    if (counts.size() > 1)
+    {
+        std::cout << "Calibrating threads (" << topology.cores << " cores, " << logical << " CPUs, "
+                  << topology.nodes << " NUMA nodes):";
+        double best_rate = 0;
+        for (size_t count : counts)
+        {
+            const double rate = measure(groups, count);
+            std::cout << " " << count << " -> " << static_cast<uint64_t>(rate) << " H/s;";
+            if (rate > best_rate)
+            {
+                best_rate = rate;
+                best = static_cast<int>(count);
+            }
+        }
+        std::cout << " using " << best << "\n";
+    }
+    measured[key] = best;
+    return best;
+}
@@ -0,0 +1,406 @@
+#include "candidates.h"
+#include "worker.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+CandidateSource::CandidateSource(AttackMode mode, const std::string &token, const AttackInputs &inputs)
+{
+    switch (mode)
+    {
+    case AttackMode::BRUTE_FORCE:
+        source_ = BruteForce{token};
+        break;
+    case AttackMode::WORDLIST:
+    {
+        RangeToken range;
+        uint64_t inner_size = 0;
+        switch (inputs.inner)
+        {
+        case InnerDimension::NONE: break;
+        case InnerDimension::RULES: inner_size = inputs.rules->size(); break;
+        case InnerDimension::MASK_SUFFIX:
+        case InnerDimension::MASK_PREFIX: inner_size = inputs.mask->keyspace(); break;
+        case InnerDimension::SECOND_LIST: inner_size = inputs.second->size(); break;
+        }
+        if (!inputs.wordlist || !parse_range(token, range) || range.stride != 1 ||
+            (range.inner_end > 0) != (inputs.inner != InnerDimension::NONE) || range.inner_end > inner_size)
+        {
+            throw std::runtime_error("Bad wordlist lease: " + token);
+        }
+        inputs.wordlist->will_need(range.cursor, range.end);
+        if (inputs.inner == InnerDimension::SECOND_LIST)
+            inputs.second->will_need(range.inner_begin, range.inner_end);
+        if (inputs.inner == InnerDimension::NONE)
+            source_ = WordlistRange{inputs.wordlist, range};
+        else
+            source_ = CrossRange{inputs, range, {}, 0, false, {}, {}};
+        break;
+    }
+    case AttackMode::MASK:
+    {
+        RangeToken range;
+        if (!inputs.mask || !parse_range(token, range) || range.inner_end != 0 ||
+            range.end > inputs.mask->keyspace())
+        {
+            throw std::runtime_error("Bad mask lease: " + token);
+        }
+        MaskRange masked{inputs.mask, range, {}, {}};
+        if (range.cursor < range.end)
+            inputs.mask->decode(range.cursor, masked.current, masked.digits);
+        source_ = std::move(masked);
+        break;
+    }
+    case AttackMode::BY_LENGTH:
+    {
+        RangeToken range;
+        if (!parse_range(token, range) || range.inner_end != 0 || range.end > inputs.keyspace)
+        {
+            throw std::runtime_error("Bad brute force lease: " + token);
+        }
+        LengthRange lengths{range, inputs.min_length, {}};
+        if (range.cursor < range.end)
+            length_order_candidate(range.cursor, inputs.min_length, lengths.current);
+        source_ = std::move(lengths);
+        break;
+    }
+    }
+}
+
+size_t CandidateSource::fill(std::string *batch, size_t max)
+{
+    if (auto *brute = std::get_if<BruteForce>(&source_))
+    {
+        for (size_t n = 0; n < max; ++n)
+        {
+            batch[n] = brute->next;
+            generate_combination(brute->next);
+        }
+        return max;
+    }
+
+    if (auto *plain = std::get_if<WordlistRange>(&source_))
+    {
+        size_t n = 0;
+        while (n < max && next_word(*plain->list, plain->range.cursor, plain->range.end, batch[n]))
+            ++n;
+        return n;
+    }
+
+    if (auto *masked = std::get_if<MaskRange>(&source_))
+    {
+        auto &range = masked->range;
+        if (range.stride > 1)
+        {
+            size_t n = 0;
+            for (; n < max && range.cursor < range.end; ++n, range.cursor += range.stride)
+                masked->mask->decode(range.cursor, batch[n], masked->digits);
+            return n;
+        }
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(max, range.end - range.cursor));
+        for (size_t i = 0; i < n; ++i)
+        {
+            batch[i] = masked->current;
+            masked->mask->next(masked->current, masked->digits);
+        }
+        range.cursor += n;
+        return n;
+    }
+
+    if (auto *lengths = std::get_if<LengthRange>(&source_))
+    {
+        auto &range = lengths->range;
+        if (range.stride > 1)
+        {
+            size_t n = 0;
+            for (; n < max && range.cursor < range.end; ++n, range.cursor += range.stride)
+                length_order_candidate(range.cursor, lengths->min_length, batch[n]);
+            return n;
+        }
+        const size_t n = static_cast<size_t>(std::min<uint64_t>(max, range.end - range.cursor));
+        for (size_t i = 0; i < n; ++i)
+        {
+            batch[i] = lengths->current;
+            next_length_order(lengths->current);
+        }
+        range.cursor += n;
+        return n;
+    }
+
+    auto &cross = std::get<CrossRange>(source_);
+    const auto &inputs = cross.inputs;
+    auto &range = cross.range;
+    size_t n = 0;
+    while (n < max)
+    {
+        if (cross.have_word && range.inner == range.inner_end)
+        {
+            range.cursor = cross.next_word;
+            range.inner = range.inner_begin;
+            cross.have_word = false;
+        }
+        if (!cross.have_word)
+        {
+            cross.next_word = range.cursor;
+            if (!next_word(*inputs.wordlist, cross.next_word, range.end, cross.word))
+            {
+                range.cursor = range.end;
+                break;
+            }
+            cross.have_word = true;
+            if (inputs.mask && range.inner < range.inner_end)
+                inputs.mask->decode(range.inner, cross.inner, cross.digits);
+            continue; // a resumed position may already be past its inner range
+        }
+        // Candidates are concatenated into the batch strings, which keep
+        // their capacity, so no cross product is ever built
+        switch (inputs.inner)
+        {
+        case InnerDimension::RULES:
+            // Rejected rules produce nothing, so a batch may span several words
+            if (inputs.rules->apply(range.inner++, cross.word, batch[n]))
+                ++n;
+            break;
+        case InnerDimension::MASK_SUFFIX:
+        case InnerDimension::MASK_PREFIX:
+            if (inputs.inner == InnerDimension::MASK_SUFFIX)
+                batch[n].assign(cross.word).append(cross.inner);
+            else
+                batch[n].assign(cross.inner).append(cross.word);
+            ++n;
+            ++range.inner;
+            inputs.mask->next(cross.inner, cross.digits);
+            break;
+        case InnerDimension::SECOND_LIST:
+            if (next_word(*inputs.second, range.inner, range.inner_end, cross.inner))
+                batch[n++].assign(cross.word).append(cross.inner);
+            else
+                range.inner = range.inner_end;
+            break;
+        case InnerDimension::NONE:
+            range.inner = range.inner_end;
+            break;
+        }
+    }
+    return n;
+}
+
+std::string CandidateSource::position() const
+{
+    if (auto *brute = std::get_if<BruteForce>(&source_))
+        return brute->next;
+    if (auto *plain = std::get_if<WordlistRange>(&source_))
+        return format_range(plain->range);
+    if (auto *masked = std::get_if<MaskRange>(&source_))
+        return format_range(masked->range);
+    if (auto *lengths = std::get_if<LengthRange>(&source_))
+        return format_range(lengths->range);
+    return format_range(std::get<CrossRange>(source_).range);
+}
+
+namespace
+{
+    // Maps a file the controller's attack names, once per node; the copy
+    // must have the controller's size
+    const Wordlist &open_input(std::unique_ptr<Wordlist> &list, const std::string &path, uint64_t size,
+                               const char *what, const char *option)
+    {
+        if (path.empty())
+        {
+            throw std::runtime_error(std::string("Controller's attack uses a ") + what +
+                                     "; start the worker with " + option);
+        }
+        if (!list)
+        {
+            list = std::make_unique<Wordlist>(path);
+        }
+        if (list->size() != size)
+        {
+            throw std::runtime_error(std::string("Local ") + what + " is " + std::to_string(list->size()) +
+                                     " bytes, controller's is " + std::to_string(size));
+        }
+        return *list;
+    }
+}
+
+void Attack::configure(const std::string &payload, const AttackFiles &files)
+{
+    mode_ = AttackMode::BRUTE_FORCE;
+    inputs_ = AttackInputs{};
+    if (payload.empty())
+    {
+        std::cout << "Attack: brute force\n";
+        return;
+    }
+
+    std::istringstream lines(payload);
+    std::string options_line;
+    std::getline(lines, options_line);
+    std::istringstream options(options_line);
+    auto value = [&](int base) {
+        uint64_t v = 0;
+        if (!(options >> std::setbase(base) >> v))
+        {
+            throw std::runtime_error("Malformed attack from controller: " + options_line);
+        }
+        return v;
+    };
+    bool has_mask = false;
+    uint64_t wordlist_size = 0, corpus_size = 0;
+    std::string option;
+    while (options >> option)
+    {
+        if (option == "wordlist")
+        {
+            wordlist_size = value(16);
+            open_input(wordlist_, files.wordlist, wordlist_size, "wordlist", "--wordlist");
+            mode_ = AttackMode::WORDLIST;
+            inputs_.wordlist = wordlist_.get();
+        }
+        else if (option == "rules")
+        {
+            const uint64_t rule_count = value(10);
+            if (files.rules.empty())
+            {
+                throw std::runtime_error("Controller applies rules; start the worker with --rules");
+            }
+            if (!rules_)
+            {
+                rules_ = std::make_unique<RuleSet>(files.rules);
+            }
+            if (rules_->size() != rule_count)
+            {
+                throw std::runtime_error("Local rules file has " + std::to_string(rules_->size()) +
+                                         " rules, controller's has " + std::to_string(rule_count));
+            }
+            inputs_.inner = InnerDimension::RULES;
+            inputs_.rules = rules_.get();
+        }
+        else if (option == "combine")
+        {
+            inputs_.second = &open_input(second_, files.combine, value(16), "second wordlist", "--combine");
+            inputs_.inner = InnerDimension::SECOND_LIST;
+        }
+        else if (option == "mask" || option == "mask-first")
+        {
+            has_mask = true;
+            inputs_.inner = option == "mask" ? InnerDimension::MASK_SUFFIX : InnerDimension::MASK_PREFIX;
+        }
+        else if (option == "markov")
+        {
+            corpus_size = value(16);
+        }
+        else if (option == "lengths")
+        {
+            inputs_.min_length = static_cast<uint32_t>(value(10));
+            const uint64_t max_length = value(10);
+            if (inputs_.min_length == 0 || max_length < inputs_.min_length)
+            {
+                throw std::runtime_error("Malformed attack from controller: " + options_line);
+            }
+            // Strings of min_length..max_length; the controller checked it fits
+            uint64_t count = 1;
+            for (uint64_t length = 1; length <= max_length; ++length)
+            {
+                count *= CHAR_SET_SIZE;
+                if (length >= inputs_.min_length)
+                {
+                    inputs_.keyspace += count;
+                }
+            }
+            mode_ = AttackMode::BY_LENGTH;
+            std::cout << "Attack: brute force, lengths " << inputs_.min_length << "-" << max_length
+                      << " shortest first (" << inputs_.keyspace << " candidates)\n";
+            return;
+        }
+        else
+        {
+            throw std::runtime_error("Unknown attack from controller: " + options_line);
+        }
+    }
+
+    std::string mask;
+    if (has_mask)
+    {
+        std::array<std::string, MASK_CUSTOM_CHARSETS> custom;
+        std::getline(lines, mask);
+        for (auto &set : custom)
+        {
+            std::getline(lines, set);
+        }
+        try
+        {
+            mask_ = std::make_unique<Mask>(mask, custom);
+        }
+        catch (const std::invalid_argument &e)
+        {
+            throw std::runtime_error(std::string("Bad mask from controller: ") + e.what());
+        }
+        if (corpus_size > 0)
+        {
+            // Trained once, but every CONACK (a job queue sends several) is
+            // checked against the corpus it was trained on
+            if (markov_ && markov_corpus_size_ != corpus_size)
+            {
+                throw std::runtime_error("Local Markov corpus is " + std::to_string(markov_corpus_size_) +
+                                         " bytes, controller's is " + std::to_string(corpus_size));
+            }
+            if (!markov_)
+            {
+                std::unique_ptr<Wordlist> corpus;
+                markov_ = std::make_unique<MarkovModel>(
+                    open_input(corpus, files.markov, corpus_size, "Markov corpus", "--markov"));
+                markov_corpus_size_ = corpus_size;
+                std::cout << "Markov: trained on " << markov_->words() << " words from " << files.markov << "\n";
+            }
+            mask_->reorder(*markov_);
+        }
+        inputs_.mask = mask_.get();
+        if (mode_ == AttackMode::BRUTE_FORCE)
+        {
+            mode_ = AttackMode::MASK;
+            inputs_.inner = InnerDimension::NONE;
+        }
+    }
+
+    auto describe_mask = [&]() {
+        std::cout << "mask " << mask << " (" << mask_->keyspace() << " candidates"
+                  << (corpus_size > 0 ? ", Markov order" : "") << ")";
+    };
+    std::cout << "Attack: ";
+    if (inputs_.inner == InnerDimension::MASK_PREFIX)
+    {
+        describe_mask();
+        std::cout << " + ";
+    }
+    if (inputs_.wordlist)
+    {
+        std::cout << "wordlist " << files.wordlist << " (" << wordlist_size << " bytes)";
+    }
+    switch (inputs_.inner)
+    {
+    case InnerDimension::NONE:
+        if (inputs_.mask)
+        {
+            describe_mask();
+        }
+        break;
+    case InnerDimension::RULES:
+        std::cout << " x " << rules_->size() << " rules from " << files.rules;
+        if (rules_->invalid() > 0)
+        {
+            std::cout << " (" << rules_->invalid() << " unsupported, skipped)";
+        }
+        break;
+    case InnerDimension::MASK_SUFFIX:
+        std::cout << " + ";
+        describe_mask();
+        break;
+    case InnerDimension::MASK_PREFIX: break;
+    case InnerDimension::SECOND_LIST: std::cout << " + each word of " << files.combine; break;
+    }
+    std::cout << "\n";
+}
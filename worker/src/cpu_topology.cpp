@@ -0,0 +1,145 @@
+#include "cpu_topology.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+
+namespace
+{
+    // "0-3,8,10-11" as in sysfs cpulist files
+    std::vector<int> parse_cpu_list(const std::string &list)
+    {
+        std::vector<int> cpus;
+        std::istringstream parts(list);
+        std::string part;
+        while (std::getline(parts, part, ','))
+        {
+            int first = 0, last = 0;
+            char dash = 0;
+            std::istringstream range(part);
+            if (!(range >> first))
+                continue;
+            if (!(range >> dash >> last) || dash != '-')
+                last = first;
+            for (int cpu = first; cpu <= last; ++cpu)
+                cpus.push_back(cpu);
+        }
+        return cpus;
+    }
+
+    std::string read_line(const std::string &path)
+    {
+        std::ifstream in(path);
+        std::string line;
+        std::getline(in, line);
+        return line;
+    }
+
+    int read_int(const std::string &path, int fallback)
+    {
+        std::istringstream line(read_line(path));
+        int value = fallback;
+        line >> value;
+        return value;
+    }
+
+    CpuTopology read_topology()
+    {
+        std::vector<int> allowed;
+        cpu_set_t mask;
+        CPU_ZERO(&mask);
+        if (sched_getaffinity(0, sizeof(mask), &mask) == 0)
+        {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            {
+                if (CPU_ISSET(cpu, &mask))
+                    allowed.push_back(cpu);
+            }
+        }
+        if (allowed.empty())
+        {
+            for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu)
+                allowed.push_back(static_cast<int>(cpu));
+        }
+
+        std::map<int, int> node_of;
+        for (int node = 0;; ++node)
+        {
+            std::ifstream list("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+            if (!list)
+                break;
+            std::string line;
+            std::getline(list, line);
+            for (int cpu : parse_cpu_list(line))
+                node_of[cpu] = node;
+        }
+
+        // (node, package, core) -> its hardware threads
+        std::map<std::tuple<int, int, int>, std::vector<int>> cores;
+        for (int cpu : allowed)
+        {
+            const std::string base = "/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/";
+            const int package = read_int(base + "physical_package_id", 0);
+            const int core = read_int(base + "core_id", cpu);
+            const auto node = node_of.find(cpu);
+            cores[{node == node_of.end() ? 0 : node->second, package, core}].push_back(cpu);
+        }
+
+        std::map<int, std::vector<const std::vector<int> *>> cores_of_node;
+        for (const auto &[key, threads] : cores)
+            cores_of_node[std::get<0>(key)].push_back(&threads);
+
+        CpuTopology topology;
+        topology.cores = cores.size();
+        topology.nodes = cores_of_node.size();
+        for (size_t sibling = 0; topology.order.size() < allowed.size(); ++sibling)
+        {
+            for (size_t index = 0;; ++index)
+            {
+                bool any = false;
+                for (const auto &[node, node_cores] : cores_of_node)
+                {
+                    if (index >= node_cores.size())
+                        continue;
+                    any = true;
+                    if (sibling < node_cores[index]->size())
+                        topology.order.push_back((*node_cores[index])[sibling]);
+                }
+                if (!any)
+                    break;
+            }
+        }
+        return topology;
+    }
+}
+
+const CpuTopology &cpu_topology()
+{
+    static const CpuTopology topology = read_topology();
+    return topology;
+}
+
+bool pin_current_thread(int cpu)
+{
+    cpu_set_t mask;
+    CPU_ZERO(&mask);
+    CPU_SET(cpu, &mask);
+    return pthread_setaffinity_np(pthread_self(), sizeof(mask), &mask) == 0;
+}
+
+int current_numa_node()
+{
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+        return 0;
+    return static_cast<int>(node);
+}
@@ -0,0 +1,93 @@
+#include "digest_set.h"
+
+#include <algorithm>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+
+namespace
+{
+    uint64_t load64(const uint8_t *p)
+    {
+        uint64_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+}
+
+DigestSet::DigestSet(size_t digest_bytes, std::vector<uint8_t> digests)
+    : digest_bytes_(digest_bytes)
+{
+    if (digest_bytes_ < 16 || digests.size() % digest_bytes_ != 0)
+    {
+        throw std::invalid_argument("DigestSet: bad digest size");
+    }
+    const size_t count = digests.size() / digest_bytes_;
+
+    std::vector<uint32_t> order(count);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return std::memcmp(&digests[a * digest_bytes_], &digests[b * digest_bytes_], digest_bytes_) < 0;
+    });
+
+    digests_.resize(digests.size());
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::memcpy(&digests_[i * digest_bytes_], &digests[order[i] * digest_bytes_], digest_bytes_);
+    }
+    targets_ = std::move(order);
+
+    size_t nblocks = (count * BITS_PER_DIGEST + BLOCK_WORDS * 32 - 1) / (BLOCK_WORDS * 32);
+    blocks_.assign(std::max<size_t>(nblocks, 1), Block{});
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint8_t *digest = &digests_[i * digest_bytes_];
+        uint32_t mask[BLOCK_WORDS];
+        block_mask(digest, mask);
+        auto &block = blocks_[block_of(digest)];
+        for (size_t w = 0; w < BLOCK_WORDS; ++w)
+            block.words[w] |= mask[w];
+    }
+}
+
+size_t DigestSet::block_of(const uint8_t *digest) const
+{
+    // Multiply-shift maps the top 32 bits onto [0, blocks) without a division
+    return static_cast<size_t>(((load64(digest) >> 32) * blocks_.size()) >> 32);
+}
+
+// One bit in each word of the block, 5 bits of digest apiece
+void DigestSet::block_mask(const uint8_t *digest, uint32_t *mask)
+{
+    uint64_t bits = load64(digest + 8);
+    for (size_t w = 0; w < BLOCK_WORDS; ++w)
+        mask[w] = uint32_t(1) << ((bits >> (5 * w)) & 31);
+}
+
+bool DigestSet::maybe_contains(const uint8_t *digest) const
+{
+    const auto &block = blocks_[block_of(digest)];
+    uint32_t mask[BLOCK_WORDS];
+    block_mask(digest, mask);
+    uint32_t missing = 0;
+    for (size_t w = 0; w < BLOCK_WORDS; ++w)
+        missing |= mask[w] & ~block.words[w];
+    return missing == 0;
+}
+
+std::pair<size_t, size_t> DigestSet::find(const uint8_t *digest) const
+{
+    size_t lo = 0, hi = targets_.size();
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        if (std::memcmp(&digests_[mid * digest_bytes_], digest, digest_bytes_) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    size_t end = lo;
+    while (end < targets_.size() && std::memcmp(&digests_[end * digest_bytes_], digest, digest_bytes_) == 0)
+        ++end;
+    return {lo, end};
+}
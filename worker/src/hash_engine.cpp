@@ -0,0 +1,497 @@
+#include "hash_engine.h"
+
+#include <unordered_map>
+
+namespace
+{
+    bool is_bcrypt(const hash_info &info)
+    {
+        return info.algorithm == "$2b" || info.algorithm == "$2a" || info.algorithm == "$2y";
+    }
+
+    // hash_info keeps bcrypt's "cost$salt22" in salt; returns false if malformed
+    bool parse_bcrypt(const hash_info &info, unsigned &cost, uint8_t *salt, uint8_t *digest)
+    {
+        auto sep = info.salt.find('$');
+        if (sep == std::string::npos || sep == 0 ||
+            info.salt.size() - sep - 1 != BCRYPT_SALT_CHARS ||
+            info.hash.size() != BCRYPT_HASH_CHARS)
+            return false;
+        for (size_t i = 0; i < sep; ++i)
+            if (info.salt[i] < '0' || info.salt[i] > '9')
+                return false;
+
+        cost = static_cast<unsigned>(std::stoul(info.salt.substr(0, sep)));
+        if (cost < BCRYPT_MIN_COST || cost > BCRYPT_MAX_COST)
+            return false;
+
+        return bcrypt_decode_base64(info.salt.c_str() + sep + 1, BCRYPT_SALT_CHARS, salt, BCRYPT_SALT_BYTES) &&
+               bcrypt_decode_base64(info.hash.c_str(), BCRYPT_HASH_CHARS, digest, BCRYPT_HASH_BYTES);
+    }
+
+    bool is_yescrypt(const hash_info &info)
+    {
+        return info.algorithm == "$y" || info.algorithm == "$7";
+    }
+
+    // Setting is everything up to the last '$'; the digest follows it
+    bool parse_yescrypt(const hash_info &info, YescryptParams &params, std::vector<uint8_t> &salt,
+                        uint8_t *digest)
+    {
+        auto sep = info.full_hash.rfind('$');
+        if (sep == std::string::npos || info.full_hash.size() - sep - 1 != YESCRYPT_HASH_CHARS)
+            return false;
+        if (!yescrypt_parse_setting(info.full_hash.substr(0, sep + 1), params, salt))
+            return false;
+
+        size_t digest_len = YESCRYPT_HASH_BYTES;
+        return yescrypt_decode64(info.full_hash.c_str() + sep + 1, YESCRYPT_HASH_CHARS, digest, digest_len) &&
+               digest_len == YESCRYPT_HASH_BYTES;
+    }
+
+    bool is_md5crypt(const hash_info &info)
+    {
+        return info.algorithm == "$1" && info.salt.size() <= MD5CRYPT_MAX_SALT &&
+               info.hash.size() == MD5CRYPT_HASH_CHARS;
+    }
+
+    bool decode_hex(const std::string &hex, uint8_t *out, size_t out_len)
+    {
+        if (hex.size() != out_len * 2)
+            return false;
+        for (size_t i = 0; i < out_len; ++i)
+        {
+            int value = 0;
+            for (size_t j = 0; j < 2; ++j)
+            {
+                char c = hex[2 * i + j];
+                value <<= 4;
+                if (c >= '0' && c <= '9')
+                    value |= c - '0';
+                else if (c >= 'a' && c <= 'f')
+                    value |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F')
+                    value |= c - 'A' + 10;
+                else
+                    return false;
+            }
+            out[i] = static_cast<uint8_t>(value);
+        }
+        return true;
+    }
+
+    bool parse_raw(const hash_info &info, RawDigest &digest, size_t &digest_bytes, uint8_t *target)
+    {
+        if (info.algorithm == "raw-md5")
+        {
+            digest = RawDigest::MD5;
+            digest_bytes = MD5_DIGEST_BYTES;
+        }
+        else if (info.algorithm == "raw-sha1")
+        {
+            digest = RawDigest::SHA1;
+            digest_bytes = SHA1_DIGEST_BYTES;
+        }
+        else if (info.algorithm == "raw-sha256")
+        {
+            digest = RawDigest::SHA256;
+            digest_bytes = SHA256_DIGEST_BYTES;
+        }
+        else if ((info.algorithm == "$3" || info.algorithm == "$NT") && info.salt.empty())
+        {
+            digest = RawDigest::NTLM;
+            digest_bytes = MD4_DIGEST_BYTES;
+        }
+        else
+        {
+            return false;
+        }
+        return decode_hex(info.hash, target, digest_bytes);
+    }
+
+    // What makes two targets share one hash computation per candidate. Raw
+    // digests group by digest type alone, so "$3$$" and "$NT$" NTLM share one.
+    std::string group_key(HashFamily family, const hash_info &info)
+    {
+        std::string key(1, static_cast<char>(family));
+        if (family == HashFamily::RAW)
+        {
+            RawDigest digest;
+            size_t digest_bytes;
+            uint8_t target[SHA256_DIGEST_BYTES];
+            parse_raw(info, digest, digest_bytes, target);
+            return key + static_cast<char>(digest);
+        }
+        return key + info.algorithm + "$" + info.options + "$" + info.salt;
+    }
+}
+
+HashEngine<HashFamily::CRYPT>::HashEngine(const TargetGroup &group)
+    : setting_(generate_salt_for_hash(group.info)),
+      data_(std::make_unique<crypt_data>())
+{
+    std::memset(data_.get(), 0, sizeof(crypt_data));
+    for (const auto &target : group.targets)
+        targets_.push_back(target.hash);
+}
+
+void HashEngine<HashFamily::CRYPT>::find_matches(const std::string *candidates, size_t count,
+                                                 std::vector<EngineHit> &hits)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        const char *result = crypt_r(candidates[i].c_str(), setting_.c_str(), data_.get());
+
+        // libcrypt reports failure as nullptr or a "*0"/"*1" failure token
+        if (result == nullptr || result[0] == '*')
+        {
+            throw std::runtime_error("crypt_r failed to generate hash");
+        }
+
+        for (size_t t = 0; t < targets_.size(); ++t)
+        {
+            if (std::strcmp(result, targets_[t].c_str()) == 0)
+                hits.push_back({i, t});
+        }
+    }
+}
+
+// Every prefix is hashed as $2b$: key bytes unsigned, the key cut at 72
+// bytes. $2y$ is the same. Wordlists and rules do feed 8-bit bytes and long
+// lines, where $2a$ can differ: crypt_blowfish's $2a$ alters some keys with
+// 8-bit bytes, and OpenBSD's before 5.5 wrapped key lengths past 255 bytes.
+// Such $2a$ targets are only found if their passwords avoid both.
+HashEngine<HashFamily::BCRYPT>::HashEngine(const TargetGroup &group)
+    : arena_(new BlowfishState[LANES])
+{
+    for (const auto &target : group.targets)
+    {
+        std::array<uint8_t, BCRYPT_HASH_BYTES> digest;
+        if (!parse_bcrypt(parse_hash_info(target.hash), cost_, salt_, digest.data()))
+        {
+            throw std::invalid_argument("Invalid bcrypt hash: " + target.hash);
+        }
+        targets_.push_back(digest);
+    }
+    batch_ = cost_ >= BCRYPT_NARROW_COST ? BCRYPT_NARROW_LANES : LANES;
+}
+
+void HashEngine<HashFamily::BCRYPT>::find_matches(const std::string *candidates, size_t count,
+                                                  std::vector<EngineHit> &hits)
+{
+    const char *keys[LANES] = {};
+    size_t key_lens[LANES] = {};
+    for (size_t i = 0; i < count; ++i)
+    {
+        keys[i] = candidates[i].data();
+        key_lens[i] = candidates[i].size();
+    }
+
+    uint8_t digests[LANES][BCRYPT_HASH_BYTES];
+    bcrypt_hash_lanes(arena_.get(), keys, key_lens, count, salt_, cost_, digests);
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t t = 0; t < targets_.size(); ++t)
+        {
+            if (std::memcmp(digests[i], targets_[t].data(), BCRYPT_HASH_BYTES) == 0)
+                hits.push_back({i, t});
+        }
+    }
+}
+
+HashEngine<HashFamily::YESCRYPT>::HashEngine(const TargetGroup &group)
+{
+    for (const auto &target : group.targets)
+    {
+        std::array<uint8_t, YESCRYPT_HASH_BYTES> digest;
+        if (!parse_yescrypt(parse_hash_info(target.hash), params_, salt_, digest.data()))
+        {
+            throw std::invalid_argument("Invalid yescrypt hash: " + target.hash);
+        }
+        targets_.push_back(digest);
+    }
+}
+
+void HashEngine<HashFamily::YESCRYPT>::find_matches(const std::string *candidates, size_t count,
+                                                    std::vector<EngineHit> &hits)
+{
+    auto arena = arena_acquire(yescrypt_arena_bytes(params_));
+    for (size_t i = 0; i < count; ++i)
+    {
+        uint8_t digest[YESCRYPT_HASH_BYTES];
+        yescrypt_hash(params_, reinterpret_cast<const uint8_t *>(candidates[i].data()), candidates[i].size(),
+                      salt_.data(), salt_.size(), arena->data(), digest);
+        for (size_t t = 0; t < targets_.size(); ++t)
+        {
+            if (std::memcmp(digest, targets_[t].data(), YESCRYPT_HASH_BYTES) == 0)
+                hits.push_back({i, t});
+        }
+    }
+}
+
+HashEngine<HashFamily::MD5CRYPT>::HashEngine(const TargetGroup &group)
+    : salt_(group.info.salt)
+{
+    for (const auto &target : group.targets)
+    {
+        auto info = parse_hash_info(target.hash);
+        if (!is_md5crypt(info))
+        {
+            throw std::invalid_argument("Invalid md5crypt hash: " + target.hash);
+        }
+        std::array<char, MD5CRYPT_HASH_CHARS> encoded;
+        std::memcpy(encoded.data(), info.hash.data(), MD5CRYPT_HASH_CHARS);
+        targets_.push_back(encoded);
+    }
+}
+
+void HashEngine<HashFamily::MD5CRYPT>::find_matches(const std::string *candidates, size_t count,
+                                                    std::vector<EngineHit> &hits)
+{
+    char encoded[LANES][MD5CRYPT_HASH_CHARS];
+    md5crypt_lanes(candidates, count, salt_, encoded);
+    for (size_t i = 0; i < count; ++i)
+    {
+        for (size_t t = 0; t < targets_.size(); ++t)
+        {
+            if (std::memcmp(encoded[i], targets_[t].data(), MD5CRYPT_HASH_CHARS) == 0)
+                hits.push_back({i, t});
+        }
+    }
+}
+
+HashEngine<HashFamily::RAW>::HashEngine(const TargetGroup &group)
+    : targets_(group.digests)
+{
+    uint8_t digest[SHA256_DIGEST_BYTES];
+    if (!targets_ || !parse_raw(group.info, digest_, digest_bytes_, digest))
+    {
+        throw std::invalid_argument("Invalid raw hash: " + group.info.full_hash);
+    }
+}
+
+void HashEngine<HashFamily::RAW>::find_matches(const std::string *candidates, size_t count,
+                                               std::vector<EngineHit> &hits)
+{
+    const uint8_t *msgs[LANES] = {};
+    size_t lens[LANES] = {};
+    for (size_t i = 0; i < count; ++i)
+    {
+        const std::string *msg = &candidates[i];
+        if (digest_ == RawDigest::NTLM)
+        {
+            // UTF-16LE of each byte zero-extended, i.e. the candidate read as
+            // Latin-1 (hashcat's default), not decoded from UTF-8: a wordlist
+            // word with multi-byte UTF-8 only matches if it was hashed that way
+            wide_[i].assign(candidates[i].size() * 2, '\0');
+            for (size_t c = 0; c < candidates[i].size(); ++c)
+                wide_[i][2 * c] = candidates[i][c];
+            msg = &wide_[i];
+        }
+        msgs[i] = reinterpret_cast<const uint8_t *>(msg->data());
+        lens[i] = msg->size();
+    }
+
+    uint8_t digests[LANES * SHA256_DIGEST_BYTES];
+    switch (digest_)
+    {
+    case RawDigest::MD5:
+        md5_lanes(msgs, lens, count, digests);
+        break;
+    case RawDigest::SHA1:
+        sha1_lanes(msgs, lens, count, digests);
+        break;
+    case RawDigest::SHA256:
+        sha256_lanes(msgs, lens, count, digests);
+        break;
+    case RawDigest::NTLM:
+        md4_lanes(msgs, lens, count, digests);
+        break;
+    }
+
+    // Issue every lane's filter load before testing any, so large filters
+    // cost one overlapped cache miss per batch rather than one per lane
+    for (size_t i = 0; i < count; ++i)
+        targets_->prefetch(digests + i * digest_bytes_);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const uint8_t *digest = digests + i * digest_bytes_;
+        if (!targets_->maybe_contains(digest))
+            continue;
+        auto range = targets_->find(digest);
+        for (size_t pos = range.first; pos < range.second; ++pos)
+            hits.push_back({i, targets_->target(pos)});
+    }
+}
+
+EngineSet::EngineSet(const std::vector<TargetGroup> &groups)
+{
+    engines_.reserve(groups.size());
+    for (const auto &group : groups)
+    {
+        switch (group.family)
+        {
+        case HashFamily::CRYPT:
+            engines_.emplace_back(std::in_place_type<HashEngine<HashFamily::CRYPT>>, group);
+            break;
+        case HashFamily::BCRYPT:
+            engines_.emplace_back(std::in_place_type<HashEngine<HashFamily::BCRYPT>>, group);
+            break;
+        case HashFamily::YESCRYPT:
+            engines_.emplace_back(std::in_place_type<HashEngine<HashFamily::YESCRYPT>>, group);
+            break;
+        case HashFamily::MD5CRYPT:
+            engines_.emplace_back(std::in_place_type<HashEngine<HashFamily::MD5CRYPT>>, group);
+            break;
+        case HashFamily::RAW:
+            engines_.emplace_back(std::in_place_type<HashEngine<HashFamily::RAW>>, group);
+            break;
+        }
+        std::visit([&](auto &engine) { batch_ = std::max(batch_, engine.batch_size()); }, engines_.back());
+    }
+}
+
+void EngineSet::find_matches(const std::string *candidates, size_t count, const CrackState &state,
+                             std::vector<GroupHit> &hits)
+{
+    for (size_t g = 0; g < engines_.size(); ++g)
+    {
+        if (state.group_done(g))
+            continue;
+        std::visit([&](auto &engine) {
+            // Feed the shared batch in the engine's own lane-group size
+            const size_t step = engine.batch_size();
+            for (size_t off = 0; off < count; off += step)
+            {
+                scratch_.clear();
+                engine.find_matches(candidates + off, std::min(step, count - off), scratch_);
+                for (const auto &hit : scratch_)
+                    hits.push_back({off + hit.candidate, g, hit.target});
+            }
+        }, engines_[g]);
+    }
+}
+
+std::vector<TargetGroup> group_targets(std::vector<std::string> hashes, const std::vector<uint32_t> &ids)
+{
+    std::vector<TargetGroup> groups;
+    std::unordered_map<std::string, size_t> index;
+    std::unordered_map<size_t, std::vector<uint8_t>> raw_digests;
+    for (size_t i = 0; i < hashes.size(); ++i)
+    {
+        auto info = parse_hash_info(hashes[i]);
+        auto family = resolve_hash_family(info);
+        auto [it, inserted] = index.emplace(group_key(family, info), groups.size());
+        auto &group = inserted ? groups.emplace_back(TargetGroup{family, info, {}, nullptr}) : groups[it->second];
+        if (family == HashFamily::RAW)
+        {
+            RawDigest digest;
+            size_t digest_bytes;
+            uint8_t target[SHA256_DIGEST_BYTES];
+            parse_raw(info, digest, digest_bytes, target);
+            auto &digests = raw_digests[it->second];
+            digests.insert(digests.end(), target, target + digest_bytes);
+            group.targets.push_back({std::string(), ids[i]});
+        }
+        else
+        {
+            group.targets.push_back({std::move(hashes[i]), ids[i]});
+        }
+    }
+
+    for (auto &[g, digests] : raw_digests)
+    {
+        size_t digest_bytes = digests.size() / groups[g].targets.size();
+        groups[g].digests = std::make_shared<const DigestSet>(digest_bytes, std::move(digests));
+    }
+    return groups;
+}
+
+CrackState::CrackState(const std::vector<TargetGroup> &groups)
+    : group_left_(new std::atomic<size_t>[groups.size()]), left_(0)
+{
+    for (size_t g = 0; g < groups.size(); ++g)
+    {
+        first_.push_back(left_);
+        group_left_[g].store(groups[g].targets.size());
+        left_ += groups[g].targets.size();
+    }
+    cracked_.reset(new std::atomic<bool>[left_.load()]);
+    for (size_t i = 0; i < left_.load(); ++i)
+        cracked_[i].store(false);
+}
+
+bool CrackState::claim(size_t group, size_t target)
+{
+    if (cracked_[first_[group] + target].exchange(true))
+        return false;
+    group_left_[group].fetch_sub(1);
+    left_.fetch_sub(1);
+    return true;
+}
+
+HashFamily resolve_hash_family(const hash_info &info)
+{
+    if (is_bcrypt(info))
+    {
+        unsigned cost;
+        uint8_t salt[BCRYPT_SALT_BYTES], digest[BCRYPT_HASH_BYTES];
+        if (parse_bcrypt(info, cost, salt, digest))
+            return HashFamily::BCRYPT;
+    }
+    if (is_yescrypt(info))
+    {
+        YescryptParams params;
+        std::vector<uint8_t> salt;
+        uint8_t digest[YESCRYPT_HASH_BYTES];
+        if (parse_yescrypt(info, params, salt, digest))
+            return HashFamily::YESCRYPT;
+    }
+    if (is_md5crypt(info))
+        return HashFamily::MD5CRYPT;
+    {
+        RawDigest digest;
+        size_t digest_bytes;
+        uint8_t target[SHA256_DIGEST_BYTES];
+        if (parse_raw(info, digest, digest_bytes, target))
+            return HashFamily::RAW;
+    }
+    return HashFamily::CRYPT;
+}
+
+const char *hash_family_name(HashFamily family)
+{
+    switch (family)
+    {
+    case HashFamily::CRYPT:
+        return "crypt";
+    case HashFamily::BCRYPT:
+        return "bcrypt";
+    case HashFamily::YESCRYPT:
+        return "yescrypt";
+    case HashFamily::MD5CRYPT:
+        return "md5crypt";
+    case HashFamily::RAW:
+        return "raw";
+    }
+    return "unknown";
+}
+
+size_t hash_memory_per_thread(const std::vector<TargetGroup> &groups)
+{
+    // Engines of one thread run one at a time, so the largest arena decides
+    size_t bytes = 0;
+    for (const auto &group : groups)
+    {
+        if (group.family != HashFamily::YESCRYPT)
+            continue;
+
+        YescryptParams params;
+        std::vector<uint8_t> salt;
+        uint8_t digest[YESCRYPT_HASH_BYTES];
+        if (parse_yescrypt(group.info, params, salt, digest))
+            bytes = std::max(bytes, yescrypt_arena_bytes(params));
+    }
+    return bytes;
+}
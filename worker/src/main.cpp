@@ -1,10 +1,33 @@
 #include <memory>
 #include <atomic>
 #include <thread>
+#include <array>
+#include <chrono>
+#include <poll.h>
+#include <signal.h>
+#include <cerrno>
 
 #include "parse_args.h"
 #include "network.h"
 #include "worker.h"
+#include "hash_engine.h"
+#include "trace.h"
+#include "candidates.h"
+#include "checkpoint_board.h"
+#include "calibrate.h"
+#include "cpu_topology.h"
+
+namespace
+{
+    // SIGTERM (a preemptible node about to go): stop at the next batch, hand
+    // every lease back at its exact position and leave
+    std::atomic<bool> drain_requested(false);
+
+    void request_drain(int)
+    {
+        drain_requested.store(true);
+    }
+}
 
 int main(int argc, char *argv[])
 {
@@ -16,18 +39,75 @@ int main(int argc, char *argv[])
     }
     print_args(args);
 
+    // No SA_RESTART: a blocking recv between leases returns so we can leave
+    struct sigaction drain_action{};
+    drain_action.sa_handler = request_drain;
+    sigemptyset(&drain_action.sa_mask);
+    sigaction(SIGTERM, &drain_action, nullptr);
+
+    if (!args.trace_path.empty())
+    {
+        trace_open(args.trace_path);
+    }
+
     try
     {
+        // A controller on this machine takes checkpoints from shared memory
+        std::unique_ptr<CheckpointBoard> board;
+        if (!args.server_path.empty())
+        {
+            board = CheckpointBoard::create(getpid());
+        }
+        bool use_board = false;
+        bool queue = false;     // the controller has other jobs for us once these targets are cracked
+
         auto sockfd = connect_to_server(args);
         std::cout << "Connected to server, waiting for CONACK.\n";
 
-        auto password_found = std::make_shared<std::atomic<bool>>(false);
-        auto shared_hash_info = std::make_shared<hash_info>();
+        // Same id the controller derives from the accepted peer address
+        auto endpoint = local_endpoint(sockfd);
+        auto trace_id = trace_conn_id(endpoint);
+        trace_name_process(trace_id, "worker " + endpoint);
+        trace_name_thread(trace_id, TRACE_TID_WORKER_NET, "worker network");
+        // --threads auto pins thread i to placement[i] and runs at most one per CPU
+        const auto &placement = cpu_topology().order;
+        const int max_threads =
+            args.auto_threads ? std::min(static_cast<int>(placement.size()), MAX_AUTO_THREADS) : args.threads;
+        for (int t = 0; t < max_threads; ++t)
+        {
+            trace_name_thread(trace_id, TRACE_TID_WORKER_HASH + t, "worker thread " + std::to_string(t));
+        }
+
+        auto job_done = std::make_shared<std::atomic<bool>>(false);
+        Wakeup threads_done;    // the last hashing thread of a lease or lane run has exited
+        std::vector<std::string> hashes;
+        std::vector<uint32_t> hash_ids;
+        std::vector<TargetGroup> groups;
+        std::shared_ptr<CrackState> crack_state;
+        Attack attack;
+        int threads = args.threads;
+        std::vector<std::string> lanes;     // strided lanes received so far
+        std::string more_work;              // WORKMORE tokens of the WORK to come
 
-        while (!password_found->load(std::memory_order_relaxed))
+        bool drained = false;
+        while (!job_done->load(std::memory_order_relaxed))
         {
+            if (drain_requested.load())
+            {
+                // Leases are handed back by now; say we are done and go
+                if (send_drain(sockfd, DEFAULT_RETRIES, 0, "") != 0)
+                {
+                    std::cerr << "Failed to send DRAIN to server.\n";
+                }
+                drained = true;
+                break;
+            }
             std::vector<uint8_t> buffer;
             ssize_t ret = recv_full_packet(sockfd, buffer); // could do: add server timeout
+            if (ret <= 0 && drain_requested.load())
+            {
+                continue; // interrupted between leases
+            }
             if (ret <= 0)
             {
                 close(sockfd);
@@ -42,18 +122,91 @@ int main(int argc, char *argv[])
 
             switch (packet.header.flags)
             {
+            case TARGETS:
+            {
+                uint32_t id = header_target_id(packet.header);
+                std::istringstream lines(std::string(packet.payload.begin(), packet.payload.end()));
+                std::string line;
+                while (std::getline(lines, line))
+                {
+                    hashes.push_back(line);
+                    hash_ids.push_back(id++);
+                }
+                continue; // the target list ends with CONACK; no WORKREQ until then
+            }
             case CONACK:
+            {
                 std::cout << "Received CONACK from server.\n";
-                *shared_hash_info = parse_hash_info(std::string(packet.payload.begin(), packet.payload.end()));
-                print_hash_info(*shared_hash_info);
+                queue = packet.header.work_size == 1;
+                trace_instant("CONACK received", trace_id, TRACE_TID_WORKER_NET);
+                std::cout << "Targets: " << hashes.size();
+                groups = group_targets(std::move(hashes), hash_ids);
+                crack_state = std::make_shared<CrackState>(groups);
+                std::cout << " in " << groups.size() << " salt group(s)\n";
+                for (const auto &group : groups)
+                {
+                    std::cout << "  " << hash_family_name(group.family) << ": " << group.targets.size()
+                              << " x " << group.info.full_hash << "\n";
+                }
+                if (groups.size() == 1 && groups.front().targets.size() == 1)
+                {
+                    print_hash_info(groups.front().info);
+                }
+                hashes.clear();
+                hash_ids.clear();
+                use_board = board && board->attached();
+                if (use_board)
+                {
+                    std::cout << "Checkpoints go through shared memory.\n";
+                }
+
+                attack.configure(std::string(packet.payload.begin(), packet.payload.end()),
+                                 {args.wordlist, args.rules, args.markov, args.combine});
+
+                threads = max_threads;
+                size_t per_thread = hash_memory_per_thread(groups);
+                // The last job's arenas this one can't use are freed; the
+                // ones it can use are memory it already has
+                const size_t pooled = arena_trim(per_thread);
+                // 0 if MemAvailable can't be read, which says nothing about the memory
+                const size_t available = available_memory_bytes();
+                if (per_thread && available == 0)
+                {
+                    std::cout << "Available memory unknown; threads not capped for memory\n";
+                }
+                else if (per_thread)
+                {
+                    // Keep a tenth of available memory free; arenas are mapped in whole huge pages
+                    per_thread = (per_thread + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+                    size_t fit = (available / 10 * 9 + pooled) / per_thread;
+                    if (fit < static_cast<size_t>(threads))
+                    {
+                        threads = fit > 0 ? static_cast<int>(fit) : 1;
+                        std::cout << "Capping threads to " << threads << " (" << per_thread / (1024 * 1024)
+                                  << " MB per thread)\n";
+                    }
+                }
+                if (args.auto_threads)
+                {
+                    threads = calibrate_threads(groups, threads);
+                    std::cout << "Threads: " << threads << "\n";
+                }
                 break;
+            }
+            case WORKMORE:
+            {
+                more_work.append(packet.payload.begin(), packet.payload.end());
+                more_work.push_back(' ');
+                continue; // the rest of the lease comes with WORK
+            }
             case WORK:
             {
                 std::cout << "Received WORK packet from server.\n";
 
-                std::string payload_str(packet.payload.begin(), packet.payload.end());
+                std::string payload_str = more_work + std::string(packet.payload.begin(), packet.payload.end());
+                more_work.clear();
 
-                auto total_work_done = std::make_shared<std::atomic<uint16_t>>(0);
+                auto total_work_done = std::make_shared<std::atomic<uint32_t>>(0);
                 auto work_completed = std::make_shared<std::atomic<bool>>(false);
 
                 std::vector<std::string> prefixes;
@@ -72,39 +225,164 @@ int main(int argc, char *argv[])
                     std::cout << "[" << p << "] ";
                 }
                 std::cout << "\n";
+                trace_instant("lease received", trace_id, TRACE_TID_WORKER_NET, payload_str);
+
+                // Per-lease stop flags (CANCEL) and the threads still hashing
+                std::unique_ptr<std::atomic<bool>[]> cancelled(new std::atomic<bool>[prefixes.size()]());
+                std::atomic<size_t> running(prefixes.size());
+                threads_done.drain(); // left by a run that ended while we were not polling
 
                 std::vector<std::thread> thread_pool;
                 thread_pool.reserve(prefixes.size());
-                for (int i = 0; i < prefixes.size(); ++i)
+                for (size_t i = 0; i < prefixes.size(); ++i)
                 {
                     thread_pool.emplace_back([&, i]()
                                              {
-                        int work_done = 0;
-                        auto starter = prefixes[i];
-                        do {
-                            auto generated_hash = generate_hash(starter, *shared_hash_info);
-                            if (generated_hash == shared_hash_info->full_hash) {
-                                std::cout << "Password found by thread " << i << ": " << starter << std::endl;
-                                password_found->store(true, std::memory_order_relaxed);
-                                if (send_pwdfind(sockfd, DEFAULT_RETRIES, starter) != 0) {
+                        struct Exit {
+                            std::atomic<size_t> &running;
+                            Wakeup &wake;
+                            ~Exit() {
+                                if (running.fetch_sub(1) == 1)
+                                    wake.notify(); // the last one out ends the network thread's wait
+                            }
+                        } exit{running, threads_done};
+                        if (args.auto_threads) {
+                            pin_current_thread(placement[i % placement.size()]);
+                        }
+                        EngineSet engines(groups);
+                        CandidateSource source(attack.mode(), prefixes[i], attack.inputs());
+                        std::array<std::string, MAX_ENGINE_LANES> batch;
+                        std::vector<GroupHit> hits;
+                        const size_t batch_size = engines.batch_size();
+                        size_t work_done = 0;
+                        const uint32_t trace_tid = TRACE_TID_WORKER_HASH + i;
+                        const uint64_t hash_start_us = trace_now_us();
+                        while (!work_completed->load(std::memory_order_relaxed) && !job_done->load(std::memory_order_relaxed) &&
+                               !cancelled[i].load(std::memory_order_relaxed) && !drain_requested.load(std::memory_order_relaxed)) {
+                            size_t count = source.fill(batch.data(), batch_size);
+                            if (count == 0) {
+                                break;
+                            }
+                            hits.clear();
+                            engines.find_matches(batch.data(), count, *crack_state, hits);
+                            for (const auto &hit : hits) {
+                                if (!crack_state->claim(hit.group, hit.target)) {
+                                    continue;
+                                }
+                                const auto &found = batch[hit.candidate];
+                                const auto &target = groups[hit.group].targets[hit.target];
+                                std::cout << "Password found by thread " << i << ": " << found
+                                          << " (target " << target.id << ")" << std::endl;
+                                if (send_pwdfind(sockfd, DEFAULT_RETRIES, target.id, found) != 0) {
                                     std::cerr << "Failed to send PWDFIND to server.\n";
                                 }
+                                trace_instant("PWDFND sent", trace_id, trace_tid, found);
+                            }
+                            if (crack_state->remaining() == 0) {
+                                if (queue) {
+                                    // Another job follows: end the leases as usual
+                                    work_completed->store(true, std::memory_order_relaxed);
+                                    break;
+                                }
+                                job_done->store(true, std::memory_order_relaxed);
+                                trace_span("hashing", trace_id, trace_tid, hash_start_us, trace_now_us(),
+                                           prefixes[i] + " -> all targets cracked");
                                 return;
                             }
-                            generate_combination(starter);
-                            ++work_done;
-                            if (work_done % packet.header.checkpoint_interval == 0) {
-                                std::cout << "Thread " << i << " checkpoint: " << work_done << ". Candidate: " << starter << "\n";
-                                if (send_check(sockfd, DEFAULT_RETRIES, work_done, packet.header.work_size, starter) != 0) {
+                            work_done += count;
+                            if (work_done / packet.header.checkpoint_interval !=
+                                (work_done - count) / packet.header.checkpoint_interval) {
+                                auto position = source.position();
+                                std::cout << "Thread " << i << " checkpoint: " << work_done << ". Candidate: " << position << "\n";
+                                const auto done = static_cast<uint32_t>(std::min<size_t>(work_done, UINT32_MAX));
+                                if (use_board) {
+                                    board->write(i, done, position);
+                                } else if (send_check(sockfd, DEFAULT_RETRIES, done, position) != 0) {
                                     std::cerr << "Failed to send CHECK to server.\n";
                                 }
+                                trace_instant("checkpoint sent", trace_id, trace_tid, position);
+                            }
+                            update_total_work_done(total_work_done, count, packet.header.work_size, work_completed);
+                        }
+                        auto starter = source.position();
+                        if (drain_requested.load()) {
+                            // Exact, unlike the last checkpoint: nothing is hashed twice
+                            std::cout << "Thread " << i << " drained at " << starter << "\n";
+                            const auto done = static_cast<uint32_t>(std::min<size_t>(work_done, UINT32_MAX));
+                            if (send_drain(sockfd, DEFAULT_RETRIES, done, starter) != 0) {
+                                std::cerr << "Failed to send DRAIN to server.\n";
                             }
-                            update_total_work_done(total_work_done, packet.header.work_size, work_completed);
-                        } while (!work_completed->load(std::memory_order_relaxed) && !password_found->load(std::memory_order_relaxed));
-                        std::cout << "Thread " << i << " finished.\n";
+                            trace_span("hashing", trace_id, trace_tid, hash_start_us, trace_now_us(),
+                                       prefixes[i] + " -> drained at " + starter);
+                            return;
+                        }
+                        std::cout << "Thread " << i << (cancelled[i].load() ? " cancelled.\n" : " finished.\n");
+                        trace_span("hashing", trace_id, trace_tid, hash_start_us, trace_now_us(),
+                                   prefixes[i] + " -> " + starter);
                         if(send_workfin(sockfd, DEFAULT_RETRIES, starter) != 0) {
                             std::cerr << "Failed to send WORKFIN to server.\n";
-                        } });
+                        }
+                        trace_instant("WORKFIN sent", trace_id, trace_tid, starter); });
+                }
+
+                // Keep reading while the threads hash: the controller cancels
+                // a lease whose backup copy finished first, or ends the job
+                bool killed = false, lost = false;
+                while (running.load() > 0 && !lost && !killed)
+                {
+                    pollfd ready[] = {{sockfd, POLLIN, 0}, {threads_done.fd(), POLLIN, 0}};
+                    if (poll(ready, 2, LEASE_POLL_MS) <= 0)
+                        continue;
+                    if (ready[1].revents)
+                        threads_done.drain();
+                    if (!ready[0].revents)
+                        continue;
+                    std::vector<uint8_t> message;
+                    Packet control;
+                    const ssize_t got = recv_full_packet(sockfd, message);
+                    if (got < 0 && errno == EINTR && drain_requested.load())
+                    {
+                        continue; // SIGTERM before a byte of the packet: the threads drain
+                    }
+                    if (got <= 0 || deserialize(message.data(), message.size(), control) != 0)
+                    {
+                        lost = true;
+                        job_done->store(true, std::memory_order_relaxed);
+                        break;
+                    }
+                    if (control.header.flags == KILL)
+                    {
+                        std::cout << "Received KILL packet from server. Stopping.\n";
+                        trace_instant("KILL received", trace_id, TRACE_TID_WORKER_NET);
+                        killed = true;
+                        job_done->store(true, std::memory_order_relaxed);
+                    }
+                    else if (control.header.flags == HEARTBEAT)
+                    {
+                        if (send_heartbeat(sockfd, DEFAULT_RETRIES, control.payload) != 0)
+                        {
+                            std::cerr << "Failed to answer HEARTBEAT.\n";
+                        }
+                    }
+                    else if (control.header.flags == CANCEL)
+                    {
+                        std::string cancel(control.payload.begin(), control.payload.end());
+                        RangeToken target, lease;
+                        for (size_t i = 0; i < prefixes.size(); ++i)
+                        {
+                            if (parse_range(cancel, target) && parse_range(prefixes[i], lease) &&
+                                target.end == lease.end && target.inner_end == lease.inner_end)
+                            {
+                                std::cout << "Lease " << prefixes[i] << " cancelled: another worker finished it\n";
+                                trace_instant("CANCEL received", trace_id, TRACE_TID_WORKER_NET, cancel);
+                                cancelled[i].store(true, std::memory_order_relaxed);
+                            }
+                        }
+                    }
+                    else
+                    {
+                        std::cout << "Received unexpected packet with flag: " << static_cast<int>(control.header.flags) << "\n";
+                    }
                 }
 
                 for (auto &t : thread_pool)
@@ -112,31 +390,292 @@ int main(int argc, char *argv[])
                     if (t.joinable())
                         t.join();
                 }
+                if (lost)
+                {
+                    close(sockfd);
+                    throw std::runtime_error("Received error or connection closed");
+                }
+                if (killed)
+                {
+                    continue; // nothing more to ask for
+                }
+                break;
+            }
+            case STRIDE:
+            {
+                // --strided: lanes instead of leases, run until they are done
+                // or the controller asks for them back to deal them again
+                uint16_t generation = packet.header.work_size;
+                std::istringstream tokens(std::string(packet.payload.begin(), packet.payload.end()));
+                std::string token;
+                while (tokens >> token)
+                {
+                    lanes.push_back(token);
+                }
+                if (packet.header.checkpoint_interval > 0)
+                {
+                    continue; // more lanes follow
+                }
+                if (lanes.empty())
+                {
+                    // Asked to stop between runs: there is nothing to report
+                    if (send_stride(sockfd, DEFAULT_RETRIES, generation, true, {}) != 0)
+                    {
+                        std::cerr << "Failed to send STRIDE to server.\n";
+                    }
+                    continue;
+                }
+
+                bool lost = false, killed = false, synced = false;
+                while (!lanes.empty() && !lost && !killed && !job_done->load(std::memory_order_relaxed) &&
+                       !drain_requested.load())
+                {
+                    std::vector<std::string> run;
+                    run.swap(lanes);
+                    synced = false;
+                    std::vector<RangeToken> starts(run.size());
+                    for (size_t i = 0; i < run.size(); ++i)
+                    {
+                        if (!parse_range(run[i], starts[i]))
+                        {
+                            close(sockfd);
+                            throw std::runtime_error("Bad strided lane: " + run[i]);
+                        }
+                    }
+                    std::cout << "Running " << run.size() << " strided lanes (generation " << generation << ")\n";
+                    trace_instant("lanes received", trace_id, TRACE_TID_WORKER_NET, std::to_string(run.size()));
+
+                    // Lanes are taken in turn; each one's cursor is where the
+                    // controller resumes it
+                    std::unique_ptr<std::atomic<uint64_t>[]> cursors(new std::atomic<uint64_t>[run.size()]);
+                    for (size_t i = 0; i < run.size(); ++i)
+                    {
+                        cursors[i].store(starts[i].cursor);
+                    }
+                    std::atomic<size_t> next_lane(0);
+                    std::atomic<bool> stop(false);
+                    const size_t pool_size = std::min(run.size(), static_cast<size_t>(threads));
+                    std::atomic<size_t> running(pool_size);
+                    threads_done.drain(); // left by a run that ended while we were not polling
+
+                    std::vector<std::thread> thread_pool;
+                    thread_pool.reserve(pool_size);
+                    for (size_t t = 0; t < pool_size; ++t)
+                    {
+                        thread_pool.emplace_back([&, t]()
+                                                 {
+                        struct Exit {
+                            std::atomic<size_t> &running;
+                            Wakeup &wake;
+                            ~Exit() {
+                                if (running.fetch_sub(1) == 1)
+                                    wake.notify(); // the last one out ends the network thread's wait
+                            }
+                        } exit{running, threads_done};
+                        if (args.auto_threads) {
+                            pin_current_thread(placement[t % placement.size()]);
+                        }
+                        EngineSet engines(groups);
+                        std::array<std::string, MAX_ENGINE_LANES> batch;
+                        std::vector<GroupHit> hits;
+                        const size_t batch_size = engines.batch_size();
+                        const uint32_t trace_tid = TRACE_TID_WORKER_HASH + t;
+                        for (size_t lane; !stop.load(std::memory_order_relaxed) && !job_done->load(std::memory_order_relaxed) &&
+                                          !drain_requested.load(std::memory_order_relaxed) &&
+                                          (lane = next_lane.fetch_add(1)) < run.size();) {
+                            CandidateSource source(attack.mode(), run[lane], attack.inputs());
+                            const uint64_t hash_start_us = trace_now_us();
+                            uint64_t visited = 0;
+                            while (!stop.load(std::memory_order_relaxed) && !job_done->load(std::memory_order_relaxed) &&
+                                   !drain_requested.load(std::memory_order_relaxed)) {
+                                size_t count = source.fill(batch.data(), batch_size);
+                                if (count == 0) {
+                                    break;
+                                }
+                                hits.clear();
+                                engines.find_matches(batch.data(), count, *crack_state, hits);
+                                for (const auto &hit : hits) {
+                                    if (!crack_state->claim(hit.group, hit.target)) {
+                                        continue;
+                                    }
+                                    const auto &found = batch[hit.candidate];
+                                    const auto &target = groups[hit.group].targets[hit.target];
+                                    std::cout << "Password found by thread " << t << ": " << found
+                                              << " (target " << target.id << ")" << std::endl;
+                                    if (send_pwdfind(sockfd, DEFAULT_RETRIES, target.id, found) != 0) {
+                                        std::cerr << "Failed to send PWDFIND to server.\n";
+                                    }
+                                    trace_instant("PWDFND sent", trace_id, trace_tid, found);
+                                }
+                                if (crack_state->remaining() == 0) {
+                                    job_done->store(true, std::memory_order_relaxed);
+                                    break;
+                                }
+                                visited += count;
+                                cursors[lane].store(starts[lane].cursor + visited * starts[lane].stride,
+                                                    std::memory_order_relaxed);
+                            }
+                            trace_span("hashing", trace_id, trace_tid, hash_start_us, trace_now_us(),
+                                       run[lane] + " -> " + source.position());
+                        } });
+                    }
+
+                    auto positions = [&]()
+                    {
+                        std::vector<std::string> reported(run.size());
+                        for (size_t i = 0; i < run.size(); ++i)
+                        {
+                            RangeToken position = starts[i];
+                            position.cursor = cursors[i].load(std::memory_order_relaxed);
+                            reported[i] = format_range(position);
+                        }
+                        return reported;
+                    };
+
+                    // The network thread reports progress now and then and
+                    // waits for KILL or the controller's request to stop
+                    auto last_report = std::chrono::steady_clock::now();
+                    bool complete = true;       // the lanes received meanwhile are all here
+                    uint16_t next_generation = generation;
+                    while (running.load() > 0 && !lost && !killed)
+                    {
+                        if (std::chrono::steady_clock::now() - last_report >= std::chrono::seconds(STRIDE_REPORT_SEC))
+                        {
+                            if (send_stride(sockfd, DEFAULT_RETRIES, generation, false, positions()) != 0)
+                            {
+                                std::cerr << "Failed to send STRIDE to server.\n";
+                            }
+                            last_report = std::chrono::steady_clock::now();
+                        }
+                        pollfd ready[] = {{sockfd, POLLIN, 0}, {threads_done.fd(), POLLIN, 0}};
+                        if (poll(ready, 2, LEASE_POLL_MS) <= 0)
+                            continue;
+                        if (ready[1].revents)
+                            threads_done.drain();
+                        if (!ready[0].revents)
+                            continue;
+                        std::vector<uint8_t> message;
+                        Packet control;
+                        const ssize_t got = recv_full_packet(sockfd, message);
+                        if (got < 0 && errno == EINTR && drain_requested.load())
+                        {
+                            continue; // SIGTERM before a byte of the packet: the threads drain
+                        }
+                        if (got <= 0 || deserialize(message.data(), message.size(), control) != 0)
+                        {
+                            lost = true;
+                            job_done->store(true, std::memory_order_relaxed);
+                            break;
+                        }
+                        if (control.header.flags == KILL)
+                        {
+                            std::cout << "Received KILL packet from server. Stopping.\n";
+                            trace_instant("KILL received", trace_id, TRACE_TID_WORKER_NET);
+                            killed = true;
+                            job_done->store(true, std::memory_order_relaxed);
+                        }
+                        else if (control.header.flags == HEARTBEAT)
+                        {
+                            if (send_heartbeat(sockfd, DEFAULT_RETRIES, control.payload) != 0)
+                            {
+                                std::cerr << "Failed to answer HEARTBEAT.\n";
+                            }
+                        }
+                        else if (control.header.flags == STRIDE)
+                        {
+                            std::istringstream dealt(std::string(control.payload.begin(), control.payload.end()));
+                            while (dealt >> token)
+                            {
+                                lanes.push_back(token);
+                            }
+                            next_generation = control.header.work_size;
+                            complete = control.header.checkpoint_interval == 0;
+                            synced = true;
+                            stop.store(true, std::memory_order_relaxed);
+                        }
+                        else
+                        {
+                            std::cout << "Received unexpected packet with flag: " << static_cast<int>(control.header.flags) << "\n";
+                        }
+                    }
+
+                    for (auto &t : thread_pool)
+                    {
+                        if (t.joinable())
+                            t.join();
+                    }
+                    if (lost)
+                    {
+                        close(sockfd);
+                        throw std::runtime_error("Received error or connection closed");
+                    }
+                    if (killed || job_done->load(std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                    std::cout << (drain_requested.load() ? "Strided lanes drained.\n"
+                                  : synced                 ? "Strided lanes stopped for a new deal.\n"
+                                                           : "Strided lanes finished.\n");
+                    if (send_stride(sockfd, DEFAULT_RETRIES, generation, true, positions()) != 0)
+                    {
+                        std::cerr << "Failed to send STRIDE to server.\n";
+                    }
+                    generation = next_generation;
+                    if (!complete)
+                    {
+                        break; // the rest of the new lanes are still on the way
+                    }
+                }
+                if (synced || killed)
+                {
+                    continue; // the next deal says what to do
+                }
                 break;
             }
+            case CANCEL:
+                continue; // the lease already ended; its WORKFIN crossed the CANCEL
+            case HEARTBEAT:
+                // Between leases; while hashing, the WORK loop answers
+                if (send_heartbeat(sockfd, DEFAULT_RETRIES, packet.payload) != 0)
+                {
+                    std::cerr << "Failed to answer HEARTBEAT.\n";
+                }
+                continue;
             case KILL:
                 std::cout << "Received KILL packet from server. Exiting.\n";
-                password_found->store(true, std::memory_order_relaxed);
-                break;
+                trace_instant("KILL received", trace_id, TRACE_TID_WORKER_NET);
+                job_done->store(true, std::memory_order_relaxed);
+                continue; // nothing more to ask for
             default:
                 std::cout << "Received unexpected packet with flag: " << static_cast<int>(packet.header.flags) << "\n";
                 break;
             }
 
-            if (send_workreq(sockfd, DEFAULT_RETRIES, args.threads) < 0)
+            if (job_done->load(std::memory_order_relaxed) || drain_requested.load())
+            {
+                continue; // every target cracked during this lease, or leaving
+            }
+            if (send_workreq(sockfd, DEFAULT_RETRIES, threads) < 0)
             {
                 close(sockfd);
                 throw std::runtime_error("Failed to send WORKREQ to server");
             }
             std::cout << "Sent WORKREQ to server.\n";
+            trace_instant("WORKREQ sent", trace_id, TRACE_TID_WORKER_NET);
         }
 
         close(sockfd);
+        if (drained)
+        {
+            std::cout << "Drained: leases handed back to the controller.\n";
+        }
+        trace_close();
         return 0;
     }
     catch (const std::exception &e)
     {
         std::cerr << "Error: " << e.what() << "\n";
+        trace_close();
         return -1;
     }
 }
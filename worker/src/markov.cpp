@@ -0,0 +1,36 @@
+#include "markov.h"
+#include "mask.h"
+
+MarkovModel::MarkovModel(const Wordlist &corpus)
+    : position_(MAX_MASK_LEN), follow_(256)
+{
+    for (auto &counts : position_)
+        counts.fill(0);
+    for (auto &counts : follow_)
+        counts.fill(0);
+
+    uint64_t offset = 0;
+    std::string word;
+    while (next_word(corpus, offset, corpus.size(), word))
+    {
+        ++words_;
+        const size_t len = std::min(word.size(), MAX_MASK_LEN);
+        for (size_t pos = 0; pos < len; ++pos)
+        {
+            const auto c = static_cast<unsigned char>(word[pos]);
+            ++position_[pos][c];
+            if (pos > 0)
+                ++follow_[static_cast<unsigned char>(word[pos - 1])][c];
+        }
+    }
+}
+
+uint64_t MarkovModel::position_count(size_t pos, unsigned char c) const
+{
+    return pos < position_.size() ? position_[pos][c] : 0;
+}
+
+uint64_t MarkovModel::follow_count(unsigned char prev, unsigned char c) const
+{
+    return follow_[prev][c];
+}
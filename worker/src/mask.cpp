@@ -0,0 +1,236 @@
+#include "mask.h"
+#include "markov.h"
+#include "password.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+    const char *builtin_charset(char name)
+    {
+        switch (name)
+        {
+        case 'l': return CHARSET_LOWER;
+        case 'u': return CHARSET_UPPER;
+        case 'd': return CHARSET_DIGIT;
+        case 's': return CHARSET_SPECIAL;
+        case 'h': return CHARSET_HEX_LOWER;
+        case 'H': return CHARSET_HEX_UPPER;
+        default: return nullptr;
+        }
+    }
+
+    // Appends the characters not already in out, keeping first-seen order
+    void add_unique(std::string &out, const std::string &chars)
+    {
+        for (char c : chars)
+            if (out.find(c) == std::string::npos)
+                out.push_back(c);
+    }
+
+    // The charset named by "?x" (custom may be null while expanding a custom charset)
+    std::string placeholder(char name, const std::array<std::string, MASK_CUSTOM_CHARSETS> *custom)
+    {
+        if (name == '?')
+            return "?";
+        if (name == 'a')
+            return std::string(CHARSET_LOWER) + CHARSET_UPPER + CHARSET_DIGIT + CHARSET_SPECIAL;
+        if (const char *set = builtin_charset(name))
+            return set;
+        if (custom && name >= '1' && name < static_cast<char>('1' + MASK_CUSTOM_CHARSETS))
+        {
+            const auto &set = (*custom)[name - '1'];
+            if (set.empty())
+                throw std::invalid_argument(std::string("Mask uses ?") + name + " but it is not defined");
+            return set;
+        }
+        throw std::invalid_argument(std::string("Unknown mask placeholder ?") + name);
+    }
+
+    std::string expand_custom(const std::string &spec)
+    {
+        std::string out;
+        for (size_t i = 0; i < spec.size(); ++i)
+        {
+            if (spec[i] != '?')
+            {
+                add_unique(out, std::string(1, spec[i]));
+                continue;
+            }
+            if (++i == spec.size())
+                throw std::invalid_argument("Custom charset ends in '?'");
+            add_unique(out, placeholder(spec[i], nullptr));
+        }
+        return out;
+    }
+}
+
+Mask::Mask(const std::string &mask, const std::array<std::string, MASK_CUSTOM_CHARSETS> &custom)
+{
+    std::array<std::string, MASK_CUSTOM_CHARSETS> sets;
+    for (size_t i = 0; i < MASK_CUSTOM_CHARSETS; ++i)
+        sets[i] = expand_custom(custom[i]);
+
+    for (size_t i = 0; i < mask.size(); ++i)
+    {
+        if (mask[i] != '?')
+        {
+            positions_.emplace_back(1, mask[i]);
+        }
+        else
+        {
+            if (++i == mask.size())
+                throw std::invalid_argument("Mask ends in '?'");
+            std::string set;
+            add_unique(set, placeholder(mask[i], &sets));
+            positions_.push_back(set);
+        }
+        if (positions_.size() > MAX_MASK_LEN)
+            throw std::invalid_argument("Mask is longer than " + std::to_string(MAX_MASK_LEN) + " positions");
+        if (keyspace_ > UINT64_MAX / positions_.back().size())
+            throw std::invalid_argument("Mask keyspace does not fit in 64 bits");
+        keyspace_ *= positions_.back().size();
+    }
+    if (positions_.empty())
+        throw std::invalid_argument("Mask is empty");
+}
+
+void Mask::reorder(const MarkovModel &model)
+{
+    auto by_count = [](std::string &set, auto count) {
+        std::stable_sort(set.begin(), set.end(), [&](char a, char b) {
+            return count(static_cast<unsigned char>(a)) > count(static_cast<unsigned char>(b));
+        });
+    };
+
+    const size_t len = positions_.size();
+    by_count(positions_[0], [&](unsigned char c) { return model.position_count(0, c); });
+    after_.assign(len, {});
+    for (size_t pos = 1; pos < len; ++pos)
+    {
+        std::string base = positions_[pos];
+        by_count(base, [&](unsigned char c) { return model.position_count(pos, c); });
+        for (char prev : positions_[pos - 1])
+        {
+            auto &set = after_[pos][static_cast<unsigned char>(prev)];
+            set = base;
+            by_count(set, [&](unsigned char c) { return model.follow_count(static_cast<unsigned char>(prev), c); });
+        }
+    }
+
+    // ways_[pos][t] = sum of ways_[pos + 1][t - d] over the position's digits,
+    // as a sliding window. Counts never exceed the keyspace, so no overflow.
+    max_level_.assign(len + 1, 0);
+    for (size_t pos = len; pos-- > 0;)
+        max_level_[pos] = max_level_[pos + 1] + static_cast<uint32_t>(positions_[pos].size() - 1);
+    ways_.assign(len + 1, {});
+    ways_[len] = {1};
+    for (size_t pos = len; pos-- > 0;)
+    {
+        const auto &after = ways_[pos + 1];
+        const size_t radix = positions_[pos].size();
+        auto &ways = ways_[pos];
+        ways.assign(max_level_[pos] + 1, 0);
+        uint64_t window = 0;
+        for (size_t t = 0; t < ways.size(); ++t)
+        {
+            if (t < after.size())
+                window += after[t];
+            if (t >= radix && t - radix < after.size())
+                window -= after[t - radix];
+            ways[t] = window;
+        }
+    }
+    level_start_.assign(ways_[0].size() + 1, 0);
+    for (size_t level = 0; level < ways_[0].size(); ++level)
+        level_start_[level + 1] = level_start_[level] + ways_[0][level];
+}
+
+void Mask::fill_level(size_t pos, uint32_t level, std::vector<uint8_t> &digits) const
+{
+    for (; pos < positions_.size(); ++pos)
+    {
+        // As small as the rest of the suffix allows
+        const uint32_t digit = level > max_level_[pos + 1] ? level - max_level_[pos + 1] : 0;
+        digits[pos] = static_cast<uint8_t>(digit);
+        level -= digit;
+    }
+}
+
+void Mask::spell(size_t pos, std::string &candidate, const std::vector<uint8_t> &digits) const
+{
+    for (; pos < positions_.size(); ++pos)
+        candidate[pos] = charset(pos, pos > 0 ? candidate[pos - 1] : 0)[digits[pos]];
+}
+
+void Mask::decode(uint64_t index, std::string &candidate, std::vector<uint8_t> &digits) const
+{
+    const size_t len = positions_.size();
+    candidate.resize(len);
+    digits.resize(len);
+    if (level_start_.empty())
+    {
+        for (size_t pos = len; pos-- > 0;)
+        {
+            const size_t radix = positions_[pos].size();
+            digits[pos] = static_cast<uint8_t>(index % radix);
+            index /= radix;
+        }
+    }
+    else
+    {
+        auto next_level = std::upper_bound(level_start_.begin(), level_start_.end(), index);
+        size_t level = static_cast<size_t>(next_level - level_start_.begin()) - 1;
+        index -= level_start_[level];
+        // Skip over the candidates with a smaller digit at each position
+        for (size_t pos = 0; pos < len; ++pos)
+        {
+            const auto &after = ways_[pos + 1];
+            size_t digit = level > max_level_[pos + 1] ? level - max_level_[pos + 1] : 0;
+            while (index >= after[level - digit])
+            {
+                index -= after[level - digit];
+                ++digit;
+            }
+            digits[pos] = static_cast<uint8_t>(digit);
+            level -= digit;
+        }
+    }
+    spell(0, candidate, digits);
+}
+
+void Mask::next(std::string &candidate, std::vector<uint8_t> &digits) const
+{
+    const size_t len = positions_.size();
+    if (level_start_.empty())
+    {
+        size_t pos = len;
+        while (pos-- > 0)
+        {
+            if (++digits[pos] < positions_[pos].size())
+                break;
+            digits[pos] = 0;
+        }
+        spell(pos == SIZE_MAX ? 0 : pos, candidate, digits);
+        return;
+    }
+
+    // Next in the level: raise the rightmost digit that can still move one
+    // unit of level out of the suffix after it, and make that suffix smallest
+    uint32_t suffix = digits[len - 1];
+    for (size_t pos = len - 1; pos-- > 0;)
+    {
+        if (suffix > 0 && digits[pos] + 1u < positions_[pos].size())
+        {
+            ++digits[pos];
+            fill_level(pos + 1, suffix - 1, digits);
+            spell(pos, candidate, digits);
+            return;
+        }
+        suffix += digits[pos];
+    }
+    // First of the next level (wrapping after the last)
+    fill_level(0, suffix < max_level_[0] ? suffix + 1 : 0, digits);
+    spell(0, candidate, digits);
+}
@@ -0,0 +1,93 @@
+#include "md5crypt.h"
+
+#include <cstdint>
+
+namespace
+{
+    const char ITOA64[] = "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    const char MAGIC[] = "$1$";
+
+    void to64(char *&dst, uint32_t v, int chars)
+    {
+        while (chars-- > 0)
+        {
+            *dst++ = ITOA64[v & 0x3f];
+            v >>= 6;
+        }
+    }
+
+    void encode(const uint8_t f[MD5_DIGEST_BYTES], char *dst)
+    {
+        to64(dst, (uint32_t(f[0]) << 16) | (uint32_t(f[6]) << 8) | f[12], 4);
+        to64(dst, (uint32_t(f[1]) << 16) | (uint32_t(f[7]) << 8) | f[13], 4);
+        to64(dst, (uint32_t(f[2]) << 16) | (uint32_t(f[8]) << 8) | f[14], 4);
+        to64(dst, (uint32_t(f[3]) << 16) | (uint32_t(f[9]) << 8) | f[15], 4);
+        to64(dst, (uint32_t(f[4]) << 16) | (uint32_t(f[10]) << 8) | f[5], 4);
+        to64(dst, f[11], 2);
+    }
+}
+
+void md5crypt_lanes(const std::string *passwords, size_t count, const std::string &salt,
+                    char out[][MD5CRYPT_HASH_CHARS])
+{
+    std::string msgs[MB_LANES];
+    const uint8_t *ptrs[MB_LANES] = {};
+    size_t lens[MB_LANES] = {};
+    uint8_t digests[MB_LANES][MD5_DIGEST_BYTES];
+
+    auto run = [&]() {
+        for (size_t i = 0; i < count; ++i)
+        {
+            ptrs[i] = reinterpret_cast<const uint8_t *>(msgs[i].data());
+            lens[i] = msgs[i].size();
+        }
+        md5_lanes(ptrs, lens, count, &digests[0][0]);
+    };
+
+    // Alternate sum: MD5(pw salt pw)
+    for (size_t i = 0; i < count; ++i)
+        msgs[i] = passwords[i] + salt + passwords[i];
+    run();
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        const std::string &pw = passwords[i];
+        std::string &m = msgs[i];
+        m = pw + MAGIC + salt;
+        for (size_t left = pw.size(); left > 0; left -= left > 16 ? 16 : left)
+            m.append(reinterpret_cast<const char *>(digests[i]), left > 16 ? 16 : left);
+        for (size_t bits = pw.size(); bits; bits >>= 1)
+            m += (bits & 1) ? '\0' : pw[0];
+    }
+    run();
+
+    const char *digest_chars[MB_LANES];
+    for (size_t i = 0; i < count; ++i)
+        digest_chars[i] = reinterpret_cast<const char *>(digests[i]);
+
+    for (int round = 0; round < 1000; ++round)
+    {
+        for (size_t i = 0; i < count; ++i)
+        {
+            const std::string &pw = passwords[i];
+            std::string &m = msgs[i];
+            m.clear();
+            if (round & 1)
+                m += pw;
+            else
+                m.append(digest_chars[i], MD5_DIGEST_BYTES);
+            if (round % 3)
+                m += salt;
+            if (round % 7)
+                m += pw;
+            if (round & 1)
+                m.append(digest_chars[i], MD5_DIGEST_BYTES);
+            else
+                m += pw;
+        }
+        run();
+    }
+
+    for (size_t i = 0; i < count; ++i)
+        encode(digests[i], out[i]);
+}
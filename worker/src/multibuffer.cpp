@@ -0,0 +1,388 @@
+#include "multibuffer.h"
+
+#include <cstring>
+
+namespace
+{
+    using LaneWords = uint32_t[MB_LANES];
+
+    // One word of every lane; GCC/Clang lower arithmetic on it to SIMD
+    // registers of whatever width the target has
+    typedef uint32_t Vec __attribute__((vector_size(MB_LANES * sizeof(uint32_t))));
+
+// Macros rather than functions: passing vectors wider than the baseline
+// SIMD registers by value is an ABI hazard GCC warns about
+#define MB_LOAD(v, w) std::memcpy(&(v), (w), sizeof(Vec))
+#define MB_ADD_STORE(w, v)                    \
+    do                                        \
+    {                                         \
+        Vec sum_;                             \
+        std::memcpy(&sum_, (w), sizeof(Vec)); \
+        sum_ += (v);                          \
+        std::memcpy((w), &sum_, sizeof(Vec)); \
+    } while (0)
+#define MB_ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+#define MB_ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+    constexpr uint32_t MD5_K[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391};
+
+    constexpr int MD5_S[4][4] = {{7, 12, 17, 22}, {5, 9, 14, 20}, {4, 11, 16, 23}, {6, 10, 15, 21}};
+
+    constexpr int MD4_ORDER[3][16] = {
+        {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+        {0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15},
+        {0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15}};
+    constexpr int MD4_S[3][4] = {{3, 7, 11, 19}, {3, 5, 9, 13}, {3, 9, 11, 15}};
+    constexpr uint32_t MD4_K[3] = {0x00000000, 0x5a827999, 0x6ed9eba1};
+
+    // The step loops are fully unrolled so round selection, message indices
+    // and rotate counts all become constants and the registers stay in SIMD
+    // registers instead of being shuffled through memory.
+    struct Md4
+    {
+        static constexpr size_t STATE_WORDS = 4;
+        static constexpr size_t DIGEST_BYTES = MD4_DIGEST_BYTES;
+        static constexpr bool BIG_ENDIAN_WORDS = false;
+        static constexpr uint32_t INIT[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+        static void compress(LaneWords state[4], const LaneWords block[16])
+        {
+            Vec m[16];
+            for (int i = 0; i < 16; ++i)
+                MB_LOAD(m[i], block[i]);
+            Vec a, b, c, d;
+            MB_LOAD(a, state[0]);
+            MB_LOAD(b, state[1]);
+            MB_LOAD(c, state[2]);
+            MB_LOAD(d, state[3]);
+
+#pragma GCC unroll 48
+            for (int i = 0; i < 48; ++i)
+            {
+                const int round = i / 16;
+                Vec f;
+                if (round == 0)
+                    f = (b & c) | (~b & d);
+                else if (round == 1)
+                    f = (b & c) | (b & d) | (c & d);
+                else
+                    f = b ^ c ^ d;
+                Vec t = MB_ROTL(a + f + m[MD4_ORDER[round][i % 16]] + MD4_K[round], MD4_S[round][i % 4]);
+                a = d;
+                d = c;
+                c = b;
+                b = t;
+            }
+
+            MB_ADD_STORE(state[0], a);
+            MB_ADD_STORE(state[1], b);
+            MB_ADD_STORE(state[2], c);
+            MB_ADD_STORE(state[3], d);
+        }
+    };
+
+    struct Md5
+    {
+        static constexpr size_t STATE_WORDS = 4;
+        static constexpr size_t DIGEST_BYTES = MD5_DIGEST_BYTES;
+        static constexpr bool BIG_ENDIAN_WORDS = false;
+        static constexpr uint32_t INIT[4] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476};
+
+        static void compress(LaneWords state[4], const LaneWords block[16])
+        {
+            Vec m[16];
+            for (int i = 0; i < 16; ++i)
+                MB_LOAD(m[i], block[i]);
+            Vec a, b, c, d;
+            MB_LOAD(a, state[0]);
+            MB_LOAD(b, state[1]);
+            MB_LOAD(c, state[2]);
+            MB_LOAD(d, state[3]);
+
+#pragma GCC unroll 64
+            for (int i = 0; i < 64; ++i)
+            {
+                const int round = i / 16;
+                Vec f;
+                int k;
+                if (round == 0)
+                {
+                    f = (b & c) | (~b & d);
+                    k = i;
+                }
+                else if (round == 1)
+                {
+                    f = (d & b) | (~d & c);
+                    k = (5 * i + 1) % 16;
+                }
+                else if (round == 2)
+                {
+                    f = b ^ c ^ d;
+                    k = (3 * i + 5) % 16;
+                }
+                else
+                {
+                    f = c ^ (b | ~d);
+                    k = (7 * i) % 16;
+                }
+                Vec t = b + MB_ROTL(a + f + m[k] + MD5_K[i], MD5_S[round][i % 4]);
+                a = d;
+                d = c;
+                c = b;
+                b = t;
+            }
+
+            MB_ADD_STORE(state[0], a);
+            MB_ADD_STORE(state[1], b);
+            MB_ADD_STORE(state[2], c);
+            MB_ADD_STORE(state[3], d);
+        }
+    };
+
+    struct Sha1
+    {
+        static constexpr size_t STATE_WORDS = 5;
+        static constexpr size_t DIGEST_BYTES = SHA1_DIGEST_BYTES;
+        static constexpr bool BIG_ENDIAN_WORDS = true;
+        static constexpr uint32_t INIT[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+
+        static void compress(LaneWords state[5], const LaneWords block[16])
+        {
+            Vec w[16];
+            for (int i = 0; i < 16; ++i)
+                MB_LOAD(w[i], block[i]);
+            Vec a, b, c, d, e;
+            MB_LOAD(a, state[0]);
+            MB_LOAD(b, state[1]);
+            MB_LOAD(c, state[2]);
+            MB_LOAD(d, state[3]);
+            MB_LOAD(e, state[4]);
+
+#pragma GCC unroll 80
+            for (int i = 0; i < 80; ++i)
+            {
+                // Message schedule kept as a 16-word ring
+                if (i >= 16)
+                    w[i % 16] = MB_ROTL(w[(i - 3) % 16] ^ w[(i - 8) % 16] ^ w[(i - 14) % 16] ^ w[i % 16], 1);
+
+                const int round = i / 20;
+                Vec f;
+                uint32_t K;
+                if (round == 0)
+                {
+                    f = (b & c) | (~b & d);
+                    K = 0x5a827999;
+                }
+                else if (round == 1)
+                {
+                    f = b ^ c ^ d;
+                    K = 0x6ed9eba1;
+                }
+                else if (round == 2)
+                {
+                    f = (b & c) | (b & d) | (c & d);
+                    K = 0x8f1bbcdc;
+                }
+                else
+                {
+                    f = b ^ c ^ d;
+                    K = 0xca62c1d6;
+                }
+                Vec t = MB_ROTL(a, 5) + f + e + K + w[i % 16];
+                e = d;
+                d = c;
+                c = MB_ROTL(b, 30);
+                b = a;
+                a = t;
+            }
+
+            MB_ADD_STORE(state[0], a);
+            MB_ADD_STORE(state[1], b);
+            MB_ADD_STORE(state[2], c);
+            MB_ADD_STORE(state[3], d);
+            MB_ADD_STORE(state[4], e);
+        }
+    };
+
+    struct Sha256
+    {
+        static constexpr size_t STATE_WORDS = 8;
+        static constexpr size_t DIGEST_BYTES = SHA256_DIGEST_BYTES;
+        static constexpr bool BIG_ENDIAN_WORDS = true;
+        static inline const uint32_t *const INIT = SHA256_H0;
+
+        static void compress(LaneWords state[8], const LaneWords block[16])
+        {
+            Vec w[16];
+            for (int i = 0; i < 16; ++i)
+                MB_LOAD(w[i], block[i]);
+            Vec a, b, c, d, e, f, g, h;
+            MB_LOAD(a, state[0]);
+            MB_LOAD(b, state[1]);
+            MB_LOAD(c, state[2]);
+            MB_LOAD(d, state[3]);
+            MB_LOAD(e, state[4]);
+            MB_LOAD(f, state[5]);
+            MB_LOAD(g, state[6]);
+            MB_LOAD(h, state[7]);
+
+#pragma GCC unroll 64
+            for (int i = 0; i < 64; ++i)
+            {
+                if (i >= 16)
+                {
+                    Vec w15 = w[(i - 15) % 16], w2 = w[(i - 2) % 16];
+                    Vec s0 = MB_ROTR(w15, 7) ^ MB_ROTR(w15, 18) ^ (w15 >> 3);
+                    Vec s1 = MB_ROTR(w2, 17) ^ MB_ROTR(w2, 19) ^ (w2 >> 10);
+                    w[i % 16] += s0 + w[(i - 7) % 16] + s1;
+                }
+
+                Vec t1 = h + (MB_ROTR(e, 6) ^ MB_ROTR(e, 11) ^ MB_ROTR(e, 25)) + ((e & f) ^ (~e & g)) +
+                         SHA256_K[i] + w[i % 16];
+                Vec t2 = (MB_ROTR(a, 2) ^ MB_ROTR(a, 13) ^ MB_ROTR(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+                h = g;
+                g = f;
+                f = e;
+                e = d + t1;
+                d = c;
+                c = b;
+                b = a;
+                a = t1 + t2;
+            }
+
+            MB_ADD_STORE(state[0], a);
+            MB_ADD_STORE(state[1], b);
+            MB_ADD_STORE(state[2], c);
+            MB_ADD_STORE(state[3], d);
+            MB_ADD_STORE(state[4], e);
+            MB_ADD_STORE(state[5], f);
+            MB_ADD_STORE(state[6], g);
+            MB_ADD_STORE(state[7], h);
+        }
+    };
+
+    inline size_t padded_blocks(size_t len)
+    {
+        return (len + 8) / 64 + 1;
+    }
+
+    // Loads block `block` of the MD-padded message into one lane's column.
+    // Works word-wise so short candidates cost O(length), not O(64).
+    template <bool BigEndian>
+    void load_block(const uint8_t *msg, size_t len, size_t block, size_t nblocks,
+                    LaneWords words[16], size_t lane)
+    {
+        const size_t off = block * 64;
+        const size_t end = len < off + 64 ? len : off + 64;
+        auto shift = [](size_t i) { return BigEndian ? 24 - 8 * (i % 4) : 8 * (i % 4); };
+
+        size_t i = 0;
+        for (; off + i + 4 <= end; i += 4)
+        {
+            const uint8_t *p = msg + off + i;
+            words[i / 4][lane] = BigEndian
+                                     ? (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3]
+                                     : (uint32_t(p[3]) << 24) | (uint32_t(p[2]) << 16) | (uint32_t(p[1]) << 8) | p[0];
+        }
+        if (i < 64)
+        {
+            // Partial word holding the tail and/or the 0x80 terminator
+            uint32_t w = 0;
+            for (; off + i < end; ++i)
+                w |= uint32_t(msg[off + i]) << shift(i);
+            if (len >= off && len < off + 64)
+                w |= uint32_t(0x80) << shift(len - off);
+            words[i / 4][lane] = w;
+            for (size_t j = i / 4 + 1; j < 16; ++j)
+                words[j][lane] = 0;
+        }
+
+        if (block == nblocks - 1)
+        {
+            const uint64_t bits = static_cast<uint64_t>(len) * 8;
+            words[BigEndian ? 15 : 14][lane] = static_cast<uint32_t>(bits);
+            words[BigEndian ? 14 : 15][lane] = static_cast<uint32_t>(bits >> 32);
+        }
+    }
+
+    template <typename Algo>
+    void hash_lanes(const uint8_t *const *msgs, const size_t *lens, size_t count, uint8_t *out)
+    {
+        size_t pending[MB_LANES];
+        for (size_t i = 0; i < count; ++i)
+            pending[i] = i;
+
+        size_t remaining = count;
+        while (remaining > 0)
+        {
+            // Gather every lane with the same block count as the first one
+            const size_t nblocks = padded_blocks(lens[pending[0]]);
+            size_t group[MB_LANES];
+            size_t grouped = 0, rest = 0;
+            for (size_t k = 0; k < remaining; ++k)
+            {
+                if (padded_blocks(lens[pending[k]]) == nblocks)
+                    group[grouped++] = pending[k];
+                else
+                    pending[rest++] = pending[k];
+            }
+            remaining = rest;
+
+            LaneWords state[Algo::STATE_WORDS];
+            for (size_t j = 0; j < Algo::STATE_WORDS; ++j)
+                for (size_t l = 0; l < MB_LANES; ++l)
+                    state[j][l] = Algo::INIT[j];
+
+            // Idle lanes recompute the group's first message
+            LaneWords block[16];
+            for (size_t b = 0; b < nblocks; ++b)
+            {
+                for (size_t l = 0; l < MB_LANES; ++l)
+                {
+                    const size_t idx = group[l < grouped ? l : 0];
+                    load_block<Algo::BIG_ENDIAN_WORDS>(msgs[idx], lens[idx], b, nblocks, block, l);
+                }
+                Algo::compress(state, block);
+            }
+
+            for (size_t g = 0; g < grouped; ++g)
+            {
+                uint8_t *dst = out + group[g] * Algo::DIGEST_BYTES;
+                for (size_t j = 0; j < Algo::DIGEST_BYTES / 4; ++j)
+                {
+                    const uint32_t v = state[j][g];
+                    for (int i = 0; i < 4; ++i)
+                        dst[4 * j + i] = static_cast<uint8_t>(v >> (Algo::BIG_ENDIAN_WORDS ? 24 - 8 * i : 8 * i));
+                }
+            }
+        }
+    }
+}
+
+void md4_lanes(const uint8_t *const *msgs, const size_t *lens, size_t count, uint8_t *out)
+{
+    hash_lanes<Md4>(msgs, lens, count, out);
+}
+
+void md5_lanes(const uint8_t *const *msgs, const size_t *lens, size_t count, uint8_t *out)
+{
+    hash_lanes<Md5>(msgs, lens, count, out);
+}
+
+void sha1_lanes(const uint8_t *const *msgs, const size_t *lens, size_t count, uint8_t *out)
+{
+    hash_lanes<Sha1>(msgs, lens, count, out);
+}
+
+void sha256_lanes(const uint8_t *const *msgs, const size_t *lens, size_t count, uint8_t *out)
+{
+    hash_lanes<Sha256>(msgs, lens, count, out);
+}
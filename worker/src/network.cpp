@@ -1,9 +1,32 @@
 #include "network.h"
 
+#include <sys/eventfd.h>
+#include <sys/un.h>
+
+#include <cerrno>
+
 std::mutex send_mutex;
 
 int connect_to_server(const Args &args)
 {
+    if (!args.server_path.empty())
+    {
+        auto sockfd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (sockfd < 0)
+        {
+            throw std::runtime_error("Failed to create socket");
+        }
+        sockaddr_un server_addr{};
+        server_addr.sun_family = AF_UNIX;
+        std::strncpy(server_addr.sun_path, args.server_path.c_str(), sizeof(server_addr.sun_path) - 1);
+        if (connect(sockfd, (sockaddr *)&server_addr, sizeof(server_addr)) < 0)
+        {
+            close(sockfd);
+            throw std::runtime_error("Failed to connect to server at " + args.server_path);
+        }
+        return sockfd;
+    }
+
     auto sockfd = socket(AF_INET, SOCK_STREAM, 0);
     if (sockfd < 0)
     {
@@ -29,6 +52,24 @@ int connect_to_server(const Args &args)
     return sockfd;
 }
 
+std::string local_endpoint(int fd)
+{
+    sockaddr_in addr{};
+    socklen_t len = sizeof(addr);
+    if (getsockname(fd, (sockaddr *)&addr, &len) < 0)
+    {
+        return "";
+    }
+    if (addr.sin_family == AF_UNIX)
+    {
+        // The controller knows a local worker by its pid
+        return "unix:" + std::to_string(getpid());
+    }
+    char ip[INET_ADDRSTRLEN] = {0};
+    inet_ntop(AF_INET, &addr.sin_addr, ip, sizeof(ip));
+    return std::string(ip) + ":" + std::to_string(ntohs(addr.sin_port));
+}
+
 ssize_t serialize(const Packet &packet, std::vector<uint8_t> &buffer)
 {
     buffer.clear();
@@ -89,13 +130,45 @@ int deserialize(const uint8_t *buffer, size_t len, Packet &result)
     return 0;
 }
 
+Wakeup::Wakeup() : fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+{
+    if (fd_ < 0)
+    {
+        throw std::runtime_error("Error creating eventfd");
+    }
+}
+
+Wakeup::~Wakeup()
+{
+    close(fd_);
+}
+
+void Wakeup::notify()
+{
+    uint64_t one = 1;
+    // A full counter still wakes the reader, so a failed write loses nothing
+    [[maybe_unused]] auto n = ::write(fd_, &one, sizeof(one));
+}
+
+void Wakeup::drain()
+{
+    uint64_t count;
+    while (::read(fd_, &count, sizeof(count)) > 0)
+    {
+    }
+}
+
 ssize_t threadsafe_send_all(int fd, const uint8_t *data, size_t len)
 {
     std::lock_guard<std::mutex> lock(send_mutex);
     ssize_t total_sent = 0;
     while (total_sent < len)
     {
-        ssize_t sent = ::send(fd, data + total_sent, len - total_sent, 0);
+        ssize_t sent = ::send(fd, data + total_sent, len - total_sent, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+        {
+            continue; // SIGTERM landed on this thread; the rest of the packet still goes
+        }
         if (sent <= 0)
         {
             return -1; 
@@ -111,7 +184,15 @@ ssize_t recv_all(int fd, uint8_t *buffer, size_t len)
     while (total_received < len)
     {
         ssize_t received = ::recv(fd, buffer + total_received, len - total_received, 0);
-        if (received <= 0)
+        if (received < 0 && errno == EINTR && total_received > 0)
+        {
+            continue; // SIGTERM mid-read: returning would lose the bytes read
+        }
+        if (received == 0)
+        {
+            return 0; // connection closed
+        }
+        if (received < 0)
         {
             return -1; 
         }
@@ -141,7 +222,11 @@ ssize_t recv_full_packet(int fd, std::vector<uint8_t> &buffer)
 
     if (data_len > 0)
     {
-        n = recv_all(fd, buffer.data() + HEADER_SIZE, data_len);
+        // The header is in, so a signal now must not tear the packet
+        do
+        {
+            n = recv_all(fd, buffer.data() + HEADER_SIZE, data_len);
+        } while (n < 0 && errno == EINTR);
         if (n <= 0)
             return n; // error or connection closed
         if (static_cast<size_t>(n) != data_len)
@@ -208,12 +293,11 @@ int send_workfin(int server_fd, int retries, std::string &last_prefix)
     return -1;
 }
 
-int send_check(int server_fd, int retries, uint16_t work_done, uint16_t work_size, std::string &last_prefix)
+int send_check(int server_fd, int retries, uint32_t work_done, std::string &last_prefix)
 {
     Packet check_packet;
     check_packet.header.flags = CHECK;
-    check_packet.header.work_size = work_size;
-    check_packet.header.checkpoint_interval = work_done;
+    set_header_target_id(check_packet.header, work_done);
     check_packet.header.data_len = last_prefix.size();
 
     check_packet.payload.insert(check_packet.payload.end(),
@@ -240,10 +324,11 @@ int send_check(int server_fd, int retries, uint16_t work_done, uint16_t work_siz
     return -1;
 }
 
-int send_pwdfind(int server_fd, int retries, const std::string &found_password)
+int send_pwdfind(int server_fd, int retries, uint32_t target_id, const std::string &found_password)
 {
     Packet pwdfind_packet;
     pwdfind_packet.header.flags = PWDFND;
+    set_header_target_id(pwdfind_packet.header, target_id);
     pwdfind_packet.header.data_len = found_password.size();
     pwdfind_packet.payload.insert(pwdfind_packet.payload.end(),
                                     found_password.begin(), 
@@ -268,3 +353,104 @@ int send_pwdfind(int server_fd, int retries, const std::string &found_password)
 
     return -1;
 }
+
+int send_heartbeat(int server_fd, int retries, const std::vector<uint8_t> &echo)
+{
+    Packet heartbeat_packet;
+    heartbeat_packet.header.flags = HEARTBEAT;
+    heartbeat_packet.header.work_size = 0;
+    heartbeat_packet.header.checkpoint_interval = 0;
+    heartbeat_packet.header.data_len = echo.size();
+    heartbeat_packet.payload = echo;
+
+    std::vector<uint8_t> buffer;
+    if (serialize(heartbeat_packet, buffer) < 0)
+    {
+        std::cerr << "Failed to serialize HEARTBEAT packet.\n";
+        return -1;
+    }
+
+    for (int attempt = 0; attempt < retries; ++attempt)
+    {
+        ssize_t n = threadsafe_send_all(server_fd, buffer.data(), buffer.size());
+        if (n == static_cast<ssize_t>(buffer.size()))
+        {
+            return 0;
+        }
+        std::cerr << "Failed to send HEARTBEAT, attempt " << (attempt + 1) << "\n";
+    }
+
+    return -1;
+}
+
+int send_stride(int server_fd, int retries, uint16_t generation, bool stopped, const std::vector<std::string> &positions)
+{
+    std::vector<Packet> packets(1);
+    for (const auto &position : positions)
+    {
+        if (!packets.back().payload.empty() && packets.back().payload.size() + 1 + position.size() > MAX_PAYLOAD)
+        {
+            packets.emplace_back();
+        }
+        auto &payload = packets.back().payload;
+        if (!payload.empty())
+        {
+            payload.push_back(' ');
+        }
+        payload.insert(payload.end(), position.begin(), position.end());
+    }
+
+    for (size_t i = 0; i < packets.size(); ++i)
+    {
+        auto &stride_packet = packets[i];
+        stride_packet.header.flags = STRIDE;
+        stride_packet.header.data_len = stride_packet.payload.size();
+        stride_packet.header.work_size = generation;
+        stride_packet.header.checkpoint_interval = stopped && i + 1 == packets.size() ? 1 : 0;
+
+        std::vector<uint8_t> buffer;
+        if (serialize(stride_packet, buffer) < 0)
+        {
+            std::cerr << "Failed to serialize STRIDE packet.\n";
+            return -1;
+        }
+        int attempt = 0;
+        while (threadsafe_send_all(server_fd, buffer.data(), buffer.size()) != static_cast<ssize_t>(buffer.size()))
+        {
+            std::cerr << "Failed to send STRIDE, attempt " << (attempt + 1) << "\n";
+            if (++attempt == retries)
+            {
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+int send_drain(int server_fd, int retries, uint32_t work_done, const std::string &position)
+{
+    Packet drain_packet;
+    drain_packet.header.flags = DRAIN;
+    set_header_target_id(drain_packet.header, position.empty() ? 0 : work_done);
+    drain_packet.header.data_len = position.size();
+    drain_packet.payload.assign(position.begin(), position.end());
+
+    std::vector<uint8_t> buffer;
+    if (serialize(drain_packet, buffer) < 0)
+    {
+        std::cerr << "Failed to serialize DRAIN packet.\n";
+        return -1;
+    }
+
+    for (int attempt = 0; attempt < retries; ++attempt)
+    {
+        ssize_t n = threadsafe_send_all(server_fd, buffer.data(), buffer.size());
+        if (n == static_cast<ssize_t>(buffer.size()))
+        {
+            return 0;
+        }
+        std::cerr << "Failed to send DRAIN, attempt " << (attempt + 1) << "\n";
+    }
+
+    return -1;
+}
@@ -1,10 +1,32 @@
 #include "parse_args.h"
 
+#include <sys/un.h>
+
 void print_args(const Args &args)
 {
-    std::cout << "Server IP: " << args.serverIP << "\n";
-    std::cout << "Server Port: " << args.server_port << "\n";
-    std::cout << "Worker Thread Count: " << args.threads << "\n";
+    if (!args.server_path.empty())
+    {
+        std::cout << "Server Socket: " << args.server_path << "\n";
+    }
+    else
+    {
+        std::cout << "Server IP: " << args.serverIP << "\n";
+        std::cout << "Server Port: " << args.server_port << "\n";
+    }
+    if (args.auto_threads)
+        std::cout << "Worker Thread Count: auto\n";
+    else
+        std::cout << "Worker Thread Count: " << args.threads << "\n";
+    if (!args.trace_path.empty())
+        std::cout << "Trace File: " << args.trace_path << "\n";
+    if (!args.wordlist.empty())
+        std::cout << "Wordlist: " << args.wordlist << "\n";
+    if (!args.rules.empty())
+        std::cout << "Rules: " << args.rules << "\n";
+    if (!args.markov.empty())
+        std::cout << "Markov Corpus: " << args.markov << "\n";
+    if (!args.combine.empty())
+        std::cout << "Combine With: " << args.combine << "\n";
 }
 
 int parse_args(int argc, char *argv[], Args &args)
@@ -13,17 +35,19 @@ int parse_args(int argc, char *argv[], Args &args)
         {"server", required_argument, 0, 's'},
         {"port", required_argument, 0, 'p'},
         {"threads", required_argument, 0, 't'},
+        {"trace", required_argument, 0, 'T'},
+        {"wordlist", required_argument, 0, 'w'},
+        {"rules", required_argument, 0, 'r'},
+        {"markov", required_argument, 0, 'M'},
+        {"combine", required_argument, 0, 'C'},
         {0, 0, 0, 0}};
 
-    if (argc != 7)
-    {
-        std::cerr << "Usage: " << argv[0] << " [--server serverIP] [--port server_port] [--threads num_threads]\n";
-        return -1;
-    }
+    const std::string usage = "Usage: " + std::string(argv[0]) +
+                              " [--server serverIP | --server unix:path] [--port server_port] [--threads num_threads | --threads auto] [--trace trace.json] [--wordlist file] [--rules file] [--markov corpus] [--combine file]";
 
     int option_index = 0;
     int opt;
-    while ((opt = getopt_long(argc, argv, "s:p:t:", long_options, &option_index)) != -1)
+    while ((opt = getopt_long(argc, argv, "s:p:t:T:w:r:M:C:", long_options, &option_index)) != -1)
     {
         try
         {
@@ -35,6 +59,14 @@ int parse_args(int argc, char *argv[], Args &args)
                 {
                     throw std::invalid_argument("Server IP cannot be empty");
                 }
+                if (args.serverIP.rfind("unix:", 0) == 0)
+                {
+                    args.server_path = args.serverIP.substr(5);
+                    if (args.server_path.empty() || args.server_path.size() >= sizeof(sockaddr_un::sun_path))
+                    {
+                        throw std::invalid_argument("Unix socket path is empty or too long");
+                    }
+                }
                 break;
             case 'p':
                 args.server_port = std::stoi(optarg);
@@ -48,16 +80,55 @@ int parse_args(int argc, char *argv[], Args &args)
                 }
                 break;
             case 't':
+                if (std::string(optarg) == "auto")
+                {
+                    args.auto_threads = true;
+                    args.threads = 1; // settled at CONACK
+                    break;
+                }
                 args.threads = std::stoi(optarg);
                 if (args.threads < 1)
                 {
                     throw std::out_of_range("Number of threads must be at least 1");
                 }
                 break;
+            case 'T':
+                args.trace_path = optarg;
+                if (args.trace_path.empty())
+                {
+                    throw std::invalid_argument("Trace file path cannot be empty");
+                }
+                break;
+            case 'w':
+                args.wordlist = optarg;
+                if (args.wordlist.empty())
+                {
+                    throw std::invalid_argument("Wordlist path cannot be empty");
+                }
+                break;
+            case 'r':
+                args.rules = optarg;
+                if (args.rules.empty())
+                {
+                    throw std::invalid_argument("Rules file path cannot be empty");
+                }
+                break;
+            case 'M':
+                args.markov = optarg;
+                if (args.markov.empty())
+                {
+                    throw std::invalid_argument("Markov corpus path cannot be empty");
+                }
+                break;
+            case 'C':
+                args.combine = optarg;
+                if (args.combine.empty())
+                {
+                    throw std::invalid_argument("Combinator wordlist path cannot be empty");
+                }
+                break;
             case '?':
-                throw std::invalid_argument(
-                    "Invalid option: Usage: " + std::string(argv[0]) +
-                    " [--server serverIP] [--port server_port] [--threads num_threads]");
+                throw std::invalid_argument("Invalid option: " + usage);
             default:
                 throw std::invalid_argument("Unexpected error parsing options");
             }
@@ -69,5 +140,11 @@ int parse_args(int argc, char *argv[], Args &args)
         }
     }
 
+    if (args.serverIP.empty() || (args.server_port == 0 && args.server_path.empty()) || args.threads == 0)
+    {
+        std::cerr << usage << "\n";
+        return -1;
+    }
+
     return 0;
 }
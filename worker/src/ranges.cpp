@@ -0,0 +1,45 @@
+#include "ranges.h"
+
+#include <cstdio>
+
+std::string format_range(const RangeToken &range)
+{
+    char buf[128];
+    int n = std::snprintf(buf, sizeof(buf), "%llx:%llx", static_cast<unsigned long long>(range.cursor),
+                          static_cast<unsigned long long>(range.end));
+    if (range.inner_end > 0)
+        std::snprintf(buf + n, sizeof(buf) - n, "/%llx:%llx:%llx", static_cast<unsigned long long>(range.inner),
+                      static_cast<unsigned long long>(range.inner_begin),
+                      static_cast<unsigned long long>(range.inner_end));
+    else if (range.stride > 1)
+        std::snprintf(buf + n, sizeof(buf) - n, "*%llx", static_cast<unsigned long long>(range.stride));
+    return buf;
+}
+
+bool parse_range(const std::string &token, RangeToken &range)
+{
+    unsigned long long c = 0, e = 0;
+    unsigned long long i = 0, ib = 0, ie = 0, s = 1;
+    int used = 0;
+    if (std::sscanf(token.c_str(), "%llx:%llx%n", &c, &e, &used) != 2)
+        return false;
+    // A finished lane's cursor is its first index past the end
+    if (token[used] == '*')
+    {
+        int stride_used = 0;
+        if (std::sscanf(token.c_str() + used, "*%llx%n", &s, &stride_used) != 1 ||
+            static_cast<size_t>(used + stride_used) != token.size() || s < 2 || c >= e + s)
+            return false;
+    }
+    else if (c > e)
+        return false;
+    else if (static_cast<size_t>(used) != token.size())
+    {
+        int inner_used = 0;
+        if (std::sscanf(token.c_str() + used, "/%llx:%llx:%llx%n", &i, &ib, &ie, &inner_used) != 3 ||
+            static_cast<size_t>(used + inner_used) != token.size() || ib > i || i > ie || ie == 0)
+            return false;
+    }
+    range = {c, e, i, ib, ie, s};
+    return true;
+}
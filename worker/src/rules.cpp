@@ -0,0 +1,202 @@
+#include "rules.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+namespace
+{
+    constexpr uint8_t OP_REJECT = 0;
+
+    bool is_lower(char c) { return c >= 'a' && c <= 'z'; }
+    bool is_upper(char c) { return c >= 'A' && c <= 'Z'; }
+    char to_lower(char c) { return is_upper(c) ? c + ('a' - 'A') : c; }
+    char to_upper(char c) { return is_lower(c) ? c - ('a' - 'A') : c; }
+    char toggle(char c) { return is_lower(c) ? to_upper(c) : to_lower(c); }
+
+    // 0-9, then A-Z for 10-35
+    int position(char c)
+    {
+        if (c >= '0' && c <= '9')
+            return c - '0';
+        if (c >= 'A' && c <= 'Z')
+            return c - 'A' + 10;
+        return -1;
+    }
+
+    size_t operand_count(char op)
+    {
+        switch (op)
+        {
+        case ':': case 'l': case 'u': case 'c': case 'C': case 't':
+        case 'r': case 'd': case '[': case ']':
+            return 0;
+        case 'T': case 'D': case '\'': case '$': case '^': case '@':
+            return 1;
+        case 's':
+            return 2;
+        default:
+            return SIZE_MAX;
+        }
+    }
+
+    bool is_position_op(char op) { return op == 'T' || op == 'D' || op == '\''; }
+
+    // Appends the rule's bytecode; false if it uses anything unsupported
+    bool compile(const std::string &text, std::vector<uint8_t> &code)
+    {
+        for (size_t i = 0; i < text.size();)
+        {
+            char op = text[i++];
+            if (op == ' ' || op == '\t')
+                continue;
+            size_t operands = operand_count(op);
+            if (operands == SIZE_MAX || text.size() - i < operands)
+                return false;
+            if (op == ':')
+                continue;
+            code.push_back(static_cast<uint8_t>(op));
+            for (size_t k = 0; k < operands; ++k)
+            {
+                char arg = text[i++];
+                if (is_position_op(op))
+                {
+                    int pos = position(arg);
+                    if (pos < 0)
+                        return false;
+                    code.push_back(static_cast<uint8_t>(pos));
+                }
+                else
+                {
+                    code.push_back(static_cast<uint8_t>(arg));
+                }
+            }
+        }
+        return true;
+    }
+}
+
+RuleSet::RuleSet(const std::string &path)
+{
+    std::ifstream in(path);
+    if (!in)
+    {
+        throw std::runtime_error("Cannot open rules file " + path);
+    }
+    offsets_.push_back(0);
+    std::string line;
+    size_t line_no = 0;
+    while (std::getline(in, line))
+    {
+        ++line_no;
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.empty() || line[0] == '#')
+            continue;
+        size_t start = code_.size();
+        if (!compile(line, code_))
+        {
+            code_.resize(start);
+            code_.push_back(OP_REJECT);
+            if (invalid_++ < 10)
+                std::cerr << "Unsupported rule on line " << line_no << ": " << line << "\n";
+        }
+        offsets_.push_back(code_.size());
+    }
+}
+
+bool RuleSet::apply(size_t i, const std::string &word, std::string &out) const
+{
+    out.assign(word);
+    const uint8_t *pc = code_.data() + offsets_[i];
+    const uint8_t *end = code_.data() + offsets_[i + 1];
+    while (pc < end)
+    {
+        switch (*pc++)
+        {
+        case OP_REJECT:
+            return false;
+        case 'l':
+            for (auto &c : out)
+                c = to_lower(c);
+            break;
+        case 'u':
+            for (auto &c : out)
+                c = to_upper(c);
+            break;
+        case 'c':
+            for (auto &c : out)
+                c = to_lower(c);
+            if (!out.empty())
+                out[0] = to_upper(out[0]);
+            break;
+        case 'C':
+            for (auto &c : out)
+                c = to_upper(c);
+            if (!out.empty())
+                out[0] = to_lower(out[0]);
+            break;
+        case 't':
+            for (auto &c : out)
+                c = toggle(c);
+            break;
+        case 'T':
+            if (*pc < out.size())
+                out[*pc] = toggle(out[*pc]);
+            ++pc;
+            break;
+        case 'r':
+            std::reverse(out.begin(), out.end());
+            break;
+        case 'd':
+        {
+            size_t len = out.size();
+            if (len * 2 > MAX_RULE_WORD_LEN)
+                return false;
+            out.resize(len * 2);
+            std::copy_n(out.begin(), len, out.begin() + len);
+            break;
+        }
+        case '$':
+            if (out.size() + 1 > MAX_RULE_WORD_LEN)
+                return false;
+            out.push_back(static_cast<char>(*pc++));
+            break;
+        case '^':
+            if (out.size() + 1 > MAX_RULE_WORD_LEN)
+                return false;
+            out.insert(out.begin(), static_cast<char>(*pc++));
+            break;
+        case '[':
+            if (!out.empty())
+                out.erase(0, 1);
+            break;
+        case ']':
+            if (!out.empty())
+                out.pop_back();
+            break;
+        case 'D':
+            if (*pc < out.size())
+                out.erase(*pc, 1);
+            ++pc;
+            break;
+        case '\'':
+            if (*pc < out.size())
+                out.resize(*pc);
+            ++pc;
+            break;
+        case 's':
+            std::replace(out.begin(), out.end(), static_cast<char>(pc[0]), static_cast<char>(pc[1]));
+            pc += 2;
+            break;
+        case '@':
+            out.erase(std::remove(out.begin(), out.end(), static_cast<char>(*pc)), out.end());
+            ++pc;
+            break;
+        default:
+            return false;
+        }
+    }
+    return true; // an empty result is still a candidate, as in hashcat
+}
@@ -0,0 +1,218 @@
+#include "sha256.h"
+
+#include <cstring>
+
+const uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+const uint32_t SHA256_H0[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+
+namespace
+{
+    inline uint32_t rotr(uint32_t x, int n)
+    {
+        return (x >> n) | (x << (32 - n));
+    }
+
+    inline void store_be32(uint8_t *p, uint32_t v)
+    {
+        p[0] = v >> 24;
+        p[1] = (v >> 16) & 0xff;
+        p[2] = (v >> 8) & 0xff;
+        p[3] = v & 0xff;
+    }
+}
+
+void sha256_compress(uint32_t state[8], const uint8_t block[SHA256_BLOCK_BYTES])
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; ++i)
+    {
+        w[i] = (uint32_t(block[4 * i]) << 24) | (uint32_t(block[4 * i + 1]) << 16) |
+               (uint32_t(block[4 * i + 2]) << 8) | uint32_t(block[4 * i + 3]);
+    }
+    for (int i = 16; i < 64; ++i)
+    {
+        uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i)
+    {
+        uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) + SHA256_K[i] + w[i];
+        uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+void sha256_init(Sha256Ctx &ctx)
+{
+    std::memcpy(ctx.state, SHA256_H0, sizeof(SHA256_H0));
+    ctx.length = 0;
+    ctx.used = 0;
+}
+
+void sha256_update(Sha256Ctx &ctx, const void *data, size_t len)
+{
+    auto *in = static_cast<const uint8_t *>(data);
+    ctx.length += len;
+    if (ctx.used > 0)
+    {
+        size_t take = SHA256_BLOCK_BYTES - ctx.used;
+        if (take > len)
+            take = len;
+        std::memcpy(ctx.block + ctx.used, in, take);
+        ctx.used += take;
+        in += take;
+        len -= take;
+        if (ctx.used < SHA256_BLOCK_BYTES)
+            return;
+        sha256_compress(ctx.state, ctx.block);
+        ctx.used = 0;
+    }
+    while (len >= SHA256_BLOCK_BYTES)
+    {
+        sha256_compress(ctx.state, in);
+        in += SHA256_BLOCK_BYTES;
+        len -= SHA256_BLOCK_BYTES;
+    }
+    std::memcpy(ctx.block, in, len);
+    ctx.used = len;
+}
+
+void sha256_final(Sha256Ctx &ctx, uint8_t out[SHA256_DIGEST_BYTES])
+{
+    uint64_t bits = ctx.length * 8;
+    ctx.block[ctx.used++] = 0x80;
+    if (ctx.used > SHA256_BLOCK_BYTES - 8)
+    {
+        std::memset(ctx.block + ctx.used, 0, SHA256_BLOCK_BYTES - ctx.used);
+        sha256_compress(ctx.state, ctx.block);
+        ctx.used = 0;
+    }
+    std::memset(ctx.block + ctx.used, 0, SHA256_BLOCK_BYTES - 8 - ctx.used);
+    store_be32(ctx.block + 56, static_cast<uint32_t>(bits >> 32));
+    store_be32(ctx.block + 60, static_cast<uint32_t>(bits));
+    sha256_compress(ctx.state, ctx.block);
+    for (int i = 0; i < 8; ++i)
+        store_be32(out + 4 * i, ctx.state[i]);
+}
+
+void sha256(const void *data, size_t len, uint8_t out[SHA256_DIGEST_BYTES])
+{
+    Sha256Ctx ctx;
+    sha256_init(ctx);
+    sha256_update(ctx, data, len);
+    sha256_final(ctx, out);
+}
+
+void hmac_sha256(const void *key, size_t key_len, const void *msg, size_t msg_len,
+                 uint8_t out[SHA256_DIGEST_BYTES])
+{
+    uint8_t key_block[SHA256_BLOCK_BYTES] = {0};
+    if (key_len > SHA256_BLOCK_BYTES)
+        sha256(key, key_len, key_block);
+    else
+        std::memcpy(key_block, key, key_len);
+
+    uint8_t pad[SHA256_BLOCK_BYTES];
+    uint8_t inner[SHA256_DIGEST_BYTES];
+    Sha256Ctx ctx;
+
+    for (size_t i = 0; i < SHA256_BLOCK_BYTES; ++i)
+        pad[i] = key_block[i] ^ 0x36;
+    sha256_init(ctx);
+    sha256_update(ctx, pad, sizeof(pad));
+    sha256_update(ctx, msg, msg_len);
+    sha256_final(ctx, inner);
+
+    for (size_t i = 0; i < SHA256_BLOCK_BYTES; ++i)
+        pad[i] = key_block[i] ^ 0x5c;
+    sha256_init(ctx);
+    sha256_update(ctx, pad, sizeof(pad));
+    sha256_update(ctx, inner, sizeof(inner));
+    sha256_final(ctx, out);
+}
+
+void pbkdf2_sha256(const void *passwd, size_t passwd_len, const void *salt, size_t salt_len,
+                   uint64_t iterations, uint8_t *out, size_t out_len)
+{
+    // HMAC key pads are the same for every block, so hash them once
+    uint8_t key_block[SHA256_BLOCK_BYTES] = {0};
+    if (passwd_len > SHA256_BLOCK_BYTES)
+        sha256(passwd, passwd_len, key_block);
+    else
+        std::memcpy(key_block, passwd, passwd_len);
+
+    uint8_t pad[SHA256_BLOCK_BYTES];
+    Sha256Ctx inner_base, outer_base;
+    for (size_t i = 0; i < SHA256_BLOCK_BYTES; ++i)
+        pad[i] = key_block[i] ^ 0x36;
+    sha256_init(inner_base);
+    sha256_update(inner_base, pad, sizeof(pad));
+    for (size_t i = 0; i < SHA256_BLOCK_BYTES; ++i)
+        pad[i] = key_block[i] ^ 0x5c;
+    sha256_init(outer_base);
+    sha256_update(outer_base, pad, sizeof(pad));
+
+    Sha256Ctx salted = inner_base;
+    sha256_update(salted, salt, salt_len);
+
+    for (uint32_t block = 1; out_len > 0; ++block)
+    {
+        uint8_t counter[4];
+        store_be32(counter, block);
+
+        uint8_t u[SHA256_DIGEST_BYTES], t[SHA256_DIGEST_BYTES];
+        Sha256Ctx ctx = salted;
+        sha256_update(ctx, counter, sizeof(counter));
+        sha256_final(ctx, u);
+        ctx = outer_base;
+        sha256_update(ctx, u, sizeof(u));
+        sha256_final(ctx, u);
+        std::memcpy(t, u, sizeof(t));
+
+        for (uint64_t n = 1; n < iterations; ++n)
+        {
+            ctx = inner_base;
+            sha256_update(ctx, u, sizeof(u));
+            sha256_final(ctx, u);
+            ctx = outer_base;
+            sha256_update(ctx, u, sizeof(u));
+            sha256_final(ctx, u);
+            for (size_t i = 0; i < sizeof(t); ++i)
+                t[i] ^= u[i];
+        }
+
+        size_t take = out_len < sizeof(t) ? out_len : sizeof(t);
+        std::memcpy(out, t, take);
+        out += take;
+        out_len -= take;
+    }
+}
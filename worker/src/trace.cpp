@@ -0,0 +1,139 @@
+#include "trace.h"
+
+#include <atomic>
+#include <iostream>
+
+namespace
+{
+    std::mutex trace_mutex;
+    std::ofstream trace_file;
+    bool trace_first_event = true;
+    std::atomic<bool> trace_active{false};
+
+    std::string json_escape(const std::string &str)
+    {
+        std::string out;
+        out.reserve(str.size());
+        for (char c : str)
+        {
+            switch (c)
+            {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                    out += ' ';
+                else
+                    out += c;
+            }
+        }
+        return out;
+    }
+
+    // Caller must hold trace_mutex
+    void write_event(const std::string &event)
+    {
+        trace_file << (trace_first_event ? "[\n" : ",\n") << event;
+        trace_first_event = false;
+    }
+}
+
+bool trace_open(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    trace_file.open(path, std::ios::out | std::ios::trunc);
+    if (!trace_file)
+    {
+        std::cerr << "Failed to open trace file: " << path << "\n";
+        return false;
+    }
+    trace_first_event = true;
+    trace_active = true;
+    return true;
+}
+
+void trace_close()
+{
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    if (!trace_active)
+        return;
+    trace_file << (trace_first_event ? "[\n]\n" : "\n]\n");
+    trace_file.close();
+    trace_active = false;
+}
+
+bool trace_enabled()
+{
+    return trace_active;
+}
+
+uint64_t trace_now_us()
+{
+    // Wall clock so traces from different hosts line up when merged
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+               std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+uint32_t trace_conn_id(const std::string &endpoint)
+{
+    // FNV-1a, kept positive since viewers treat pid as a signed int
+    uint32_t h = 2166136261u;
+    for (unsigned char c : endpoint)
+    {
+        h ^= c;
+        h *= 16777619u;
+    }
+    return (h & 0x7fffffff) | 1;
+}
+
+void trace_name_process(uint32_t pid, const std::string &name)
+{
+    if (!trace_active)
+        return;
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    write_event("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" + std::to_string(pid) +
+                ",\"tid\":0,\"args\":{\"name\":\"" + json_escape(name) + "\"}}");
+}
+
+void trace_name_thread(uint32_t pid, uint32_t tid, const std::string &name)
+{
+    if (!trace_active)
+        return;
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    write_event("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" + std::to_string(pid) +
+                ",\"tid\":" + std::to_string(tid) +
+                ",\"args\":{\"name\":\"" + json_escape(name) + "\"}}");
+}
+
+void trace_instant(const std::string &name, uint32_t pid, uint32_t tid, const std::string &detail)
+{
+    if (!trace_active)
+        return;
+    auto ts = trace_now_us();
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    write_event("{\"name\":\"" + json_escape(name) + "\",\"ph\":\"i\",\"s\":\"t\",\"ts\":" +
+                std::to_string(ts) + ",\"pid\":" + std::to_string(pid) +
+                ",\"tid\":" + std::to_string(tid) +
+                ",\"args\":{\"detail\":\"" + json_escape(detail) + "\"}}");
+}
+
+void trace_span(const std::string &name, uint32_t pid, uint32_t tid,
+                uint64_t start_us, uint64_t end_us, const std::string &detail)
+{
+    if (!trace_active)
+        return;
+    auto dur = end_us > start_us ? end_us - start_us : 0;
+    std::lock_guard<std::mutex> lock(trace_mutex);
+    write_event("{\"name\":\"" + json_escape(name) + "\",\"ph\":\"X\",\"ts\":" +
+                std::to_string(start_us) + ",\"dur\":" + std::to_string(dur) +
+                ",\"pid\":" + std::to_string(pid) + ",\"tid\":" + std::to_string(tid) +
+                ",\"args\":{\"detail\":\"" + json_escape(detail) + "\"}}");
+}
@@ -0,0 +1,76 @@
+#include "wordlist.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+Wordlist::Wordlist(const std::string &path)
+{
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot open wordlist " + path + ": " + std::strerror(errno));
+    }
+    struct stat st{};
+    if (fstat(fd, &st) != 0)
+    {
+        ::close(fd);
+        throw std::runtime_error("Cannot stat wordlist " + path + ": " + std::strerror(errno));
+    }
+    size_ = static_cast<uint64_t>(st.st_size);
+    if (size_ > 0)
+    {
+        void *map = mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED)
+        {
+            ::close(fd);
+            throw std::runtime_error("Cannot map wordlist " + path + ": " + std::strerror(errno));
+        }
+        // Leases read their range front to back
+        madvise(map, size_, MADV_SEQUENTIAL);
+        data_ = static_cast<const char *>(map);
+    }
+    ::close(fd);
+}
+
+Wordlist::~Wordlist()
+{
+    if (data_)
+        munmap(const_cast<char *>(data_), size_);
+}
+
+void Wordlist::will_need(uint64_t begin, uint64_t end) const
+{
+    if (!data_ || begin >= end || begin >= size_)
+        return;
+    const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    uint64_t start = begin / page * page;
+    end = std::min(end, size_);
+    madvise(const_cast<char *>(data_) + start, end - start, MADV_WILLNEED);
+}
+
+bool next_word(const Wordlist &list, uint64_t &offset, uint64_t end, std::string &word)
+{
+    end = std::min(end, list.size());
+    while (offset < end)
+    {
+        const char *start = list.data() + offset;
+        auto nl = static_cast<const char *>(std::memchr(start, '\n', end - offset));
+        const char *stop = nl ? nl : list.data() + end;
+        offset = (stop - list.data()) + (nl ? 1 : 0);
+        while (stop > start && stop[-1] == '\r')
+            --stop;
+        if (stop > start)
+        {
+            word.assign(start, stop - start);
+            return true;
+        }
+    }
+    return false;
+}
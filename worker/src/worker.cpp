@@ -1,6 +1,26 @@
 #include "worker.h"
 
-std::mutex total_work_mutex;
+namespace
+{
+    // CHAR_SET position of every byte value, built at compile time so the
+    // candidate generator never scans CHAR_SET
+    struct CharIndexTable
+    {
+        size_t index[256];
+    };
+
+    constexpr CharIndexTable make_char_index()
+    {
+        CharIndexTable table{};
+        for (size_t i = 0; i < 256; ++i)
+            table.index[i] = (size_t)-1;
+        for (size_t i = 0; i < CHAR_SET_SIZE; ++i)
+            table.index[static_cast<unsigned char>(CHAR_SET[i])] = i;
+        return table;
+    }
+
+    constexpr CharIndexTable CHAR_INDEX = make_char_index();
+}
 
 hash_info parse_hash_info(const std::string &hash_field)
 {
@@ -14,9 +34,31 @@ hash_info parse_hash_info(const std::string &hash_field)
 
     info.full_hash = hash_field;
 
+    // Unsalted raw digests are bare hex; the length tells them apart
+    if (hash_field.find('$') == std::string::npos)
+    {
+        bool hex = hash_field.find_first_not_of("0123456789abcdefABCDEF") == std::string::npos;
+        if (hex && hash_field.size() == 32)
+            info.algorithm = "raw-md5";
+        else if (hex && hash_field.size() == 40)
+            info.algorithm = "raw-sha1";
+        else if (hex && hash_field.size() == 64)
+            info.algorithm = "raw-sha256";
+        else
+            throw std::invalid_argument("Invalid hash field: " + hash_field);
+        info.hash = hash_field;
+        return info;
+    }
+
     auto tokens = split(hash_field, '$');
 
-    if (tokens.size() == MIN_HASH_TOKENS)
+    if (tokens.size() == MIN_HASH_TOKENS - 1)
+    {
+        // Empty salt, e.g. "$1$$..." or NTLM's "$3$$..." / "$NT$..."
+        info.algorithm = "$" + tokens[0];
+        info.hash = tokens[1];
+    }
+    else if (tokens.size() == MIN_HASH_TOKENS)
     {
         info.algorithm = "$" + tokens[0];
         info.options = "";
@@ -77,22 +119,6 @@ void print_hash_info(const hash_info &info)
     std::cout << "Hash: " << info.hash << "\n";
 }
 
-std::string generate_hash(const std::string &password_candidate, const hash_info &hashData)
-{
-    struct crypt_data data;
-    data.initialized = 0;
-
-    std::string salt = generate_salt_for_hash(hashData);
-    const char *result = crypt_r(password_candidate.c_str(), salt.c_str(), &data);
-
-    if (result == nullptr || result == "*0")
-    {
-        throw std::runtime_error("crypt_r failed to generate hash");
-    }
-
-    return std::string(result);
-}
-
 std::string generate_salt_for_hash(const hash_info &hashData)
 {
     std::string salt = hashData.algorithm;
@@ -125,10 +151,7 @@ void generate_combination(std::string &starter)
     // Helper: find index of a char in CHAR_SET
     auto find_index = [&](char ch)
     {
-        for (size_t i = 0; i < CHAR_SET_SIZE; ++i)
-            if (CHAR_SET[i] == ch)
-                return i;
-        return (size_t)-1; // shouldn't happen
+        return CHAR_INDEX.index[static_cast<unsigned char>(ch)];
     };
 
     // RULE 2: length 2 → increment ONLY last character
@@ -172,7 +195,43 @@ void generate_combination(std::string &starter)
     }
 }
 
-void update_total_work_done(std::shared_ptr<std::atomic<uint16_t>> &total_work_done, 
+void length_order_candidate(uint64_t index, size_t min_length, std::string &candidate)
+{
+    size_t length = min_length;
+    uint64_t count = 1;
+    for (size_t i = 0; i < length; ++i)
+        count *= CHAR_SET_SIZE;
+    while (index >= count)
+    {
+        index -= count;
+        count *= CHAR_SET_SIZE;
+        ++length;
+    }
+    candidate.resize(length);
+    for (size_t pos = length; pos-- > 0;)
+    {
+        candidate[pos] = CHAR_SET[index % CHAR_SET_SIZE];
+        index /= CHAR_SET_SIZE;
+    }
+}
+
+void next_length_order(std::string &candidate)
+{
+    for (size_t pos = candidate.size(); pos-- > 0;)
+    {
+        size_t idx = CHAR_INDEX.index[static_cast<unsigned char>(candidate[pos])];
+        if (idx < CHAR_SET_SIZE - 1)
+        {
+            candidate[pos] = CHAR_SET[idx + 1];
+            return;
+        }
+        candidate[pos] = CHAR_SET[0];
+    }
+    candidate += CHAR_SET[0];
+}
+
+void update_total_work_done(std::shared_ptr<std::atomic<uint32_t>> &total_work_done, 
+                            const size_t count,
                             const uint16_t work_size, 
                             std::shared_ptr<std::atomic<bool>> &work_completed)
 {
@@ -180,12 +239,12 @@ void update_total_work_done(std::shared_ptr<std::atomic<uint16_t>> &total_work_d
         return;
     }
 
-    std::lock_guard<std::mutex> lock(total_work_mutex);
-
-    total_work_done->fetch_add(1, std::memory_order_relaxed);
-
-    if (total_work_done->load(std::memory_order_relaxed) == work_size) {
+    // Lock-free: one fetch_add per batch, and only the thread that crosses
+    // work_size flips the flag. Batches can step over work_size, so this is a
+    // threshold, not an equality.
+    uint32_t done = total_work_done->fetch_add(static_cast<uint32_t>(count), std::memory_order_relaxed) +
+                    static_cast<uint32_t>(count);
+    if (done >= work_size && !work_completed->exchange(true, std::memory_order_relaxed)) {
         std::cout << "total work size reached, setting work_completed to true\n";
-        work_completed->store(true, std::memory_order_relaxed);
     }
 }
@@ -0,0 +1,656 @@
+#include "yescrypt.h"
+#include "sha256.h"
+
+#include <cstring>
+
+// Follows the yescrypt reference implementation (yescrypt-ref.c): blocks are
+// kept in Salsa20's SIMD-shuffled word order, which pwxform operates on
+// directly.
+namespace
+{
+    // pwxform parameters fixed by YESCRYPT_RW_DEFAULTS
+    constexpr size_t PWX_SIMPLE = 2;
+    constexpr size_t PWX_GATHER = 4;
+    constexpr size_t PWX_ROUNDS = 6;
+    constexpr size_t S_WIDTH = 8;
+
+    constexpr size_t PWX_BYTES = PWX_GATHER * PWX_SIMPLE * 8;
+    constexpr size_t PWX_WORDS = PWX_BYTES / sizeof(uint32_t);
+    constexpr size_t S_BYTES = 3 * (1 << S_WIDTH) * PWX_SIMPLE * 8;
+    constexpr size_t S_WORDS = S_BYTES / sizeof(uint32_t);
+    constexpr uint32_t S_MASK = ((1 << S_WIDTH) - 1) * PWX_SIMPLE * 8;
+
+    const char ITOA64[] = "./0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+    struct PwxformCtx
+    {
+        uint32_t (*S0)[2];
+        uint32_t (*S1)[2];
+        uint32_t (*S2)[2];
+        size_t w;
+    };
+
+    uint32_t atoi64(char c)
+    {
+        const char *pos = std::strchr(ITOA64, c);
+        return (c != '\0' && pos != nullptr) ? static_cast<uint32_t>(pos - ITOA64) : 64;
+    }
+
+    // Variable-length parameter encoding of $y$ settings
+    const char *decode64_uint32(uint32_t &dst, const char *src, uint32_t min)
+    {
+        uint32_t start = 0, end = 47, chars = 1, bits = 0;
+        uint32_t c = atoi64(*src++);
+        if (c > 63)
+            return nullptr;
+
+        dst = min;
+        while (c > end)
+        {
+            dst += (end + 1 - start) << bits;
+            start = end + 1;
+            end = start + (62 - end) / 2;
+            chars++;
+            bits += 6;
+        }
+        dst += (c - start) << bits;
+
+        while (--chars)
+        {
+            c = atoi64(*src++);
+            if (c > 63)
+                return nullptr;
+            bits -= 6;
+            dst += c << bits;
+        }
+        return src;
+    }
+
+    // Fixed-width little-endian encoding of $7$ settings
+    const char *decode64_uint32_fixed(uint32_t &dst, uint32_t dst_bits, const char *src)
+    {
+        dst = 0;
+        for (uint32_t bits = 0; bits < dst_bits; bits += 6)
+        {
+            uint32_t c = atoi64(*src++);
+            if (c > 63)
+                return nullptr;
+            dst |= c << bits;
+        }
+        return src;
+    }
+
+    inline uint32_t le32dec(const void *p)
+    {
+        const uint8_t *b = static_cast<const uint8_t *>(p);
+        return uint32_t(b[0]) | (uint32_t(b[1]) << 8) | (uint32_t(b[2]) << 16) | (uint32_t(b[3]) << 24);
+    }
+
+    inline void le32enc(void *p, uint32_t v)
+    {
+        uint8_t *b = static_cast<uint8_t *>(p);
+        b[0] = v & 0xff;
+        b[1] = (v >> 8) & 0xff;
+        b[2] = (v >> 16) & 0xff;
+        b[3] = v >> 24;
+    }
+
+    inline void blkcpy(uint32_t *dst, const uint32_t *src, size_t count)
+    {
+        std::memcpy(dst, src, count * sizeof(uint32_t));
+    }
+
+    inline void blkxor(uint32_t *dst, const uint32_t *src, size_t count)
+    {
+        for (size_t i = 0; i < count; ++i)
+            dst[i] ^= src[i];
+    }
+
+    inline uint32_t rotl(uint32_t a, int b)
+    {
+        return (a << b) | (a >> (32 - b));
+    }
+
+    void salsa20(uint32_t B[16], uint32_t rounds)
+    {
+        uint32_t x[16];
+        for (size_t i = 0; i < 16; ++i)
+            x[i * 5 % 16] = B[i];
+
+        for (uint32_t i = 0; i < rounds; i += 2)
+        {
+            x[4] ^= rotl(x[0] + x[12], 7);
+            x[8] ^= rotl(x[4] + x[0], 9);
+            x[12] ^= rotl(x[8] + x[4], 13);
+            x[0] ^= rotl(x[12] + x[8], 18);
+
+            x[9] ^= rotl(x[5] + x[1], 7);
+            x[13] ^= rotl(x[9] + x[5], 9);
+            x[1] ^= rotl(x[13] + x[9], 13);
+            x[5] ^= rotl(x[1] + x[13], 18);
+
+            x[14] ^= rotl(x[10] + x[6], 7);
+            x[2] ^= rotl(x[14] + x[10], 9);
+            x[6] ^= rotl(x[2] + x[14], 13);
+            x[10] ^= rotl(x[6] + x[2], 18);
+
+            x[3] ^= rotl(x[15] + x[11], 7);
+            x[7] ^= rotl(x[3] + x[15], 9);
+            x[11] ^= rotl(x[7] + x[3], 13);
+            x[15] ^= rotl(x[11] + x[7], 18);
+
+            x[1] ^= rotl(x[0] + x[3], 7);
+            x[2] ^= rotl(x[1] + x[0], 9);
+            x[3] ^= rotl(x[2] + x[1], 13);
+            x[0] ^= rotl(x[3] + x[2], 18);
+
+            x[6] ^= rotl(x[5] + x[4], 7);
+            x[7] ^= rotl(x[6] + x[5], 9);
+            x[4] ^= rotl(x[7] + x[6], 13);
+            x[5] ^= rotl(x[4] + x[7], 18);
+
+            x[11] ^= rotl(x[10] + x[9], 7);
+            x[8] ^= rotl(x[11] + x[10], 9);
+            x[9] ^= rotl(x[8] + x[11], 13);
+            x[10] ^= rotl(x[9] + x[8], 18);
+
+            x[12] ^= rotl(x[15] + x[14], 7);
+            x[13] ^= rotl(x[12] + x[15], 9);
+            x[14] ^= rotl(x[13] + x[12], 13);
+            x[15] ^= rotl(x[14] + x[13], 18);
+        }
+
+        for (size_t i = 0; i < 16; ++i)
+            B[i] += x[i * 5 % 16];
+    }
+
+    void blockmix_salsa8(uint32_t *B, uint32_t *Y, size_t r)
+    {
+        uint32_t X[16];
+        blkcpy(X, &B[(2 * r - 1) * 16], 16);
+        for (size_t i = 0; i < 2 * r; ++i)
+        {
+            blkxor(X, &B[i * 16], 16);
+            salsa20(X, 8);
+            blkcpy(&Y[i * 16], X, 16);
+        }
+        for (size_t i = 0; i < r; ++i)
+            blkcpy(&B[i * 16], &Y[(i * 2) * 16], 16);
+        for (size_t i = 0; i < r; ++i)
+            blkcpy(&B[(i + r) * 16], &Y[(i * 2 + 1) * 16], 16);
+    }
+
+    void pwxform(uint32_t *B, PwxformCtx &ctx)
+    {
+        auto X = reinterpret_cast<uint32_t(*)[PWX_SIMPLE][2]>(B);
+        uint32_t(*S0)[2] = ctx.S0;
+        uint32_t(*S1)[2] = ctx.S1;
+        uint32_t(*S2)[2] = ctx.S2;
+        size_t w = ctx.w;
+
+        for (size_t i = 0; i < PWX_ROUNDS; ++i)
+        {
+            for (size_t j = 0; j < PWX_GATHER; ++j)
+            {
+                uint32_t xl = X[j][0][0];
+                uint32_t xh = X[j][0][1];
+                uint32_t(*p0)[2] = S0 + (xl & S_MASK) / sizeof(*S0);
+                uint32_t(*p1)[2] = S1 + (xh & S_MASK) / sizeof(*S1);
+
+                for (size_t k = 0; k < PWX_SIMPLE; ++k)
+                {
+                    uint64_t s0 = (uint64_t(p0[k][1]) << 32) + p0[k][0];
+                    uint64_t s1 = (uint64_t(p1[k][1]) << 32) + p1[k][0];
+
+                    xl = X[j][k][0];
+                    xh = X[j][k][1];
+
+                    uint64_t x = uint64_t(xh) * xl;
+                    x += s0;
+                    x ^= s1;
+
+                    X[j][k][0] = static_cast<uint32_t>(x);
+                    X[j][k][1] = static_cast<uint32_t>(x >> 32);
+
+                    if (i != 0 && i != PWX_ROUNDS - 1)
+                    {
+                        S2[w][0] = static_cast<uint32_t>(x);
+                        S2[w][1] = static_cast<uint32_t>(x >> 32);
+                        w++;
+                    }
+                }
+            }
+        }
+
+        ctx.S0 = S2;
+        ctx.S1 = S0;
+        ctx.S2 = S1;
+        ctx.w = w & ((1 << S_WIDTH) * PWX_SIMPLE - 1);
+    }
+
+    void blockmix_pwxform(uint32_t *B, PwxformCtx &ctx, size_t r)
+    {
+        uint32_t X[PWX_WORDS];
+        size_t r1 = 128 * r / PWX_BYTES;
+
+        blkcpy(X, &B[(r1 - 1) * PWX_WORDS], PWX_WORDS);
+        for (size_t i = 0; i < r1; ++i)
+        {
+            if (r1 > 1)
+                blkxor(X, &B[i * PWX_WORDS], PWX_WORDS);
+            pwxform(X, ctx);
+            blkcpy(&B[i * PWX_WORDS], X, PWX_WORDS);
+        }
+
+        size_t i = (r1 - 1) * PWX_BYTES / 64;
+        salsa20(&B[i * 16], 2);
+        for (i++; i < 2 * r; ++i)
+        {
+            blkxor(&B[i * 16], &B[(i - 1) * 16], 16);
+            salsa20(&B[i * 16], 2);
+        }
+    }
+
+    inline void blockmix(uint32_t *X, uint32_t *Y, size_t r, PwxformCtx *ctx)
+    {
+        if (ctx)
+            blockmix_pwxform(X, *ctx, r);
+        else
+            blockmix_salsa8(X, Y, r);
+    }
+
+    inline uint64_t integerify(const uint32_t *B, size_t r)
+    {
+        const uint32_t *X = &B[(2 * r - 1) * 16];
+        return (uint64_t(X[13]) << 32) + X[0];
+    }
+
+    uint64_t p2floor(uint64_t x)
+    {
+        uint64_t y;
+        while ((y = x & (x - 1)))
+            x = y;
+        return x;
+    }
+
+    uint64_t wrap(uint64_t x, uint64_t i)
+    {
+        uint64_t n = p2floor(i);
+        return (x & (n - 1)) + (i - n);
+    }
+
+    void load_block(uint32_t *X, const uint32_t *B, size_t r)
+    {
+        for (size_t k = 0; k < 2 * r; ++k)
+            for (size_t i = 0; i < 16; ++i)
+                X[k * 16 + i] = le32dec(&B[k * 16 + (i * 5 % 16)]);
+    }
+
+    void store_block(uint32_t *B, const uint32_t *X, size_t r)
+    {
+        for (size_t k = 0; k < 2 * r; ++k)
+            for (size_t i = 0; i < 16; ++i)
+                le32enc(&B[k * 16 + (i * 5 % 16)], X[k * 16 + i]);
+    }
+
+    void smix1(uint32_t *B, size_t r, uint64_t N, uint32_t flags,
+               uint32_t *V, uint32_t *XY, PwxformCtx *ctx)
+    {
+        size_t s = 32 * r;
+        uint32_t *X = XY;
+        uint32_t *Y = &XY[s];
+
+        load_block(X, B, r);
+        for (uint64_t i = 0; i < N; ++i)
+        {
+            blkcpy(&V[i * s], X, s);
+            if ((flags & YESCRYPT_RW) && i > 1)
+            {
+                uint64_t j = wrap(integerify(X, r), i);
+                blkxor(X, &V[j * s], s);
+            }
+            blockmix(X, Y, r, ctx);
+        }
+        store_block(B, X, r);
+    }
+
+    void smix2(uint32_t *B, size_t r, uint64_t N, uint64_t Nloop, uint32_t flags,
+               uint32_t *V, uint32_t *XY, PwxformCtx *ctx)
+    {
+        size_t s = 32 * r;
+        uint32_t *X = XY;
+        uint32_t *Y = &XY[s];
+
+        load_block(X, B, r);
+        for (uint64_t i = 0; i < Nloop; ++i)
+        {
+            uint64_t j = integerify(X, r) & (N - 1);
+            blkxor(X, &V[j * s], s);
+            if (flags & YESCRYPT_RW)
+                blkcpy(&V[j * s], X, s);
+            blockmix(X, Y, r, ctx);
+        }
+        store_block(B, X, r);
+    }
+
+    void smix(uint32_t *B, size_t r, uint64_t N, uint32_t p, uint32_t t, uint32_t flags,
+              uint32_t *V, uint32_t *XY, uint32_t *S, PwxformCtx *ctxs, uint8_t *passwd)
+    {
+        size_t s = 32 * r;
+        uint64_t Nchunk = N / p;
+
+        uint64_t Nloop_all = Nchunk;
+        if (flags & YESCRYPT_RW)
+        {
+            if (t <= 1)
+            {
+                if (t)
+                    Nloop_all *= 2;
+                Nloop_all = (Nloop_all + 2) / 3;
+            }
+            else
+            {
+                Nloop_all *= t - 1;
+            }
+        }
+        else if (t)
+        {
+            if (t == 1)
+                Nloop_all += (Nloop_all + 1) / 2;
+            Nloop_all *= t;
+        }
+
+        uint64_t Nloop_rw = 0;
+        if (flags & YESCRYPT_RW)
+            Nloop_rw = Nloop_all / p;
+
+        Nchunk &= ~uint64_t(1);
+        Nloop_all++;
+        Nloop_all &= ~uint64_t(1);
+        Nloop_rw++;
+        Nloop_rw &= ~uint64_t(1);
+
+        uint64_t Vchunk = 0;
+        for (uint32_t i = 0; i < p; ++i, Vchunk += Nchunk)
+        {
+            uint64_t Np = (i < p - 1) ? Nchunk : (N - Vchunk);
+            uint32_t *Bp = &B[size_t(i) * s];
+            uint32_t *Vp = &V[size_t(Vchunk) * s];
+            PwxformCtx *ctx = nullptr;
+            if (flags & YESCRYPT_RW)
+            {
+                ctx = &ctxs[i];
+                uint32_t *Si = S + size_t(i) * S_WORDS;
+                smix1(Bp, 1, S_BYTES / 128, 0, Si, XY, nullptr);
+                ctx->S2 = reinterpret_cast<uint32_t(*)[2]>(Si);
+                ctx->S1 = ctx->S2 + (1 << S_WIDTH) * PWX_SIMPLE;
+                ctx->S0 = ctx->S1 + (1 << S_WIDTH) * PWX_SIMPLE;
+                ctx->w = 0;
+                if (i == 0)
+                {
+                    uint8_t mac[SHA256_DIGEST_BYTES];
+                    hmac_sha256(Bp + (s - 16), 64, passwd, 32, mac);
+                    std::memcpy(passwd, mac, sizeof(mac));
+                }
+            }
+            smix1(Bp, r, Np, flags, Vp, XY, ctx);
+            smix2(Bp, r, p2floor(Np), Nloop_rw, flags, Vp, XY, ctx);
+        }
+
+        for (uint32_t i = 0; i < p; ++i)
+        {
+            uint32_t *Bp = &B[size_t(i) * s];
+            smix2(Bp, r, N, Nloop_all - Nloop_rw, flags & ~YESCRYPT_RW, V, XY,
+                  (flags & YESCRYPT_RW) ? &ctxs[i] : nullptr);
+        }
+    }
+
+    // Carves V, B, XY, S and the pwxform contexts out of the arena
+    struct Workspace
+    {
+        uint32_t *V;
+        uint32_t *B;
+        uint32_t *XY;
+        uint32_t *S;
+        PwxformCtx *ctxs;
+    };
+
+    constexpr size_t align64(size_t n)
+    {
+        return (n + 63) & ~size_t(63);
+    }
+
+    Workspace carve(void *arena, const YescryptParams &params)
+    {
+        auto *base = static_cast<uint8_t *>(arena);
+        size_t v_bytes = align64(size_t(128) * params.r * params.N);
+        size_t b_bytes = align64(size_t(128) * params.r * params.p);
+        size_t xy_bytes = align64(size_t(256) * params.r);
+        size_t s_bytes = align64(S_BYTES * params.p);
+
+        Workspace ws;
+        ws.V = reinterpret_cast<uint32_t *>(base);
+        ws.B = reinterpret_cast<uint32_t *>(base + v_bytes);
+        ws.XY = reinterpret_cast<uint32_t *>(base + v_bytes + b_bytes);
+        ws.S = reinterpret_cast<uint32_t *>(base + v_bytes + b_bytes + xy_bytes);
+        ws.ctxs = reinterpret_cast<PwxformCtx *>(base + v_bytes + b_bytes + xy_bytes + s_bytes);
+        return ws;
+    }
+
+    void kdf_body(const Workspace &ws, const uint8_t *passwd, size_t passwd_len,
+                  const uint8_t *salt, size_t salt_len, uint32_t flags,
+                  uint64_t N, uint32_t r, uint32_t p, uint32_t t,
+                  uint8_t *buf, size_t buf_len)
+    {
+        uint8_t sha[SHA256_DIGEST_BYTES];
+        size_t b_size = size_t(128) * r * p;
+
+        if (flags)
+        {
+            hmac_sha256("yescrypt-prehash", (flags & YESCRYPT_PREHASH) ? 16 : 8,
+                        passwd, passwd_len, sha);
+            passwd = sha;
+            passwd_len = sizeof(sha);
+        }
+
+        pbkdf2_sha256(passwd, passwd_len, salt, salt_len, 1,
+                      reinterpret_cast<uint8_t *>(ws.B), b_size);
+
+        if (flags)
+            std::memcpy(sha, ws.B, sizeof(sha));
+
+        if (p == 1 || (flags & YESCRYPT_RW))
+        {
+            smix(ws.B, r, N, p, t, flags, ws.V, ws.XY, ws.S, ws.ctxs, sha);
+        }
+        else
+        {
+            for (uint32_t i = 0; i < p; ++i)
+                smix(&ws.B[size_t(32) * r * i], r, N, 1, t, flags, ws.V, ws.XY, nullptr, nullptr, nullptr);
+        }
+
+        uint8_t dk[SHA256_DIGEST_BYTES];
+        uint8_t *dkp = buf;
+        if (flags && buf_len < sizeof(dk))
+        {
+            pbkdf2_sha256(passwd, passwd_len, reinterpret_cast<uint8_t *>(ws.B), b_size, 1, dk, sizeof(dk));
+            dkp = dk;
+        }
+
+        pbkdf2_sha256(passwd, passwd_len, reinterpret_cast<uint8_t *>(ws.B), b_size, 1, buf, buf_len);
+
+        // SCRAM-style ClientKey / StoredKey finish
+        if (flags && !(flags & YESCRYPT_PREHASH))
+        {
+            uint8_t client_key[SHA256_DIGEST_BYTES];
+            hmac_sha256(dkp, sizeof(dk), "Client Key", 10, client_key);
+            sha256(client_key, sizeof(client_key), dk);
+            std::memcpy(buf, dk, buf_len < sizeof(dk) ? buf_len : sizeof(dk));
+        }
+    }
+}
+
+bool yescrypt_decode64(const char *src, size_t src_len, uint8_t *dst, size_t &dst_len)
+{
+    size_t produced = 0;
+    while (src_len > 0)
+    {
+        uint32_t value = 0, bits = 0;
+        while (src_len > 0 && bits < 24)
+        {
+            uint32_t c = atoi64(*src);
+            if (c > 63)
+                return false;
+            value |= c << bits;
+            bits += 6;
+            ++src;
+            --src_len;
+        }
+        if (bits < 12) // must carry at least one full byte
+            return false;
+        while (bits >= 8)
+        {
+            if (produced >= dst_len)
+                return false;
+            dst[produced++] = value & 0xff;
+            value >>= 8;
+            bits -= 8;
+        }
+        if (value) // padding bits must be zero
+            return false;
+    }
+    dst_len = produced;
+    return true;
+}
+
+bool yescrypt_parse_setting(const std::string &setting, YescryptParams &params,
+                            std::vector<uint8_t> &salt)
+{
+    params = YescryptParams{};
+    if (setting.size() < 4 || setting[0] != '$' || (setting[1] != '7' && setting[1] != 'y') ||
+        setting[2] != '$')
+        return false;
+
+    const char *src = setting.c_str() + 3;
+    if (setting[1] == '7')
+    {
+        uint32_t n_log2 = atoi64(*src++);
+        if (n_log2 < 1 || n_log2 > 63)
+            return false;
+        params.N = uint64_t(1) << n_log2;
+        src = decode64_uint32_fixed(params.r, 30, src);
+        if (!src)
+            return false;
+        src = decode64_uint32_fixed(params.p, 30, src);
+        if (!src)
+            return false;
+    }
+    else
+    {
+        uint32_t flavor, n_log2;
+        src = decode64_uint32(flavor, src, 0);
+        if (!src)
+            return false;
+        if (flavor < YESCRYPT_RW)
+            params.flags = flavor;
+        else if (flavor <= YESCRYPT_RW + (YESCRYPT_RW_FLAVOR_MASK >> 2))
+            params.flags = YESCRYPT_RW + ((flavor - YESCRYPT_RW) << 2);
+        else
+            return false;
+
+        src = decode64_uint32(n_log2, src, 1);
+        if (!src || n_log2 > 63)
+            return false;
+        params.N = uint64_t(1) << n_log2;
+
+        src = decode64_uint32(params.r, src, 1);
+        if (!src)
+            return false;
+
+        if (*src != '$')
+        {
+            uint32_t have;
+            src = decode64_uint32(have, src, 1);
+            if (!src)
+                return false;
+            if ((have & 1) && !(src = decode64_uint32(params.p, src, 2)))
+                return false;
+            if ((have & 2) && !(src = decode64_uint32(params.t, src, 1)))
+                return false;
+            if ((have & 4) && !(src = decode64_uint32(params.g, src, 1)))
+                return false;
+            if (have & 8)
+            {
+                uint32_t nrom_log2;
+                if (!(src = decode64_uint32(nrom_log2, src, 1)) || nrom_log2 > 63)
+                    return false;
+                params.NROM = uint64_t(1) << nrom_log2;
+            }
+        }
+        if (*src++ != '$')
+            return false;
+    }
+
+    // Salt runs up to the next '$' (or the end of the setting)
+    std::string salt_str(src);
+    auto end = salt_str.find('$');
+    if (end != std::string::npos)
+        salt_str.resize(end);
+
+    if (setting[1] == '7')
+    {
+        salt.assign(salt_str.begin(), salt_str.end());
+    }
+    else
+    {
+        uint8_t bin[YESCRYPT_MAX_SALT];
+        size_t len = sizeof(bin);
+        if (!yescrypt_decode64(salt_str.data(), salt_str.size(), bin, len))
+            return false;
+        salt.assign(bin, bin + len);
+    }
+
+    // Sanity limits from the reference, plus what this engine leaves out
+    if (params.N < 2 || (params.N & (params.N - 1)) || params.r < 1 || params.p < 1 ||
+        uint64_t(params.r) * params.p >= (uint64_t(1) << 30))
+        return false;
+    if (params.g != 0 || params.NROM != 0)
+        return false;
+    if ((params.flags & YESCRYPT_RW) &&
+        (params.flags & YESCRYPT_RW_FLAVOR_MASK) != (YESCRYPT_RW_DEFAULTS & YESCRYPT_RW_FLAVOR_MASK))
+        return false;
+    if ((params.flags & YESCRYPT_RW) && (params.N / params.p <= 1 || params.r < (PWX_BYTES + 127) / 128))
+        return false;
+    return true;
+}
+
+size_t yescrypt_arena_bytes(const YescryptParams &params)
+{
+    return align64(size_t(128) * params.r * params.N) +
+           align64(size_t(128) * params.r * params.p) +
+           align64(size_t(256) * params.r) +
+           align64(S_BYTES * params.p) +
+           align64(sizeof(PwxformCtx) * params.p);
+}
+
+void yescrypt_hash(const YescryptParams &params,
+                   const uint8_t *passwd, size_t passwd_len,
+                   const uint8_t *salt, size_t salt_len,
+                   void *arena, uint8_t out[YESCRYPT_HASH_BYTES])
+{
+    Workspace ws = carve(arena, params);
+    uint8_t dk[YESCRYPT_HASH_BYTES];
+
+    // Large RW hashes are preceded by a cheap N/64 pre-hash of the password
+    if ((params.flags & YESCRYPT_RW) && params.N / params.p >= 0x100 &&
+        params.N / params.p * params.r >= 0x20000)
+    {
+        kdf_body(ws, passwd, passwd_len, salt, salt_len, params.flags | YESCRYPT_PREHASH,
+                 params.N >> 6, params.r, params.p, 0, dk, sizeof(dk));
+        passwd = dk;
+        passwd_len = sizeof(dk);
+    }
+
+    kdf_body(ws, passwd, passwd_len, salt, salt_len, params.flags,
+             params.N, params.r, params.p, params.t, out, YESCRYPT_HASH_BYTES);
+}